@@ -166,6 +166,8 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_mux_threads(void);
+static void free_encoder_threads(void);
 #endif
 
 /* sub2video hack:
@@ -343,7 +345,7 @@ static volatile int received_sigterm = 0;
 static volatile int received_nb_signals = 0;
 static atomic_int transcode_init_done = ATOMIC_VAR_INIT(0);
 static volatile int ffmpeg_exited = 0;
-static int main_return_code = 0;
+static atomic_int main_return_code = 0;
 
 static void
 sigterm_handler(int sig)
@@ -492,6 +494,11 @@ static void ffmpeg_cleanup(int ret)
 {
     int i, j;
 
+#if HAVE_THREADS
+    free_encoder_threads();
+    free_mux_threads();
+#endif
+
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
@@ -554,6 +561,10 @@ static void ffmpeg_cleanup(int ret)
             avio_closep(&s->pb);
         avformat_free_context(s);
         av_dict_free(&of->opts);
+#if HAVE_THREADS
+        pthread_mutex_destroy(&of->mux_lock);
+        pthread_mutex_destroy(&of->mux_stats_lock);
+#endif
 
         av_freep(&output_files[i]);
     }
@@ -694,11 +705,248 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
-        ost2->finished |= ost == ost2 ? this_stream : others;
+        atomic_fetch_or(&ost2->finished, ost == ost2 ? this_stream : others);
+    }
+}
+
+/*
+ * Muxing into an output file may happen both from the main thread and from
+ * the encoder threads of its streams, so it is serialized by the file's
+ * mux_lock.  The owner is remembered so that cleanup can release the lock if
+ * exit_program() is called while it is held.
+ */
+static void lock_output_file(OutputFile *of)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&of->mux_lock);
+    of->mux_lock_owner = pthread_self();
+    of->mux_locked     = 1;
+#endif
+}
+
+static void unlock_output_file(OutputFile *of)
+{
+#if HAVE_THREADS
+    of->mux_locked = 0;
+    pthread_mutex_unlock(&of->mux_lock);
+#endif
+}
+
+/*
+ * Current position in the output file.  With a writer thread, the
+ * AVIOContext belongs to that thread, which publishes its position after
+ * every packet.
+ */
+static int64_t output_file_tell(OutputFile *of)
+{
+    int64_t pos;
+
+#if HAVE_THREADS
+    if (of->mux_thread_queue) {
+        pthread_mutex_lock(&of->mux_stats_lock);
+        pos = of->mux_size;
+        pthread_mutex_unlock(&of->mux_stats_lock);
+        return pos;
+    }
+#endif
+
+    return avio_tell(of->ctx->pb);
+}
+
+/*
+ * End pts of an output stream, as for output_file_tell() published by the
+ * writer thread if there is one.
+ */
+static int64_t output_stream_end_pts(OutputStream *ost)
+{
+    OutputFile *of = output_files[ost->file_index];
+    int64_t pts;
+
+#if HAVE_THREADS
+    if (of->mux_thread_queue) {
+        pthread_mutex_lock(&of->mux_stats_lock);
+        pts = ost->mux_end_pts;
+        pthread_mutex_unlock(&of->mux_stats_lock);
+        return pts;
+    }
+#endif
+
+    lock_output_file(of);
+    pts = av_stream_get_end_pts(ost->st);
+    unlock_output_file(of);
+    return pts;
+}
+
+#if HAVE_THREADS
+typedef struct MuxThreadMsg {
+    AVPacket pkt;
+    int64_t  queued;            /* av_gettime_relative() when it was queued */
+} MuxThreadMsg;
+
+static void free_mux_thread_msg(void *msg)
+{
+    av_packet_unref(&((MuxThreadMsg *)msg)->pkt);
+}
+
+/*
+ * Writer thread of an output file: calls the muxer for the packets queued by
+ * write_packet(), so that a slow output does not hold up the main thread and
+ * the other outputs.
+ */
+static void *mux_thread(void *arg)
+{
+    OutputFile *of = arg;
+    MuxThreadMsg msg;
+    int64_t latency, size;
+    int i, ret;
+
+    while (1) {
+        ret = av_thread_message_queue_recv(of->mux_thread_queue, &msg, 0);
+        if (ret < 0)
+            return NULL;
+
+        ret = av_interleaved_write_frame(of->ctx, &msg.pkt);
+        av_packet_unref(&msg.pkt);
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            av_thread_message_queue_set_err_send(of->mux_thread_queue, ret);
+            return (void *)(intptr_t)ret;
+        }
+
+        latency = av_gettime_relative() - msg.queued;
+        size    = of->ctx->pb ? avio_tell(of->ctx->pb) : 0;
+
+        pthread_mutex_lock(&of->mux_stats_lock);
+        of->mux_written++;
+        of->mux_size         = size;
+        of->mux_latency_sum += latency;
+        of->mux_latency_max  = FFMAX(of->mux_latency_max, latency);
+        /* the interleaving may have written packets of any stream */
+        for (i = 0; i < of->ctx->nb_streams; i++)
+            output_streams[of->ost_index + i]->mux_end_pts =
+                av_stream_get_end_pts(of->ctx->streams[i]);
+        pthread_mutex_unlock(&of->mux_stats_lock);
+    }
+}
+
+static int init_mux_thread(OutputFile *of)
+{
+    int ret;
+
+    if (of->mux_thread_queue_size <= 0)
+        return 0;
+
+    ret = av_thread_message_queue_alloc(&of->mux_thread_queue,
+                                        of->mux_thread_queue_size,
+                                        sizeof(MuxThreadMsg));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(of->mux_thread_queue,
+                                          free_mux_thread_msg);
+
+    if ((ret = pthread_create(&of->mux_thread, NULL, mux_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_thread_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+/*
+ * Decide whether pkt may be queued to the writer thread, applying the drop
+ * policy of the file when the queue is full.  After a drop, the affected
+ * streams are resumed at their next keyframe.  Only the producer side, which
+ * holds the mux_lock, changes the queue size upwards, so a queue found not to
+ * be full cannot become full before pkt is sent.
+ */
+static int mux_thread_accept(OutputFile *of, OutputStream *ost, const AVPacket *pkt)
+{
+    int i, queued;
+
+    if (of->mux_thread_drop != MUX_THREAD_DROP_NONE) {
+        queued = av_thread_message_queue_nb_elems(of->mux_thread_queue);
+        if (queued >= of->mux_thread_queue_size) {
+            if (of->mux_thread_drop == MUX_THREAD_DROP_NEW) {
+                ost->mux_resync = 1;
+                return 0;
+            }
+            av_thread_message_flush(of->mux_thread_queue);
+            of->mux_dropped += queued;
+            for (i = 0; i < of->ctx->nb_streams; i++)
+                output_streams[of->ost_index + i]->mux_resync = 1;
+            av_log(of->ctx, AV_LOG_WARNING, "Writer thread queue full, "
+                   "dropped %d packets\n", queued);
+        }
     }
+
+    if (ost->mux_resync) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY))
+            return 0;
+        ost->mux_resync = 0;
+    }
+    return 1;
+}
+
+static int send_packet_to_mux_thread(OutputFile *of, AVPacket *pkt)
+{
+    MuxThreadMsg msg;
+    int ret;
+
+    ret = av_packet_make_refcounted(pkt);
+    if (ret < 0)
+        return ret;
+
+    av_packet_move_ref(&msg.pkt, pkt);
+    msg.queued = av_gettime_relative();
+
+    ret = av_thread_message_queue_send(of->mux_thread_queue, &msg, 0);
+    if (ret < 0)
+        av_packet_unref(&msg.pkt);
+    return ret;
 }
 
-static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
+/*
+ * Wait until the writer thread has written all the queued packets, so that
+ * the trailer can be written from the main thread.
+ */
+static int finish_mux_thread(OutputFile *of)
+{
+    void *thread_ret;
+
+    if (!of->mux_thread_queue)
+        return 0;
+
+    av_thread_message_queue_set_err_recv(of->mux_thread_queue, AVERROR_EOF);
+    pthread_join(of->mux_thread, &thread_ret);
+    av_thread_message_queue_free(&of->mux_thread_queue);
+
+    return (intptr_t)thread_ret;
+}
+
+static void free_mux_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        if (!of || !of->mux_thread_queue)
+            continue;
+        av_thread_message_flush(of->mux_thread_queue);
+        av_thread_message_queue_set_err_recv(of->mux_thread_queue, AVERROR_EXIT);
+        if (!pthread_equal(of->mux_thread, pthread_self()))
+            pthread_join(of->mux_thread, NULL);
+        av_thread_message_queue_free(&of->mux_thread_queue);
+    }
+}
+#endif
+
+/*
+ * Returns a negative error code only on failures that must abort the program;
+ * encoder threads report them to the main thread instead of exiting.
+ */
+static int write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
@@ -715,7 +963,7 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && ost->encoding_needed) && !unqueue) {
         if (ost->frame_number >= ost->max_frames) {
             av_packet_unref(pkt);
-            return;
+            return 0;
         }
         ost->frame_number++;
     }
@@ -730,18 +978,18 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                 av_log(NULL, AV_LOG_ERROR,
                        "Too many packets buffered for output stream %d:%d.\n",
                        ost->file_index, ost->st->index);
-                exit_program(1);
+                return AVERROR(ENOSPC);
             }
             ret = av_fifo_realloc2(ost->muxing_queue, new_size);
             if (ret < 0)
-                exit_program(1);
+                return ret;
         }
         ret = av_packet_make_refcounted(pkt);
         if (ret < 0)
-            exit_program(1);
+            return ret;
         av_packet_move_ref(&tmp_pkt, pkt);
         av_fifo_generic_write(ost->muxing_queue, &tmp_pkt, sizeof(tmp_pkt), NULL);
-        return;
+        return 0;
     }
 
     if ((st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
@@ -798,7 +1046,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                        ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
                 if (exit_on_error) {
                     av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-                    exit_program(1);
+                    av_packet_unref(pkt);
+                    return AVERROR(EINVAL);
                 }
                 av_log(s, loglevel, "changing to %"PRId64". This may result "
                        "in incorrect timestamps in the output file.\n",
@@ -809,6 +1058,15 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
             }
         }
     }
+
+#if HAVE_THREADS
+    if (of->mux_thread_queue && !mux_thread_accept(of, ost, pkt)) {
+        of->mux_dropped++;
+        av_packet_unref(pkt);
+        return 0;
+    }
+#endif
+
     ost->last_mux_dts = pkt->dts;
 
     ost->data_size += pkt->size;
@@ -826,20 +1084,35 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+#if HAVE_THREADS
+    if (of->mux_thread_queue) {
+        if (pkt->dts != AV_NOPTS_VALUE)
+            ost->mux_queued_dts = pkt->dts;
+        /* write errors are reported by the writer thread */
+        ret = send_packet_to_mux_thread(of, pkt);
+        if (ret < 0) {
+            atomic_store(&main_return_code, 1);
+            close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        }
+        return 0;
+    }
+#endif
+
     ret = av_interleaved_write_frame(s, pkt);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
-        main_return_code = 1;
+        atomic_store(&main_return_code, 1);
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
     av_packet_unref(pkt);
+    return 0;
 }
 
 static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
-    ost->finished |= ENCODER_FINISHED;
+    atomic_fetch_or(&ost->finished, ENCODER_FINISHED);
     if (of->shortest) {
         int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
         of->recording_time = FFMIN(of->recording_time, end);
@@ -856,9 +1129,12 @@ static void close_output_stream(OutputStream *ost)
  * If eof is set, instead indicate EOF to all bitstream filters and
  * therefore flush any delayed packets to the output.  A blank packet
  * must be supplied in this case.
+ *
+ * The caller must hold the mux_lock of the output file.  Returns a negative
+ * error code if the program must be aborted.
  */
-static void output_packet(OutputFile *of, AVPacket *pkt,
-                          OutputStream *ost, int eof)
+static int do_output_packet(OutputFile *of, AVPacket *pkt,
+                            OutputStream *ost, int eof)
 {
     int ret = 0;
 
@@ -867,20 +1143,227 @@ static void output_packet(OutputFile *of, AVPacket *pkt,
         ret = av_bsf_send_packet(ost->bsf_ctx, eof ? NULL : pkt);
         if (ret < 0)
             goto finish;
-        while ((ret = av_bsf_receive_packet(ost->bsf_ctx, pkt)) >= 0)
-            write_packet(of, pkt, ost, 0);
+        while ((ret = av_bsf_receive_packet(ost->bsf_ctx, pkt)) >= 0) {
+            ret = write_packet(of, pkt, ost, 0);
+            if (ret < 0)
+                return ret;
+        }
         if (ret == AVERROR(EAGAIN))
             ret = 0;
     } else if (!eof)
-        write_packet(of, pkt, ost, 0);
+        return write_packet(of, pkt, ost, 0);
 
 finish:
     if (ret < 0 && ret != AVERROR_EOF) {
         av_log(NULL, AV_LOG_ERROR, "Error applying bitstream filters to an output "
                "packet for stream #%d:%d.\n", ost->file_index, ost->index);
         if(exit_on_error)
-            exit_program(1);
+            return ret;
+    }
+    return 0;
+}
+
+static void output_packet(OutputFile *of, AVPacket *pkt,
+                          OutputStream *ost, int eof)
+{
+    int ret;
+
+    lock_output_file(of);
+    ret = do_output_packet(of, pkt, ost, eof);
+    unlock_output_file(of);
+    if (ret < 0)
+        exit_program(1);
+}
+
+#if HAVE_THREADS
+static void free_encoder_thread_msg(void *msg)
+{
+    av_frame_free(msg);
+}
+
+/*
+ * Encoder thread of an output stream: receives references to the frames
+ * prepared by do_video_out()/do_audio_out() (NULL signals end of stream),
+ * encodes them and muxes the resulting packets.
+ */
+static void *encoder_thread(void *arg)
+{
+    OutputStream   *ost = arg;
+    OutputFile      *of = output_files[ost->file_index];
+    AVCodecContext *enc = ost->enc_ctx;
+    const char   *desc  = av_get_media_type_string(enc->codec_type);
+    int64_t last_pts    = AV_NOPTS_VALUE;
+    int flushing        = 0;
+    AVFrame *frame;
+    AVPacket pkt;
+    int ret;
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    while (!flushing) {
+        ret = av_thread_message_queue_recv(ost->enc_thread_queue, &frame, 0);
+        if (ret < 0)
+            return NULL;
+
+        if (frame)
+            last_pts = frame->pts;
+        else
+            flushing = 1;
+
+        ret = avcodec_send_frame(enc, frame);
+        av_frame_free(&frame);
+        if (ret < 0)
+            goto fail;
+
+        while ((ret = avcodec_receive_packet(enc, &pkt)) >= 0) {
+            if (debug_ts) {
+                av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+                       "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                       desc,
+                       av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
+                       av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
+            }
+
+            if (enc->codec_type == AVMEDIA_TYPE_VIDEO &&
+                pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+                pkt.pts = last_pts;
+
+            /* if two pass, output log */
+            if (ost->logfile && enc->stats_out)
+                fprintf(ost->logfile, "%s", enc->stats_out);
+
+            lock_output_file(of);
+            if (flushing && (atomic_load(&ost->finished) & MUXER_FINISHED)) {
+                av_packet_unref(&pkt);
+                ret = 0;
+            } else {
+                /* mux_timebase may still change until the header is written */
+                av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
+                ret = do_output_packet(of, &pkt, ost, 0);
+            }
+            unlock_output_file(of);
+            if (ret < 0)
+                goto fail_mux;
+        }
+        if (ret == AVERROR_EOF) {
+            lock_output_file(of);
+            ret = do_output_packet(of, &pkt, ost, 1);
+            unlock_output_file(of);
+            if (ret < 0)
+                goto fail_mux;
+            return NULL;
+        }
+        if (ret != AVERROR(EAGAIN))
+            goto fail;
+    }
+
+    return NULL;
+fail:
+    av_log(NULL, AV_LOG_FATAL, "%s encoding failed for output stream #%d:%d: %s\n",
+           desc, ost->file_index, ost->index, av_err2str(ret));
+fail_mux:
+    /* the main thread exits once it notices the error on the queue */
+    av_thread_message_queue_set_err_send(ost->enc_thread_queue, ret);
+    return (void *)(intptr_t)ret;
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    if (ost->enc_thread_queue_size <= 0 ||
+        (ost->enc_ctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+         ost->enc_ctx->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+
+    if (vstats_filename) {
+        av_log(NULL, AV_LOG_WARNING, "Encoder threads are not supported "
+               "together with -vstats, encoding output stream #%d:%d on "
+               "the main thread.\n", ost->file_index, ost->index);
+        return 0;
+    }
+
+    ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                        ost->enc_thread_queue_size,
+                                        sizeof(AVFrame *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(ost->enc_thread_queue,
+                                          free_encoder_thread_msg);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+        return AVERROR(ret);
     }
+
+    return 0;
+}
+
+/*
+ * Signal end of stream to the encoder thread and wait until it has flushed
+ * the encoder and written all remaining packets.
+ */
+static int finish_encoder_thread(OutputStream *ost)
+{
+    AVFrame *frame = NULL;
+    void *thread_ret;
+
+    if (!ost->enc_thread_queue)
+        return 0;
+
+    /* fails only if the thread already gave up with an error */
+    av_thread_message_queue_send(ost->enc_thread_queue, &frame, 0);
+    pthread_join(ost->enc_thread, &thread_ret);
+    av_thread_message_queue_free(&ost->enc_thread_queue);
+
+    return (intptr_t)thread_ret;
+}
+
+static void free_encoder_threads(void)
+{
+    int i;
+
+    /* exit_program() may have been called with a muxer lock held */
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        if (of && of->mux_locked && pthread_equal(of->mux_lock_owner, pthread_self()))
+            unlock_output_file(of);
+    }
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost || !ost->enc_thread_queue)
+            continue;
+        av_thread_message_flush(ost->enc_thread_queue);
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EXIT);
+        if (!pthread_equal(ost->enc_thread, pthread_self()))
+            pthread_join(ost->enc_thread, NULL);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+    }
+}
+#endif
+
+/*
+ * Hand a new reference to frame over to the encoder thread of ost.  This
+ * blocks while the thread's queue is full, which provides backpressure to
+ * decoding and filtering.
+ */
+static int send_frame_to_encoder_thread(OutputStream *ost, const AVFrame *frame)
+{
+    AVFrame *ref = av_frame_clone(frame);
+    int ret;
+
+    if (!ref)
+        return AVERROR(ENOMEM);
+
+    ret = av_thread_message_queue_send(ost->enc_thread_queue, &ref, 0);
+    if (ret < 0)
+        av_frame_free(&ref);
+    return ret;
 }
 
 static int check_recording_time(OutputStream *ost)
@@ -925,11 +1408,14 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
-    ret = avcodec_send_frame(enc, frame);
+    if (ost->enc_thread_queue)
+        ret = send_frame_to_encoder_thread(ost, frame);
+    else
+        ret = avcodec_send_frame(enc, frame);
     if (ret < 0)
         goto error;
 
-    while (1) {
+    while (!ost->enc_thread_queue) {
         ret = avcodec_receive_packet(enc, &pkt);
         if (ret == AVERROR(EAGAIN))
             break;
@@ -1274,13 +1760,16 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
-        ret = avcodec_send_frame(enc, in_picture);
+        if (ost->enc_thread_queue)
+            ret = send_frame_to_encoder_thread(ost, in_picture);
+        else
+            ret = avcodec_send_frame(enc, in_picture);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
 
-        while (1) {
+        while (!ost->enc_thread_queue) {
             ret = avcodec_receive_packet(enc, &pkt);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
@@ -1377,7 +1866,7 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
         fprintf(vstats_file,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
+        ti1 = output_stream_end_pts(ost) * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
@@ -1396,11 +1885,12 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
-    ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
+    atomic_store(&ost->finished, ENCODER_FINISHED | MUXER_FINISHED);
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
-            output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
+            atomic_store(&output_streams[of->ost_index + i]->finished,
+                         ENCODER_FINISHED | MUXER_FINISHED);
     }
 }
 
@@ -1456,7 +1946,7 @@ static int reap_filters(int flush)
                 }
                 break;
             }
-            if (ost->finished) {
+            if (atomic_load(&ost->finished)) {
                 av_frame_unref(filtered_frame);
                 continue;
             }
@@ -1620,6 +2110,15 @@ static void print_final_stats(int64_t total_size)
 
         av_log(NULL, AV_LOG_VERBOSE, "  Total: %"PRIu64" packets (%"PRIu64" bytes) muxed\n",
                total_packets, total_size);
+
+#if HAVE_THREADS
+        if (of->mux_thread_queue_size > 0 && of->header_written)
+            av_log(NULL, AV_LOG_INFO, "Output file #%d writer thread: %"PRId64" packets "
+                   "written, %"PRId64" dropped, latency avg %.3f ms max %.3f ms\n",
+                   i, of->mux_written, of->mux_dropped,
+                   of->mux_written ? of->mux_latency_sum / 1000.0 / of->mux_written : 0.0,
+                   of->mux_latency_max / 1000.0);
+#endif
     }
     if(video_size + data_size + audio_size + subtitle_size + extra_size == 0){
         av_log(NULL, AV_LOG_WARNING, "Output file is empty, nothing was encoded ");
@@ -1667,19 +2166,34 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+    if (output_files[0]->mux_thread_queue) {
+        total_size = output_file_tell(output_files[0]);
+    } else {
+        total_size = avio_size(oc->pb);
+        if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+            total_size = avio_tell(oc->pb);
+    }
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprint_init(&buf_script, 0, AV_BPRINT_SIZE_AUTOMATIC);
     for (i = 0; i < nb_output_streams; i++) {
+        int64_t ost_error[FF_ARRAY_ELEMS(ost->error)];
+        int64_t end_pts;
+        int pict_type;
         float q = -1;
         ost = output_streams[i];
         enc = ost->enc_ctx;
+
+        /* the quality stats and the frame count are updated by the encoder
+         * thread if there is one */
+        lock_output_file(output_files[ost->file_index]);
         if (!ost->stream_copy)
             q = ost->quality / (float) FF_QP2LAMBDA;
+        pict_type = ost->pict_type;
+        memcpy(ost_error, ost->error, sizeof(ost_error));
+        frame_number = ost->frame_number;
+        unlock_output_file(output_files[ost->file_index]);
 
         if (vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             av_bprintf(&buf, "q=%2.1f ", q);
@@ -1689,7 +2203,6 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (!vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             float fps;
 
-            frame_number = ost->frame_number;
             fps = t > 1 ? frame_number / t : 0;
             av_bprintf(&buf, "frame=%5d fps=%3.*f q=%3.1f ",
                      frame_number, fps < 9.95, fps, q);
@@ -1708,7 +2221,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                     av_bprintf(&buf, "%X", av_log2(qp_histogram[j] + 1));
             }
 
-            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (ost->pict_type != AV_PICTURE_TYPE_NONE || is_last_report)) {
+            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (pict_type != AV_PICTURE_TYPE_NONE || is_last_report)) {
                 int j;
                 double error, error_sum = 0;
                 double scale, scale_sum = 0;
@@ -1717,10 +2230,12 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 av_bprintf(&buf, "PSNR=");
                 for (j = 0; j < 3; j++) {
                     if (is_last_report) {
+                        /* written by the encoder, the encoder threads
+                         * have been joined before the last report */
                         error = enc->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
-                        error = ost->error[j];
+                        error = ost_error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0;
                     }
                     if (j)
@@ -1740,9 +2255,10 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE)
-            pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
-                                          ost->st->time_base, AV_TIME_BASE_Q));
+        end_pts = output_stream_end_pts(ost);
+        if (end_pts != AV_NOPTS_VALUE)
+            pts = FFMAX(pts, av_rescale_q(end_pts, ost->st->time_base,
+                                          AV_TIME_BASE_Q));
         if (is_last_report)
             nb_frames_drop += ost->last_dropped;
     }
@@ -1793,6 +2309,30 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
 
+#if HAVE_THREADS
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        int64_t written, latency_sum, latency_max;
+
+        if (of->mux_thread_queue_size <= 0 || !of->header_written)
+            continue;
+        pthread_mutex_lock(&of->mux_stats_lock);
+        written     = of->mux_written;
+        latency_sum = of->mux_latency_sum;
+        latency_max = of->mux_latency_max;
+        pthread_mutex_unlock(&of->mux_stats_lock);
+
+        av_bprintf(&buf_script, "file_%d_mux_queued=%d\n", i,
+                   of->mux_thread_queue ?
+                   av_thread_message_queue_nb_elems(of->mux_thread_queue) : 0);
+        av_bprintf(&buf_script, "file_%d_mux_dropped=%"PRId64"\n", i, of->mux_dropped);
+        av_bprintf(&buf_script, "file_%d_mux_latency_avg_ms=%.3f\n", i,
+                   written ? latency_sum / 1000.0 / written : 0.0);
+        av_bprintf(&buf_script, "file_%d_mux_latency_max_ms=%.3f\n", i,
+                   latency_max / 1000.0);
+    }
+#endif
+
     if (speed < 0) {
         av_bprintf(&buf, " speed=N/A");
         av_bprintf(&buf_script, "speed=N/A\n");
@@ -1896,6 +2436,14 @@ static void flush_encoders(void)
         if (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO)
             continue;
 
+#if HAVE_THREADS
+        if (ost->enc_thread_queue) {
+            if (finish_encoder_thread(ost) < 0)
+                exit_program(1);
+            continue;
+        }
+#endif
+
         for (;;) {
             const char *desc = NULL;
             AVPacket pkt;
@@ -1942,7 +2490,7 @@ static void flush_encoders(void)
                 output_packet(of, &pkt, ost, 1);
                 break;
             }
-            if (ost->finished & MUXER_FINISHED) {
+            if (atomic_load(&ost->finished) & MUXER_FINISHED) {
                 av_packet_unref(&pkt);
                 continue;
             }
@@ -1967,7 +2515,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (atomic_load(&ost->finished))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -2957,8 +3505,11 @@ static int check_init_output_file(OutputFile *of, int file_index)
 
     of->ctx->interrupt_callback = int_cb;
 
+    lock_output_file(of);
+
     ret = avformat_write_header(of->ctx, &of->opts);
     if (ret < 0) {
+        unlock_output_file(of);
         av_log(NULL, AV_LOG_ERROR,
                "Could not write header for output file #%d "
                "(incorrect codec parameters ?): %s\n",
@@ -2973,6 +3524,14 @@ static int check_init_output_file(OutputFile *of, int file_index)
     if (sdp_filename || want_sdp)
         print_sdp();
 
+#if HAVE_THREADS
+    ret = init_mux_thread(of);
+    if (ret < 0) {
+        unlock_output_file(of);
+        return ret;
+    }
+#endif
+
     /* flush the muxing queues */
     for (i = 0; i < of->ctx->nb_streams; i++) {
         OutputStream *ost = output_streams[of->ost_index + i];
@@ -2984,10 +3543,16 @@ static int check_init_output_file(OutputFile *of, int file_index)
         while (av_fifo_size(ost->muxing_queue)) {
             AVPacket pkt;
             av_fifo_generic_read(ost->muxing_queue, &pkt, sizeof(pkt), NULL);
-            write_packet(of, &pkt, ost, 1);
+            ret = write_packet(of, &pkt, ost, 1);
+            if (ret < 0) {
+                unlock_output_file(of);
+                exit_program(1);
+            }
         }
     }
 
+    unlock_output_file(of);
+
     return 0;
 }
 
@@ -3597,6 +4162,17 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
     if (ret < 0)
         return ret;
 
+#if HAVE_THREADS
+    if (ost->encoding_needed) {
+        ret = init_encoder_thread(ost);
+        if (ret < 0) {
+            snprintf(error, error_len, "Could not start the encoder thread "
+                     "for output stream #%d:%d", ost->file_index, ost->index);
+            return ret;
+        }
+    }
+#endif
+
     ost->initialized = 1;
 
     ret = check_init_output_file(output_files[ost->file_index], ost->file_index);
@@ -3802,11 +4378,17 @@ static int need_output(void)
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
+        int frame_number;
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (atomic_load(&ost->finished) ||
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+
+        /* counted in write_packet(), possibly by an encoder thread */
+        lock_output_file(of);
+        frame_number = ost->frame_number;
+        unlock_output_file(of);
+        if (frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3819,6 +4401,22 @@ static int need_output(void)
     return 0;
 }
 
+/*
+ * dts of the last packet muxed or queued for muxing in an output stream.
+ * The muxer updates st->cur_dts from the encoder or writer threads.
+ */
+static int64_t output_stream_dts(OutputStream *ost)
+{
+    OutputFile *of = output_files[ost->file_index];
+    int64_t dts;
+
+    lock_output_file(of);
+    dts = of->mux_thread_queue ? ost->mux_queued_dts : ost->st->cur_dts;
+    unlock_output_file(of);
+
+    return dts;
+}
+
 /**
  * Select the output stream to process.
  *
@@ -3832,18 +4430,19 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
-                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+        int64_t dts  = output_stream_dts(ost);
+        int64_t opts = dts == AV_NOPTS_VALUE ? INT64_MIN :
+                       av_rescale_q(dts, ost->st->time_base,
                                     AV_TIME_BASE_Q);
-        if (ost->st->cur_dts == AV_NOPTS_VALUE)
+        if (dts == AV_NOPTS_VALUE)
             av_log(NULL, AV_LOG_DEBUG,
                 "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
-                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, ost->finished);
+                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, atomic_load(&ost->finished));
 
         if (!ost->initialized && !ost->inputs_done)
             return ost;
 
-        if (!ost->finished && opts < opts_min) {
+        if (!atomic_load(&ost->finished) && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost->unavailable ? NULL : ost;
         }
@@ -4621,6 +5220,64 @@ static int transcode_step(void)
     return reap_filters(0);
 }
 
+static void print_filter_profile(void)
+{
+    int i, j, k;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+        int64_t total = 0, pool_total = 0;
+
+        if (!graph)
+            continue;
+
+        for (j = 0; j < graph->nb_filters; j++)
+            total += graph->filters[j]->activate_time;
+
+        av_log(NULL, AV_LOG_INFO, "Filtergraph #%d profile:\n", i);
+        av_log(NULL, AV_LOG_INFO, "  %-24s %-16s %10s %6s %11s %10s %10s\n",
+               "filter", "type", "time [ms]", "%", "activations",
+               "frames in", "frames out");
+        for (j = 0; j < graph->nb_filters; j++) {
+            AVFilterContext *f = graph->filters[j];
+            int64_t frames_in = 0, frames_out = 0;
+
+            for (k = 0; k < f->nb_inputs; k++)
+                frames_in += f->inputs[k] ? f->inputs[k]->frame_count_out : 0;
+            for (k = 0; k < f->nb_outputs; k++)
+                frames_out += f->outputs[k] ? f->outputs[k]->frame_count_in : 0;
+
+            av_log(NULL, AV_LOG_INFO, "  %-24s %-16s %10.3f %6.2f %11"PRId64" %10"PRId64" %10"PRId64"\n",
+                   f->name, f->filter->name, f->activate_time / 1000.0,
+                   total ? 100.0 * f->activate_time / total : 0.0,
+                   f->nb_activations, frames_in, frames_out);
+        }
+
+        av_log(NULL, AV_LOG_INFO, "  %-56s %10s %10s %10s\n",
+               "link", "frames", "max queued", "pool [KiB]");
+        for (j = 0; j < graph->nb_filters; j++) {
+            AVFilterContext *f = graph->filters[j];
+
+            for (k = 0; k < f->nb_outputs; k++) {
+                AVFilterLink *l = f->outputs[k];
+                char name[256];
+
+                if (!l)
+                    continue;
+                snprintf(name, sizeof(name), "%s:%s -> %s:%s",
+                         l->src->name, avfilter_pad_get_name(l->srcpad, 0),
+                         l->dst->name, avfilter_pad_get_name(l->dstpad, 0));
+                av_log(NULL, AV_LOG_INFO, "  %-56s %10"PRId64" %10"PRId64" %10"PRId64"\n",
+                       name, l->frame_count_in, l->max_queued_frames,
+                       l->pool_bytes >> 10);
+                pool_total += l->pool_bytes;
+            }
+        }
+        av_log(NULL, AV_LOG_INFO, "  %-56s %10s %10s %10"PRId64"\n",
+               "total", "", "", pool_total >> 10);
+    }
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -4696,6 +5353,16 @@ static int transcode(void)
                    i, os->url);
             continue;
         }
+#if HAVE_THREADS
+        if ((ret = finish_mux_thread(output_files[i])) < 0) {
+            /* the packets queued after the error were not written */
+            av_log(NULL, AV_LOG_ERROR, "Error writing packets to %s: %s\n",
+                   os->url, av_err2str(ret));
+            atomic_store(&main_return_code, 1);
+            if (exit_on_error)
+                exit_program(1);
+        }
+#endif
         if ((ret = av_write_trailer(os)) < 0) {
             av_log(NULL, AV_LOG_ERROR, "Error writing trailer of %s: %s\n", os->url, av_err2str(ret));
             if (exit_on_error)
@@ -4706,6 +5373,9 @@ static int transcode(void)
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
 
+    if (filter_profile)
+        print_filter_profile();
+
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
         ost = output_streams[i];
@@ -4884,6 +5554,6 @@ int main(int argc, char **argv)
     if ((decode_error_stat[0] + decode_error_stat[1]) * max_error_rate < decode_error_stat[1])
         exit_program(69);
 
-    exit_program(received_nb_signals ? 255 : main_return_code);
-    return main_return_code;
+    exit_program(received_nb_signals ? 255 : atomic_load(&main_return_code));
+    return atomic_load(&main_return_code);
 }
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
+#include <stdatomic.h>
 
 #include "cmdutils.h"
 
@@ -151,6 +152,8 @@ typedef struct OptionsContext {
     uint64_t limit_filesize;
     float mux_preload;
     float mux_max_delay;
+    int mux_thread_queue_size;
+    const char *mux_thread_drop;
     int shortest;
     int bitexact;
 
@@ -215,6 +218,8 @@ typedef struct OptionsContext {
     int        nb_passlogfiles;
     SpecifierOpt *max_muxing_queue_size;
     int        nb_max_muxing_queue_size;
+    SpecifierOpt *enc_thread_queue_size;
+    int        nb_enc_thread_queue_size;
     SpecifierOpt *guess_layout_max;
     int        nb_guess_layout_max;
     SpecifierOpt *apad;
@@ -509,7 +514,8 @@ typedef struct OutputStream {
     AVDictionary *swr_opts;
     AVDictionary *resample_opts;
     char *apad;
-    OSTFinished finished;        /* no more packets should be written for this stream */
+    atomic_int finished;         /* OSTFinished flags, no more packets should be written for this stream;
+                                    atomic as encoder threads may set them */
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
 
@@ -549,8 +555,30 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    /* drop packets until the next keyframe, after packets were dropped from
+     * the queue of the writer thread */
+    int mux_resync;
+    /* dts of the last packet queued to the writer thread, in the stream time
+     * base; st->cur_dts belongs to that thread.  Protected by the mux_lock. */
+    int64_t mux_queued_dts;
+    /* end pts of the stream in the muxer, published by the writer thread.
+     * Protected by the mux_stats_lock. */
+    int64_t mux_end_pts;
+
+    int enc_thread_queue_size;  /* maximum number of frames queued to the encoder thread */
+    AVThreadMessageQueue *enc_thread_queue;
+#if HAVE_THREADS
+    pthread_t enc_thread;       /* thread running the encoder of this stream */
+#endif
 } OutputStream;
 
+enum MuxThreadDrop {
+    MUX_THREAD_DROP_NONE,   ///< block until the writer thread catches up
+    MUX_THREAD_DROP_NEW,    ///< drop the incoming packet
+    MUX_THREAD_DROP_OLD,    ///< drop all the packets waiting in the queue
+};
+
 typedef struct OutputFile {
     AVFormatContext *ctx;
     AVDictionary *opts;
@@ -562,6 +590,25 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+    int mux_thread_queue_size;  /* maximum number of packets queued to the writer thread */
+    enum MuxThreadDrop mux_thread_drop;
+    AVThreadMessageQueue *mux_thread_queue;
+    int64_t mux_dropped;        /* packets dropped because the queue was full */
+
+#if HAVE_THREADS
+    pthread_mutex_t mux_lock;   /* serializes muxing between encoder threads */
+    pthread_t mux_lock_owner;
+    int mux_locked;
+
+    pthread_t mux_thread;       /* thread calling the muxer */
+    pthread_mutex_t mux_stats_lock;
+    /* statistics updated by the writer thread, protected by mux_stats_lock */
+    int64_t mux_written;        /* packets written */
+    int64_t mux_size;           /* bytes written */
+    int64_t mux_latency_sum;    /* time spent by the packets in the queue and the muxer, in microseconds */
+    int64_t mux_latency_max;
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -608,6 +655,9 @@ extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
+extern int filter_shared_threads;
+extern int filter_fuse_scalers;
+extern int filter_profile;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 
@@ -1018,6 +1018,9 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->shared_threads = filter_shared_threads;
+    fg->graph->fuse_scalers   = filter_fuse_scalers;
+    fg->graph->profile        = filter_profile;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
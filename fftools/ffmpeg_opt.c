@@ -86,6 +86,7 @@ static const char *opt_name_canvas_sizes[]              = {"canvas_size", NULL};
 static const char *opt_name_pass[]                      = {"pass", NULL};
 static const char *opt_name_passlogfiles[]              = {"passlogfile", NULL};
 static const char *opt_name_max_muxing_queue_size[]     = {"max_muxing_queue_size", NULL};
+static const char *opt_name_enc_thread_queue_size[]     = {"enc_thread_queue_size", NULL};
 static const char *opt_name_guess_layout_max[]          = {"guess_layout_max", NULL};
 static const char *opt_name_apad[]                      = {"apad", NULL};
 static const char *opt_name_discard[]                   = {"discard", NULL};
@@ -170,6 +171,9 @@ int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
+int filter_shared_threads = 0;
+int filter_fuse_scalers = 0;
+int filter_profile = 0;
 int vstats_version = 2;
 
 
@@ -1559,6 +1563,8 @@ static OutputStream *new_output_stream(OptionsContext *o, AVFormatContext *oc, e
     MATCH_PER_STREAM_OPT(max_muxing_queue_size, i, ost->max_muxing_queue_size, oc, st);
     ost->max_muxing_queue_size *= sizeof(AVPacket);
 
+    MATCH_PER_STREAM_OPT(enc_thread_queue_size, i, ost->enc_thread_queue_size, oc, st);
+
     if (oc->oformat->flags & AVFMT_GLOBALHEADER)
         ost->enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
@@ -1577,6 +1583,8 @@ static OutputStream *new_output_stream(OptionsContext *o, AVFormatContext *oc, e
         input_streams[source_index]->st->discard = input_streams[source_index]->user_set_discard;
     }
     ost->last_mux_dts = AV_NOPTS_VALUE;
+    ost->mux_queued_dts = AV_NOPTS_VALUE;
+    ost->mux_end_pts = AV_NOPTS_VALUE;
 
     ost->muxing_queue = av_fifo_alloc(8 * sizeof(AVPacket));
     if (!ost->muxing_queue)
@@ -1966,7 +1974,7 @@ static OutputStream *new_attachment_stream(OptionsContext *o, AVFormatContext *o
 {
     OutputStream *ost = new_output_stream(o, oc, AVMEDIA_TYPE_ATTACHMENT, source_index);
     ost->stream_copy = 1;
-    ost->finished    = 1;
+    atomic_store(&ost->finished, 1);
     return ost;
 }
 
@@ -2148,14 +2156,40 @@ static int open_output_file(OptionsContext *o, const char *filename)
     if (!of)
         exit_program(1);
     output_files[nb_output_files - 1] = of;
+#if HAVE_THREADS
+    pthread_mutex_init(&of->mux_lock, NULL);
+    pthread_mutex_init(&of->mux_stats_lock, NULL);
+#endif
 
     of->ost_index      = nb_output_streams;
     of->recording_time = o->recording_time;
     of->start_time     = o->start_time;
     of->limit_filesize = o->limit_filesize;
     of->shortest       = o->shortest;
+    of->mux_thread_queue_size = o->mux_thread_queue_size;
     av_dict_copy(&of->opts, o->g->format_opts, 0);
 
+    if (o->mux_thread_drop) {
+        if (!strcmp(o->mux_thread_drop, "none"))
+            of->mux_thread_drop = MUX_THREAD_DROP_NONE;
+        else if (!strcmp(o->mux_thread_drop, "new"))
+            of->mux_thread_drop = MUX_THREAD_DROP_NEW;
+        else if (!strcmp(o->mux_thread_drop, "old"))
+            of->mux_thread_drop = MUX_THREAD_DROP_OLD;
+        else {
+            av_log(NULL, AV_LOG_FATAL, "Invalid -mux_thread_drop policy: %s\n",
+                   o->mux_thread_drop);
+            exit_program(1);
+        }
+    }
+#if !HAVE_THREADS
+    if (of->mux_thread_queue_size > 0) {
+        av_log(NULL, AV_LOG_WARNING, "-mux_thread_queue_size requires threading "
+               "support, muxing on the main thread.\n");
+        of->mux_thread_queue_size = 0;
+    }
+#endif
+
     if (!strcmp(filename, "-"))
         filename = "pipe:";
 
@@ -3529,6 +3563,12 @@ const OptionDef options[] = {
         "set stream filtergraph", "filter_graph" },
     { "filter_threads",  HAS_ARG | OPT_INT,                          { &filter_nbthreads },
         "number of non-complex filter threads" },
+    { "filter_shared_threads", OPT_BOOL | OPT_EXPERT,               { &filter_shared_threads },
+        "run filter slice threading on the process-wide thread pool" },
+    { "filter_fuse_scalers", OPT_BOOL | OPT_EXPERT,                 { &filter_fuse_scalers },
+        "merge automatic pixel format conversions into scale filters" },
+    { "filter_profile", OPT_BOOL | OPT_EXPERT,                      { &filter_profile },
+        "print per-filter and per-link statistics at the end" },
     { "filter_script",  HAS_ARG | OPT_STRING | OPT_SPEC | OPT_OUTPUT, { .off = OFFSET(filter_scripts) },
         "read stream filtergraph description from a file", "filename" },
     { "reinit_filter",  HAS_ARG | OPT_INT | OPT_SPEC | OPT_INPUT,    { .off = OFFSET(reinit_filters) },
@@ -3721,6 +3761,10 @@ const OptionDef options[] = {
         "set the maximum demux-decode delay", "seconds" },
     { "muxpreload", OPT_FLOAT | HAS_ARG | OPT_EXPERT | OPT_OFFSET | OPT_OUTPUT, { .off = OFFSET(mux_preload) },
         "set the initial demux-decode delay", "seconds" },
+    { "mux_thread_queue_size", HAS_ARG | OPT_INT | OPT_EXPERT | OPT_OFFSET | OPT_OUTPUT, { .off = OFFSET(mux_thread_queue_size) },
+        "run the muxer on its own thread, buffering at most this many packets (0 disables)", "packets" },
+    { "mux_thread_drop", HAS_ARG | OPT_STRING | OPT_EXPERT | OPT_OFFSET | OPT_OUTPUT, { .off = OFFSET(mux_thread_drop) },
+        "what to do when the queue of the writer thread is full (none, new, old)", "policy" },
     { "sdp_file", HAS_ARG | OPT_EXPERT | OPT_OUTPUT, { .func_arg = opt_sdp_file },
         "specify a file in which to print sdp information", "file" },
 
@@ -3750,6 +3794,8 @@ const OptionDef options[] = {
 
     { "max_muxing_queue_size", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(max_muxing_queue_size) },
         "maximum number of packets that can be buffered while waiting for all streams to initialize", "packets" },
+    { "enc_thread_queue_size", HAS_ARG | OPT_INT | OPT_SPEC | OPT_EXPERT | OPT_OUTPUT, { .off = OFFSET(enc_thread_queue_size) },
+        "run the encoder on its own thread, buffering at most this many frames (0 disables)", "frames" },
 
     /* data codec support */
     { "dcodec", HAS_ARG | OPT_DATA | OPT_PERFILE | OPT_EXPERT | OPT_INPUT | OPT_OUTPUT, { .func_arg = opt_data_codec },
@@ -2352,6 +2352,27 @@ typedef struct AVCodecContext {
      * - encoding: set by user
      */
     int export_side_data;
+
+    /**
+     * Run slice threading jobs on the thread pool shared by all the codec
+     * contexts and filter graphs of the process which enable it, instead of
+     * threads private to this context.
+     *
+     * - encoding: set by user
+     * - decoding: set by user
+     */
+    int shared_threads;
+
+    /**
+     * Number of slice threads used by each frame thread, for the codecs
+     * which can run slice threading inside frame threading (e.g. HEVC with
+     * wavefront parallel processing). Values below 2 disable slice threads
+     * when frame threading is active.
+     *
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int slice_threads;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -73,6 +73,14 @@
  * uses ff_thread_report/await_progress().
  */
 #define FF_CODEC_CAP_ALLOCATE_PROGRESS      (1 << 6)
+/**
+ * The codec supports slice threading inside each frame thread, so both can
+ * be active at once. The codec contexts of the frame threads then have both
+ * FF_THREAD_FRAME and FF_THREAD_SLICE set in active_thread_type; their
+ * thread_count stays the number of frame threads, the number of slice threads
+ * is in AVCodecInternal.slice_thread_count.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 7)
 
 /**
  * AVCodec.codec_tags termination value
@@ -134,6 +142,19 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context; separate from thread_ctx so that the codec
+     * contexts of frame threads can have one as well.
+     */
+    void *slice_thread_ctx;
+
+    /**
+     * Number of slice threads actually running. Equal to thread_count with
+     * slice threading alone, set from AVCodecContext.slice_threads in the
+     * codec contexts of frame threads.
+     */
+    int slice_thread_count;
+
     DecodeSimpleContext ds;
     AVBSFContext *bsf;
 
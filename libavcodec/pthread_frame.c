@@ -582,7 +582,10 @@ void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 
     pthread_mutex_lock(&p->progress_mutex);
 
-    atomic_store_explicit(&progress[field], n, memory_order_release);
+    /* with slice threads inside frame threads, progress may be reported
+     * by several threads at once; never let it go backwards */
+    if (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
+        atomic_store_explicit(&progress[field], n, memory_order_release);
 
     pthread_cond_broadcast(&p->progress_cond);
     pthread_mutex_unlock(&p->progress_mutex);
@@ -697,6 +700,9 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         if (codec->close && p->avctx)
             codec->close(p->avctx);
 
+        if (p->avctx && p->avctx->internal->slice_thread_ctx)
+            ff_slice_thread_free(p->avctx);
+
         release_delayed_buffers(p);
         av_frame_free(&p->frame);
     }
@@ -849,6 +855,14 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         if (i)
             copy->internal->is_copy = 1;
 
+        if (codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS &&
+            avctx->thread_type & FF_THREAD_SLICE && avctx->slice_threads > 1) {
+            copy->active_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            err = ff_slice_thread_init(copy);
+            if (err < 0)
+                goto error;
+        }
+
         if (codec->init)
             err = codec->init(copy);
 
@@ -49,6 +49,8 @@ typedef struct SliceThreadContext {
     int *rets;
     int job_size;
 
+    int shared;
+
     int *entries;
     int entries_count;
     int thread_count;
@@ -58,14 +60,14 @@ typedef struct SliceThreadContext {
 
 static void main_function(void *priv) {
     AVCodecContext *avctx = priv;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     c->mainfunc(avctx);
 }
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     AVCodecContext *avctx = priv;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     int ret;
 
     ret = c->func ? c->func(avctx, (char *)c->args + c->job_size * jobnr)
@@ -76,7 +78,7 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
 
 void ff_slice_thread_free(AVCodecContext *avctx)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     int i;
 
     avpriv_slicethread_free(&c->thread);
@@ -89,14 +91,14 @@ void ff_slice_thread_free(AVCodecContext *avctx)
     av_freep(&c->entries);
     av_freep(&c->progress_mutex);
     av_freep(&c->progress_cond);
-    av_freep(&avctx->internal->thread_ctx);
+    av_freep(&avctx->internal->slice_thread_ctx);
 }
 
 static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
 
-    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
+    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->internal->slice_thread_count <= 1)
         return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
 
     if (job_count <= 0)
@@ -113,14 +115,14 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
 
 static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     c->func2 = func2;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
 int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* func2, main_func *mainfunc, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     c->func2 = func2;
     c->mainfunc = mainfunc;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
@@ -129,7 +131,10 @@ int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* f
 int ff_slice_thread_init(AVCodecContext *avctx)
 {
     SliceThreadContext *c;
-    int thread_count = avctx->thread_count;
+    /* the codec context of a frame thread keeps thread_count as the number
+     * of frame threads, its number of slice threads is slice_threads */
+    int frame_thread = avctx->active_thread_type & FF_THREAD_FRAME;
+    int thread_count = frame_thread ? avctx->slice_threads : avctx->thread_count;
     static void (*mainfunc)(void *);
 
     // We cannot do this in the encoder init as the threads are created before
@@ -150,21 +155,31 @@ int ff_slice_thread_init(AVCodecContext *avctx)
     }
 
     if (thread_count <= 1) {
-        avctx->active_thread_type = 0;
+        avctx->active_thread_type &= ~FF_THREAD_SLICE;
         return 0;
     }
 
-    avctx->internal->thread_ctx = c = av_mallocz(sizeof(*c));
+    avctx->internal->slice_thread_ctx = c = av_mallocz(sizeof(*c));
     mainfunc = avctx->codec->caps_internal & FF_CODEC_CAP_SLICE_THREAD_HAS_MF ? &main_function : NULL;
-    if (!c || (thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count)) <= 1) {
+    // the main function waits for the workers, which needs dedicated threads
+    if (c)
+        c->shared = avctx->shared_threads && !mainfunc;
+    if (c && c->shared)
+        thread_count = avpriv_slicethread_create_shared(&c->thread, avctx, worker_func, thread_count);
+    else if (c)
+        thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count);
+    if (!c || thread_count <= 1) {
         if (c)
             avpriv_slicethread_free(&c->thread);
-        av_freep(&avctx->internal->thread_ctx);
-        avctx->thread_count = 1;
-        avctx->active_thread_type = 0;
+        av_freep(&avctx->internal->slice_thread_ctx);
+        if (!frame_thread)
+            avctx->thread_count = 1;
+        avctx->active_thread_type &= ~FF_THREAD_SLICE;
         return 0;
     }
-    avctx->thread_count = thread_count;
+    if (!frame_thread)
+        avctx->thread_count = thread_count;
+    avctx->internal->slice_thread_count = thread_count;
 
     avctx->execute = thread_execute;
     avctx->execute2 = thread_execute2;
@@ -173,7 +188,7 @@ int ff_slice_thread_init(AVCodecContext *avctx)
 
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = avctx->internal->slice_thread_ctx;
     int *entries = p->entries;
 
     pthread_mutex_lock(&p->progress_mutex[thread]);
@@ -184,7 +199,7 @@ void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, in
 
 void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int shift)
 {
-    SliceThreadContext *p  = avctx->internal->thread_ctx;
+    SliceThreadContext *p  = avctx->internal->slice_thread_ctx;
     int *entries      = p->entries;
 
     if (!entries || !field) return;
@@ -203,14 +218,27 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
     int i;
 
     if (avctx->active_thread_type & FF_THREAD_SLICE)  {
-        SliceThreadContext *p = avctx->internal->thread_ctx;
+        SliceThreadContext *p = avctx->internal->slice_thread_ctx;
+
+        /* jobs waiting for each other's progress must all run concurrently,
+         * which the shared pool does not guarantee */
+        if (p->shared) {
+            int ret;
+
+            avpriv_slicethread_free(&p->thread);
+            ret = avpriv_slicethread_create(&p->thread, avctx, worker_func, NULL,
+                                            avctx->internal->slice_thread_count);
+            if (ret < 0)
+                return ret;
+            p->shared = 0;
+        }
 
         if (p->entries) {
-            av_assert0(p->thread_count == avctx->thread_count);
+            av_assert0(p->thread_count == avctx->internal->slice_thread_count);
             av_freep(&p->entries);
         }
 
-        p->thread_count  = avctx->thread_count;
+        p->thread_count  = avctx->internal->slice_thread_count;
         p->entries       = av_mallocz_array(count, sizeof(int));
 
         if (!p->progress_mutex) {
@@ -237,6 +265,6 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
 
 void ff_reset_entries(AVCodecContext *avctx)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = avctx->internal->slice_thread_ctx;
     memset(p->entries, 0, p->entries_count * sizeof(int));
 }
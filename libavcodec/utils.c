@@ -1021,7 +1021,7 @@ free_and_end:
          (avctx->codec->caps_internal & FF_CODEC_CAP_INIT_CLEANUP)))
         avctx->codec->close(avctx);
 
-    if (HAVE_THREADS && avci->thread_ctx)
+    if (HAVE_THREADS && (avci->thread_ctx || avci->slice_thread_ctx))
         ff_thread_free(avctx);
 
     if (codec->priv_class && codec->priv_data_size)
@@ -1130,7 +1130,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
             avctx->internal->frame_thread_encoder && avctx->thread_count > 1) {
             ff_frame_thread_encoder_free(avctx);
         }
-        if (HAVE_THREADS && avctx->internal->thread_ctx)
+        if (HAVE_THREADS && (avctx->internal->thread_ctx ||
+                             avctx->internal->slice_thread_ctx))
             ff_thread_free(avctx);
         if (avctx->codec && avctx->codec->close)
             avctx->codec->close(avctx);
@@ -1959,20 +1960,20 @@ const uint8_t *avpriv_find_start_code(const uint8_t *av_restrict p,
             return p;
     }
 
-    while (p < end) {
-        if      (p[-1] > 1      ) p += 3;
-        else if (p[-2]          ) p += 2;
-        else if (p[-3]|(p[-1]-1)) p++;
-        else {
-            p++;
-            break;
+    /* Look for the 0x01 byte of a start code, which is much rarer than
+     * zero bytes in coded data, with memchr() as it is usually faster than
+     * any byte loop. It must not be the last byte, as the byte after the
+     * start code is returned in state. */
+    for (p--; (p = memchr(p, 1, end - 1 - p)); p++) {
+        if (!p[-1] && !p[-2]) {
+            *state = AV_RB32(p - 2);
+            return p + 2;
         }
     }
 
-    p = FFMIN(p, end) - 4;
-    *state = AV_RB32(p);
+    *state = AV_RB32(end - 4);
 
-    return p + 4;
+    return end;
 }
 
 AVCPBProperties *av_cpb_properties_alloc(size_t *size)
@@ -62,6 +62,8 @@ typedef struct LoudNormContext {
     int linear;
     int dual_mono;
     enum PrintFormat print_format;
+    int analyze;
+    int true_peak;
 
     double *buf;
     int buf_size;
@@ -119,6 +121,8 @@ static const AVOption loudnorm_options[] = {
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, "print_format" },
     {     "json",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  JSON},     0,         0,  FLAGS, "print_format" },
     {     "summary",      0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  SUMMARY},  0,         0,  FLAGS, "print_format" },
+    { "analyze",          "only measure the input",            OFFSET(analyze),          AV_OPT_TYPE_BOOL,    {.i64 =  0},        0,         1,  FLAGS },
+    { "true_peak",        "measure true peak at 192 kHz",      OFFSET(true_peak),        AV_OPT_TYPE_BOOL,    {.i64 =  0},        0,         1,  FLAGS },
     { NULL }
 };
 
@@ -406,6 +410,22 @@ static void true_peak_limiter(LoudNormContext *s, double *out, int nb_samples, i
     }
 }
 
+static void analyze_frame(LoudNormContext *s, AVFrame *in)
+{
+    const int n = in->nb_samples;
+
+    switch (in->format) {
+    case AV_SAMPLE_FMT_S16:  ff_ebur128_add_frames_short (s->r128_in, (const short  *)in->data[0], n);           break;
+    case AV_SAMPLE_FMT_S32:  ff_ebur128_add_frames_int   (s->r128_in, (const int    *)in->data[0], n);           break;
+    case AV_SAMPLE_FMT_FLT:  ff_ebur128_add_frames_float (s->r128_in, (const float  *)in->data[0], n);           break;
+    case AV_SAMPLE_FMT_DBL:  ff_ebur128_add_frames_double(s->r128_in, (const double *)in->data[0], n);           break;
+    case AV_SAMPLE_FMT_S16P: ff_ebur128_add_frames_planar_short (s->r128_in, (const short  **)in->extended_data, n, 1); break;
+    case AV_SAMPLE_FMT_S32P: ff_ebur128_add_frames_planar_int   (s->r128_in, (const int    **)in->extended_data, n, 1); break;
+    case AV_SAMPLE_FMT_FLTP: ff_ebur128_add_frames_planar_float (s->r128_in, (const float  **)in->extended_data, n, 1); break;
+    case AV_SAMPLE_FMT_DBLP: ff_ebur128_add_frames_planar_double(s->r128_in, (const double **)in->extended_data, n, 1); break;
+    }
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -420,6 +440,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     double gain, gain_next, env_global, env_shortterm,
     global, shortterm, lra, relative_threshold;
 
+    if (s->analyze) {
+        analyze_frame(s, in);
+        return ff_filter_frame(outlink, in);
+    }
+
     if (av_frame_is_writable(in)) {
         out = in;
     } else {
@@ -694,6 +719,13 @@ static int query_formats(AVFilterContext *ctx)
         AV_SAMPLE_FMT_DBL,
         AV_SAMPLE_FMT_NONE
     };
+    static const enum AVSampleFormat analyze_sample_fmts[] = {
+        AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P,
+        AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
+        AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP,
+        AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_DBLP,
+        AV_SAMPLE_FMT_NONE
+    };
     int ret;
 
     layouts = ff_all_channel_counts();
@@ -703,14 +735,14 @@ static int query_formats(AVFilterContext *ctx)
     if (ret < 0)
         return ret;
 
-    formats = ff_make_format_list(sample_fmts);
+    formats = ff_make_format_list(s->analyze ? analyze_sample_fmts : sample_fmts);
     if (!formats)
         return AVERROR(ENOMEM);
     ret = ff_set_common_formats(ctx, formats);
     if (ret < 0)
         return ret;
 
-    if (s->frame_type != LINEAR_MODE) {
+    if (s->analyze ? s->true_peak : s->frame_type != LINEAR_MODE) {
         formats = ff_make_format_list(input_srate);
         if (!formats)
             return AVERROR(ENOMEM);
@@ -734,14 +766,19 @@ static int config_input(AVFilterLink *inlink)
     if (!s->r128_in)
         return AVERROR(ENOMEM);
 
+    if (inlink->channels == 1 && s->dual_mono)
+        ff_ebur128_set_channel(s->r128_in, 0, FF_EBUR128_DUAL_MONO);
+
+    s->channels = inlink->channels;
+    if (s->analyze)
+        return 0;
+
     s->r128_out = ff_ebur128_init(inlink->channels, inlink->sample_rate, 0, FF_EBUR128_MODE_I | FF_EBUR128_MODE_S | FF_EBUR128_MODE_LRA | FF_EBUR128_MODE_SAMPLE_PEAK);
     if (!s->r128_out)
         return AVERROR(ENOMEM);
 
-    if (inlink->channels == 1 && s->dual_mono) {
-        ff_ebur128_set_channel(s->r128_in,  0, FF_EBUR128_DUAL_MONO);
+    if (inlink->channels == 1 && s->dual_mono)
         ff_ebur128_set_channel(s->r128_out, 0, FF_EBUR128_DUAL_MONO);
-    }
 
     s->buf_size = frame_size(inlink->sample_rate, 3000) * inlink->channels;
     s->buf = av_malloc_array(s->buf_size, sizeof(*s->buf));
@@ -769,7 +806,6 @@ static int config_input(AVFilterLink *inlink)
     s->buf_index =
     s->prev_buf_index =
     s->limiter_buf_index = 0;
-    s->channels = inlink->channels;
     s->index = 1;
     s->limiter_state = OUT;
     s->offset = pow(10., s->offset / 20.);
@@ -804,10 +840,12 @@ static av_cold int init(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     LoudNormContext *s = ctx->priv;
+    /* the audio is passed through unchanged when only analyzing */
+    FFEBUR128State *r128_out = s->analyze ? s->r128_in : s->r128_out;
     double i_in, i_out, lra_in, lra_out, thresh_in, thresh_out, tp_in, tp_out;
     int c;
 
-    if (!s->r128_in || !s->r128_out)
+    if (!s->r128_in || !r128_out)
         goto end;
 
     ff_ebur128_loudness_range(s->r128_in, &lra_in);
@@ -820,12 +858,12 @@ static av_cold void uninit(AVFilterContext *ctx)
             tp_in = tmp;
     }
 
-    ff_ebur128_loudness_range(s->r128_out, &lra_out);
-    ff_ebur128_loudness_global(s->r128_out, &i_out);
-    ff_ebur128_relative_threshold(s->r128_out, &thresh_out);
+    ff_ebur128_loudness_range(r128_out, &lra_out);
+    ff_ebur128_loudness_global(r128_out, &i_out);
+    ff_ebur128_relative_threshold(r128_out, &thresh_out);
     for (c = 0; c < s->channels; c++) {
         double tmp;
-        ff_ebur128_sample_peak(s->r128_out, c, &tmp);
+        ff_ebur128_sample_peak(r128_out, c, &tmp);
         if ((c == 0) || (tmp > tp_out))
             tp_out = tmp;
     }
@@ -856,7 +894,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "linear" : "dynamic",
+            s->analyze ? "none" : s->frame_type == LINEAR_MODE ? "linear" : "dynamic",
             s->target_i - i_out
         );
         break;
@@ -884,7 +922,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "Linear" : "Dynamic",
+            s->analyze ? "None" : s->frame_type == LINEAR_MODE ? "Linear" : "Dynamic",
             s->target_i - i_out
         );
         break;
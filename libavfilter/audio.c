@@ -39,12 +39,14 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
     AVFrame *frame = NULL;
     int channels = link->channels;
+    int64_t allocated;
 
     av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
 
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
-                                                    nb_samples, link->format, BUFFER_ALIGN);
+                                                    nb_samples, link->format, BUFFER_ALIGN,
+                                                    ff_filter_link_buffer_pools(link));
         if (!link->frame_pool)
             return NULL;
     } else {
@@ -64,15 +66,17 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
 
             ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
             link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
-                                                        nb_samples, link->format, BUFFER_ALIGN);
+                                                        nb_samples, link->format, BUFFER_ALIGN,
+                                                        ff_filter_link_buffer_pools(link));
             if (!link->frame_pool)
                 return NULL;
         }
     }
 
-    frame = ff_frame_pool_get(link->frame_pool);
+    frame = ff_frame_pool_get(link->frame_pool, &allocated);
     if (!frame)
         return NULL;
+    link->pool_bytes += allocated;
 
     frame->nb_samples = nb_samples;
     frame->channel_layout = link->channel_layout;
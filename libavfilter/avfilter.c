@@ -33,6 +33,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -42,6 +43,7 @@
 #include "filters.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 
 #include "libavutil/ffversion.h"
 const char av_filter_ffversion[] = "FFmpeg version " FFMPEG_VERSION;
@@ -232,6 +234,11 @@ void ff_avfilter_link_set_out_status(AVFilterLink *link, int status, int64_t pts
     ff_filter_set_ready(link->src, 200);
 }
 
+size_t avfilter_link_get_queued_frames(AVFilterLink *link)
+{
+    return ff_framequeue_queued_frames(&link->fifo);
+}
+
 void avfilter_link_set_closed(AVFilterLink *link, int closed)
 {
     ff_avfilter_link_set_out_status(link, closed ? AVERROR_EOF : 0, AV_NOPTS_VALUE);
@@ -552,6 +559,8 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
     }else if(!strcmp(cmd, "enable")) {
         return set_enable_expr(filter, arg);
     }else if(filter->filter->process_command) {
+        /* Frame threads' jobs read the private context. */
+        ff_filter_frame_thread_wait(filter);
         return filter->filter->process_command(filter, cmd, arg, res, res_len, flags);
     }
     return AVERROR(ENOSYS);
@@ -611,6 +620,7 @@ static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -749,6 +759,8 @@ void avfilter_free(AVFilterContext *filter)
     if (filter->graph)
         ff_filter_graph_remove_filter(filter->graph, filter);
 
+    ff_filter_frame_thread_free(filter);
+
     if (filter->filter->uninit)
         filter->filter->uninit(filter);
 
@@ -889,7 +901,13 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
-    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
+    if (ctx->filter->flags & AVFILTER_FLAG_FRAME_THREADS &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME &&
+        (ret = ff_filter_frame_thread_init(ctx))) {
+        if (ret < 0)
+            return ret;
+        ctx->thread_type = AVFILTER_THREAD_FRAME;
+    } else if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
@@ -1115,6 +1133,8 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    link->max_queued_frames = FFMAX(link->max_queued_frames,
+                                    ff_framequeue_queued_frames(&link->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1278,6 +1298,75 @@ static int ff_filter_activate_default(AVFilterContext *filter)
     return FFERROR_NOT_READY;
 }
 
+/**
+ * Activation of a filter using frame threads: same as the default, except
+ * that the frames are filtered in the worker threads, and their output is
+ * forwarded in order once ready. Output is never waited for, unless all
+ * the threads are busy, or the input status or a command must be
+ * processed.
+ */
+static int ff_filter_activate_frame_threads(AVFilterContext *filter)
+{
+    AVFilterLink *inlink = filter->inputs[0];
+    int nb_slots = ff_filter_get_nb_threads(filter);
+    int ret;
+
+    ret = ff_filter_frame_thread_output(filter, INT_MAX);
+    if (ret < 0)
+        goto fail;
+
+    while (ff_inlink_check_available_frame(inlink)) {
+        int (*filter_frame)(AVFilterLink *, AVFrame *);
+        AVFilterCommand *cmd = filter->command_queue;
+        AVFrame *frame = ff_inlink_peek_frame(inlink, 0);
+
+        /* Commands due at this frame change the filter state: the jobs
+         * using the previous one must be finished first. Otherwise only
+         * wait for a free thread. */
+        ret = ff_filter_frame_thread_output(filter,
+                  cmd && cmd->time <= frame->pts * av_q2d(inlink->time_base) ?
+                  0 : nb_slots - 1);
+        if (ret < 0)
+            goto fail;
+
+        /* This processes the commands and evaluates the timeline. */
+        ff_inlink_consume_frame(inlink, &frame);
+        filter_unblock(filter);
+
+        if (inlink->dstpad->needs_writable) {
+            ret = ff_inlink_make_frame_writable(inlink, &frame);
+            if (ret < 0) {
+                av_frame_free(&frame);
+                goto fail;
+            }
+        }
+        if (!(filter_frame = inlink->dstpad->filter_frame) ||
+            (filter->is_disabled &&
+             (filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC)))
+            filter_frame = default_filter_frame;
+
+        /* As in ff_filter_frame_to_filter() */
+        inlink->frame_count_out--;
+        ret = ff_filter_frame_thread_submit(filter, filter_frame, frame);
+        inlink->frame_count_out++;
+        if (ret < 0)
+            goto fail;
+    }
+
+    if (inlink->status_in && !inlink->status_out) {
+        ret = ff_filter_frame_thread_output(filter, 0);
+        if (ret < 0)
+            goto fail;
+    }
+
+    return ff_filter_activate_default(filter);
+
+fail:
+    if (ret != inlink->status_out)
+        ff_avfilter_link_set_out_status(inlink, ret, AV_NOPTS_VALUE);
+    return ret;
+}
+
 /*
    Filter scheduling and activation
 
@@ -1415,14 +1504,25 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
 int ff_filter_activate(AVFilterContext *filter)
 {
+    const int profile = filter->graph->profile;
+    int64_t start = 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
-    ret = filter->filter->activate ? filter->filter->activate(filter) :
-          ff_filter_activate_default(filter);
+    if (profile)
+        start = av_gettime_relative();
+    if (filter->filter->activate)
+        ret = filter->filter->activate(filter);
+    else if (filter->internal->frame_thread && !filter->inputs[0]->min_samples)
+        ret = ff_filter_activate_frame_threads(filter);
+    else
+        ret = ff_filter_activate_default(filter);
+    if (profile)
+        filter->activate_time += av_gettime_relative() - start;
+    filter->nb_activations++;
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -114,6 +114,14 @@ enum AVMediaType avfilter_pad_get_type(const AVFilterPad *pads, int pad_idx);
  * and processing them concurrently.
  */
 #define AVFILTER_FLAG_SLICE_THREADS         (1 << 2)
+/**
+ * The filter supports multithreading by processing several frames
+ * concurrently. Its filter_frame() callback must not modify the filter
+ * private context, and must output any frame it produces before returning.
+ * Only filters with one input and one output and no activate() callback
+ * may set this flag.
+ */
+#define AVFILTER_FLAG_FRAME_THREADS         (1 << 3)
 /**
  * Some filters support a generic "enable" expression option that can be used
  * to enable or disable a filter in the timeline. Filters supporting this
@@ -331,6 +339,11 @@ typedef struct AVFilter {
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Process several frames concurrently. This adds some delay, and is only
+ * used for filters which explicitly allow it.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -360,7 +373,8 @@ struct AVFilterContext {
      *
      * May be set by the caller before initializing the filter to forbid some
      * or all kinds of multithreading for this filter. The default is allowing
-     * everything.
+     * everything except AVFILTER_THREAD_FRAME, which must be requested
+     * explicitly.
      *
      * When the filter is initialized, this field is combined using bit AND with
      * AVFilterGraph.thread_type to get the final mask used for determining
@@ -422,6 +436,19 @@ struct AVFilterContext {
      * configured.
      */
     int extra_hw_frames;
+
+    /**
+     * Cumulative time spent processing frames in this filter, i.e. in its
+     * activate() callback or in the filter_frame() and request_frame()
+     * callbacks of its pads, in microseconds. Only measured while
+     * AVFilterGraph.profile is set. Set by libavfilter.
+     */
+    int64_t activate_time;
+
+    /**
+     * Number of times this filter was activated. Set by libavfilter.
+     */
+    int64_t nb_activations;
 };
 
 /**
@@ -600,6 +627,18 @@ struct AVFilterLink {
      */
     AVBufferRef *hw_frames_ctx;
 
+    /**
+     * Total size in bytes of the buffers allocated from the frame pool of
+     * this link, see ff_get_video_buffer() and ff_get_audio_buffer().
+     */
+    int64_t pool_bytes;
+
+    /**
+     * Highest number of frames queued on this link at once, waiting to be
+     * processed by the destination filter.
+     */
+    int64_t max_queued_frames;
+
 #ifndef FF_INTERNAL_FIELDS
 
     /**
@@ -672,6 +711,12 @@ attribute_deprecated
 int avfilter_link_get_channels(AVFilterLink *link);
 #endif
 
+/**
+ * Get the number of frames currently queued on a link, waiting to be
+ * processed by the destination filter.
+ */
+size_t avfilter_link_get_queued_frames(AVFilterLink *link);
+
 /**
  * Set the closed field of a link.
  * @deprecated applications are not supposed to mess with links, they should
@@ -907,6 +952,30 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * Run slice threading jobs on the thread pool shared by all the filter
+     * graphs and codec contexts of the process which enable it, instead of
+     * threads private to this graph. May be set by the caller before adding
+     * any filters to the filtergraph.
+     */
+    int shared_threads;
+
+    /**
+     * Let scale filters do the pixel format conversions of the neighbouring
+     * automatically inserted scalers, when only filters not depending on
+     * the exact pixel format separate them. This saves a pass over each
+     * frame, but the output is not bitexact with the separate conversion.
+     * May be set by the caller before avfilter_graph_config().
+     */
+    int fuse_scalers;
+
+    /**
+     * Measure the time spent in each filter of the graph, see
+     * AVFilterContext.activate_time. This costs two clock reads per
+     * activation. May be set by the caller at any point.
+     */
+    int profile;
 } AVFilterGraph;
 
 /**
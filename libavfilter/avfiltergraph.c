@@ -48,10 +48,17 @@
 #define A AV_OPT_FLAG_AUDIO_PARAM
 static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
+    { "shared_threads", "Use the process-wide thread pool", OFFSET(shared_threads),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
+    { "fuse_scalers", "Merge automatic pixel format conversions into scale filters", OFFSET(fuse_scalers),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V },
+    { "profile", "Measure the time spent in each filter", OFFSET(profile),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -78,6 +85,32 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+}
+
+int ff_filter_frame_thread_submit(AVFilterContext *ctx,
+                                  int (*filter_frame)(AVFilterLink *, AVFrame *),
+                                  AVFrame *frame)
+{
+    av_frame_free(&frame);
+    return AVERROR(ENOSYS);
+}
+
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int max_pending)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_wait(AVFilterContext *ctx)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -92,6 +125,13 @@ AVFilterGraph *avfilter_graph_alloc(void)
         return NULL;
     }
 
+    ret->internal->buffer_pools = ff_buffer_pool_set_alloc(av_buffer_allocz);
+    if (!ret->internal->buffer_pools) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
@@ -126,6 +166,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
         avfilter_free((*graph)->filters[0]);
 
     ff_graph_thread_free(*graph);
+    ff_buffer_pool_set_free(&(*graph)->internal->buffer_pools);
 
     av_freep(&(*graph)->sink_links);
 
@@ -1266,6 +1307,150 @@ static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+static int is_scale(AVFilterContext *f)
+{
+    return !strcmp(f->filter->name, "scale");
+}
+
+/**
+ * Check if f is an automatically inserted scaler which only converts the
+ * pixel format, without changing the color model: merging RGB<->YUV
+ * conversions into scaling loses precision in swscale.
+ */
+static int is_auto_converter(AVFilterContext *f)
+{
+    const AVPixFmtDescriptor *in, *out;
+
+    if (!is_scale(f) || !av_strstart(f->name, "auto_scaler_", NULL) ||
+        f->inputs[0]->w      != f->outputs[0]->w ||
+        f->inputs[0]->h      != f->outputs[0]->h ||
+        f->inputs[0]->format == f->outputs[0]->format)
+        return 0;
+
+    in  = av_pix_fmt_desc_get(f->inputs[0]->format);
+    out = av_pix_fmt_desc_get(f->outputs[0]->format);
+    return !((in->flags ^ out->flags) & AV_PIX_FMT_FLAG_RGB);
+}
+
+/**
+ * Check if the frames of link could as well be in the pixel format fmt for
+ * the filter they are sent to.
+ */
+static int can_change_format(AVFilterLink *link, enum AVPixelFormat fmt)
+{
+    const AVPixFmtDescriptor *cur = av_pix_fmt_desc_get(link->format);
+    const AVPixFmtDescriptor *new = av_pix_fmt_desc_get(fmt);
+    const char *name = link->dst->filter->name;
+
+    if ((cur->flags | new->flags) & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM) ||
+        link->hw_frames_ctx)
+        return 0;
+    if (!strcmp(name, "format") || !strcmp(name, "noformat") || !strcmp(name, "null"))
+        return 1;
+    /* crop only depends on the chroma subsampling */
+    if (!strcmp(name, "crop"))
+        return cur->log2_chroma_w == new->log2_chroma_w &&
+               cur->log2_chroma_h == new->log2_chroma_h;
+    return 0;
+}
+
+/**
+ * Merge the pixel format conversion of automatically inserted scalers into
+ * a neighbouring scale filter, which then does both at once, when only
+ * filters not depending on the pixel format lie between them.
+ */
+static int graph_fuse_scalers(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int i, ret;
+
+    if (!graph->fuse_scalers)
+        return 0;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *first = graph->filters[i], *last;
+        AVFilterLink *link;
+        enum AVPixelFormat fmt;
+        int convert_first;
+
+        if (!is_scale(first))
+            continue;
+
+        /* find the next scale filter, through filters with one output */
+        for (link = first->outputs[0]; link->dst->nb_outputs == 1 &&
+             !is_scale(link->dst); link = link->dst->outputs[0])
+            ;
+        last = link->dst;
+        if (!is_scale(last))
+            continue;
+
+        /* The other scaler must not change the pixel format itself, so that
+         * no intermediate format is skipped, e.g. format=gray. */
+        if (is_auto_converter(first) &&
+            last->inputs[0]->format == last->outputs[0]->format) {
+            convert_first = 1;
+            fmt = first->inputs[0]->format;
+        } else if (is_auto_converter(last) &&
+                   first->inputs[0]->format == first->outputs[0]->format) {
+            convert_first = 0;
+            fmt = last->outputs[0]->format;
+        } else
+            continue;
+
+        for (link = first->outputs[0]; link->dst != last;
+             link = link->dst->outputs[0])
+            if (!can_change_format(link, fmt))
+                break;
+        if (link->dst != last)
+            continue;
+
+        for (link = first->outputs[0]; ; link = link->dst->outputs[0]) {
+            link->format     = fmt;
+            link->init_state = AVLINK_UNINIT;
+            if (link->dst == last)
+                break;
+        }
+        if ((ret = avfilter_config_links(last)) < 0)
+            return ret;
+        link = last->outputs[0];
+        if ((ret = link->srcpad->config_props(link)) < 0)
+            return ret;
+
+        av_log(log_ctx, AV_LOG_VERBOSE,
+               "Merged the conversion of '%s' into '%s'\n",
+               convert_first ? first->name : last->name,
+               convert_first ? last->name : first->name);
+    }
+
+    return 0;
+}
+
+/**
+ * Let the filters with an in_place input pad write into their input frames
+ * when the frames they output have the same properties.
+ */
+static void graph_config_in_place(AVFilterGraph *graph)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *inlink, *outlink;
+
+        f->internal->in_place = 0;
+        if (f->nb_inputs != 1 || f->nb_outputs != 1 ||
+            !f->input_pads[0].in_place)
+            continue;
+
+        inlink  = f->inputs[0];
+        outlink = f->outputs[0];
+        f->internal->in_place = inlink->type   == AVMEDIA_TYPE_VIDEO &&
+                                inlink->w      == outlink->w         &&
+                                inlink->h      == outlink->h         &&
+                                inlink->format == outlink->format    &&
+                                !inlink->hw_frames_ctx && !outlink->hw_frames_ctx;
+    }
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
@@ -1278,6 +1463,9 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_config_links(graphctx, log_ctx)))
         return ret;
+    if ((ret = graph_fuse_scalers(graphctx, log_ctx)))
+        return ret;
+    graph_config_in_place(graphctx);
     if ((ret = graph_check_links(graphctx, log_ctx)))
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
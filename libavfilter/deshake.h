@@ -57,6 +57,8 @@ typedef struct DeshakeContext {
     int counts[2*MAX_R+1][2*MAX_R+1]; /// < Scratch buffer for motion search
     double *angles;            ///< Scratch buffer for block angles
     unsigned angles_size;
+    IntMotionVector *mvs;      ///< Scratch buffer for block motion vectors
+    unsigned mvs_size;
     AVFrame *ref;              ///< Previous frame
     int rx;                    ///< Maximum horizontal shift
     int ry;                    ///< Maximum vertical shift
@@ -74,6 +76,10 @@ typedef struct DeshakeContext {
     int cx;
     int cy;
     char *filename;            ///< Motion search detailed log filename
+    char *input;               ///< Motion log to read instead of searching
+    Transform *motion;         ///< Per-frame motion read from the input log
+    int nb_motion;
+    int motion_pos;
     int opencl;
     int (* transform)(AVFilterContext *ctx, int width, int height, int cw, int ch,
                       const float *matrix_y, const float *matrix_uv, enum InterpolateMethod interpolate,
@@ -569,6 +569,48 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
+/**
+ * Blend a line through an 8 bits mask, averaging the mask over the
+ * (1 << hsub) x (1 << vsub) block covered by each pixel.
+ * Equivalent to blend_pixel() without the generic per bit mask extraction.
+ */
+static av_always_inline void blend_line_mask8_c(uint8_t *dst, int dst_delta,
+                                                unsigned src, unsigned alpha,
+                                                const uint8_t *mask, int mask_linesize,
+                                                int w, int hsub, int vsub)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        const uint8_t *m = mask + (x << hsub);
+        unsigned t = m[0], a;
+
+        if (hsub)
+            t += m[1];
+        if (vsub)
+            t += hsub ? m[mask_linesize] + m[mask_linesize + 1] : m[mask_linesize];
+        a = (t >> (hsub + vsub)) * alpha;
+        dst[x * dst_delta] = ((0x1010101 - a) * dst[x * dst_delta] + a * src) >> 24;
+    }
+}
+
+static void blend_line_mask8(uint8_t *dst, int dst_delta,
+                             unsigned src, unsigned alpha,
+                             const uint8_t *mask, int mask_linesize,
+                             int w, unsigned hsub, unsigned vsub)
+{
+    if (hsub && vsub)
+        blend_line_mask8_c(dst, dst_delta, src, alpha, mask, mask_linesize, w, 1, 1);
+    else if (hsub)
+        blend_line_mask8_c(dst, dst_delta, src, alpha, mask, mask_linesize, w, 1, 0);
+    else if (vsub)
+        blend_line_mask8_c(dst, dst_delta, src, alpha, mask, mask_linesize, w, 0, 1);
+    else if (dst_delta == 1)
+        blend_line_mask8_c(dst, 1, src, alpha, mask, mask_linesize, w, 0, 0);
+    else
+        blend_line_mask8_c(dst, dst_delta, src, alpha, mask, mask_linesize, w, 0, 0);
+}
+
 static void blend_line_hv16(uint8_t *dst, int dst_delta,
                             unsigned src, unsigned alpha,
                             const uint8_t *mask, int mask_linesize, int l2depth, int w,
@@ -608,11 +650,18 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
         dst += dst_delta;
         xm += left;
     }
-    for (x = 0; x < w; x++) {
-        blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
-                    1 << hsub, hband, hsub + vsub, xm);
-        dst += dst_delta;
-        xm += 1 << hsub;
+    if (l2depth == 3 && hsub <= 1 && vsub <= 1 && hband == 1 << vsub) {
+        blend_line_mask8(dst, dst_delta, src, alpha, mask + xm, mask_linesize,
+                         w, hsub, vsub);
+        dst += w * dst_delta;
+        xm  += w << hsub;
+    } else {
+        for (x = 0; x < w; x++) {
+            blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
+                        1 << hsub, hband, hsub + vsub, xm);
+            dst += dst_delta;
+            xm += 1 << hsub;
+        }
     }
     if (right)
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
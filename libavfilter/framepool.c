@@ -18,6 +18,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "framepool.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
@@ -26,6 +28,37 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/thread.h"
+
+typedef struct SharedPool {
+    int size;
+    AVBufferPool *pool;
+} SharedPool;
+
+typedef struct NewBuffer {
+    const uint8_t *data;
+    int size;
+} NewBuffer;
+
+/**
+ * Buffers allocated by buffer pools but not yet returned by
+ * ff_frame_pool_get(), so that it can tell which of the buffers it gets are
+ * new. There are only as many as frames being allocated at once.
+ */
+typedef struct NewBuffers {
+    AVMutex mutex;
+    atomic_int nb_entries;
+    NewBuffer *entries;
+    unsigned int entries_size;
+} NewBuffers;
+
+struct FFBufferPoolSet {
+    AVMutex mutex;
+    AVBufferRef* (*alloc)(int size);
+    SharedPool *pools;
+    int nb_pools;
+    NewBuffers new_buffers;
+};
 
 struct FFFramePool {
 
@@ -46,13 +79,177 @@ struct FFFramePool {
     int linesize[4];
     AVBufferPool *pools[4];
 
+    AVBufferRef* (*alloc)(int size);
+    NewBuffers new_buffers;
+    FFBufferPoolSet *set;
+
 };
 
+static int new_buffers_init(NewBuffers *nb)
+{
+    atomic_init(&nb->nb_entries, 0);
+    return ff_mutex_init(&nb->mutex, NULL);
+}
+
+static void new_buffers_uninit(NewBuffers *nb)
+{
+    av_freep(&nb->entries);
+    ff_mutex_destroy(&nb->mutex);
+}
+
+static AVBufferRef *new_buffers_alloc(NewBuffers *nb,
+                                      AVBufferRef* (*alloc)(int size), int size)
+{
+    AVBufferRef *buf = alloc ? alloc(size) : av_buffer_alloc(size);
+    NewBuffer *entries;
+    int n;
+
+    if (!buf)
+        return NULL;
+
+    ff_mutex_lock(&nb->mutex);
+    n = atomic_load_explicit(&nb->nb_entries, memory_order_relaxed);
+    entries = av_fast_realloc(nb->entries, &nb->entries_size,
+                              (n + 1) * sizeof(*entries));
+    if (entries) {
+        nb->entries = entries;
+        entries[n].data = buf->data;
+        entries[n].size = size;
+        atomic_store_explicit(&nb->nb_entries, n + 1, memory_order_relaxed);
+    }
+    ff_mutex_unlock(&nb->mutex);
+
+    if (!entries)
+        av_buffer_unref(&buf);
+    return buf;
+}
+
+/**
+ * Remove the buffer starting at data from the new buffers.
+ *
+ * @return the size of the buffer if it was new, 0 otherwise
+ */
+static int new_buffers_claim(NewBuffers *nb, const uint8_t *data)
+{
+    int i, n, size = 0;
+
+    /* a new buffer is always recorded by the thread getting it */
+    if (!atomic_load_explicit(&nb->nb_entries, memory_order_relaxed))
+        return 0;
+
+    ff_mutex_lock(&nb->mutex);
+    n = atomic_load_explicit(&nb->nb_entries, memory_order_relaxed);
+    for (i = 0; i < n; i++) {
+        if (nb->entries[i].data == data) {
+            size = nb->entries[i].size;
+            nb->entries[i] = nb->entries[n - 1];
+            atomic_store_explicit(&nb->nb_entries, n - 1, memory_order_relaxed);
+            break;
+        }
+    }
+    ff_mutex_unlock(&nb->mutex);
+
+    return size;
+}
+
+static AVBufferRef *pool_alloc(void *opaque, int size)
+{
+    FFFramePool *pool = opaque;
+    return new_buffers_alloc(&pool->new_buffers, pool->alloc, size);
+}
+
+static AVBufferRef *pool_set_alloc(void *opaque, int size)
+{
+    FFBufferPoolSet *set = opaque;
+    return new_buffers_alloc(&set->new_buffers, set->alloc, size);
+}
+
+FFBufferPoolSet *ff_buffer_pool_set_alloc(AVBufferRef* (*alloc)(int size))
+{
+    FFBufferPoolSet *set = av_mallocz(sizeof(*set));
+
+    if (!set)
+        return NULL;
+    if (ff_mutex_init(&set->mutex, NULL)) {
+        av_free(set);
+        return NULL;
+    }
+    if (new_buffers_init(&set->new_buffers)) {
+        ff_mutex_destroy(&set->mutex);
+        av_free(set);
+        return NULL;
+    }
+    set->alloc = alloc;
+
+    return set;
+}
+
+/* Sizes are rounded up to one of 8 classes per power of 2. */
+static int size_class(int size)
+{
+    int64_t class = FFALIGN((int64_t)size, 1 << FFMAX(av_log2(size) - 3, 0));
+    return class <= INT_MAX ? class : size;
+}
+
+static AVBufferPool *pool_set_get_pool(FFBufferPoolSet *set, int size)
+{
+    AVBufferPool *pool = NULL;
+    SharedPool *pools;
+    int i;
+
+    size = size_class(size);
+
+    ff_mutex_lock(&set->mutex);
+    for (i = 0; i < set->nb_pools; i++) {
+        if (set->pools[i].size == size) {
+            pool = set->pools[i].pool;
+            goto end;
+        }
+    }
+
+    pools = av_realloc_array(set->pools, set->nb_pools + 1, sizeof(*pools));
+    if (!pools)
+        goto end;
+    set->pools = pools;
+
+    pool = av_buffer_pool_init2(size, set, pool_set_alloc, NULL);
+    if (pool) {
+        pools[set->nb_pools].size   = size;
+        pools[set->nb_pools++].pool = pool;
+    }
+end:
+    ff_mutex_unlock(&set->mutex);
+    return pool;
+}
+
+void ff_buffer_pool_set_free(FFBufferPoolSet **set)
+{
+    int i;
+
+    if (!set || !*set)
+        return;
+
+    for (i = 0; i < (*set)->nb_pools; i++)
+        av_buffer_pool_uninit(&(*set)->pools[i].pool);
+    av_freep(&(*set)->pools);
+    new_buffers_uninit(&(*set)->new_buffers);
+    ff_mutex_destroy(&(*set)->mutex);
+
+    av_freep(set);
+}
+
+static AVBufferPool *frame_pool_init_buffers(FFFramePool *pool, int size)
+{
+    return pool->set ? pool_set_get_pool(pool->set, size) :
+                       av_buffer_pool_init2(size, pool, pool_alloc, NULL);
+}
+
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
                                       int width,
                                       int height,
                                       enum AVPixelFormat format,
-                                      int align)
+                                      int align,
+                                      FFBufferPoolSet *set)
 {
     int i, ret;
     FFFramePool *pool;
@@ -64,8 +261,14 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
     pool = av_mallocz(sizeof(FFFramePool));
     if (!pool)
         return NULL;
+    if (new_buffers_init(&pool->new_buffers)) {
+        av_free(pool);
+        return NULL;
+    }
 
     pool->type = AVMEDIA_TYPE_VIDEO;
+    pool->alloc = alloc;
+    pool->set = set;
     pool->width = width;
     pool->height = height;
     pool->format = format;
@@ -96,15 +299,14 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
         if (i == 1 || i == 2)
             h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
 
-        pool->pools[i] = av_buffer_pool_init(pool->linesize[i] * h + 16 + 16 - 1,
-                                             alloc);
+        pool->pools[i] = frame_pool_init_buffers(pool, pool->linesize[i] * h + 16 + 16 - 1);
         if (!pool->pools[i])
             goto fail;
     }
 
     if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
         desc->flags & FF_PSEUDOPAL) {
-        pool->pools[1] = av_buffer_pool_init(AVPALETTE_SIZE, alloc);
+        pool->pools[1] = frame_pool_init_buffers(pool, AVPALETTE_SIZE);
         if (!pool->pools[1])
             goto fail;
     }
@@ -120,7 +322,8 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
                                       int channels,
                                       int nb_samples,
                                       enum AVSampleFormat format,
-                                      int align)
+                                      int align,
+                                      FFBufferPoolSet *set)
 {
     int ret, planar;
     FFFramePool *pool;
@@ -128,10 +331,15 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
     pool = av_mallocz(sizeof(FFFramePool));
     if (!pool)
         return NULL;
+    if (new_buffers_init(&pool->new_buffers)) {
+        av_free(pool);
+        return NULL;
+    }
 
     planar = av_sample_fmt_is_planar(format);
 
     pool->type = AVMEDIA_TYPE_AUDIO;
+    pool->set = set;
     pool->planes = planar ? channels : 1;
     pool->channels = channels;
     pool->nb_samples = nb_samples;
@@ -143,7 +351,7 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
     if (ret < 0)
         goto fail;
 
-    pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
+    pool->pools[0] = frame_pool_init_buffers(pool, pool->linesize[0]);
     if (!pool->pools[0])
         goto fail;
 
@@ -192,11 +400,23 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
     return 0;
 }
 
-AVFrame *ff_frame_pool_get(FFFramePool *pool)
+static AVBufferRef *frame_pool_get_buffer(FFFramePool *pool, AVBufferPool *buffers,
+                                          int64_t *allocated)
+{
+    NewBuffers *nb = pool->set ? &pool->set->new_buffers : &pool->new_buffers;
+    AVBufferRef *buf = av_buffer_pool_get(buffers);
+
+    if (buf)
+        *allocated += new_buffers_claim(nb, buf->data);
+    return buf;
+}
+
+AVFrame *ff_frame_pool_get(FFFramePool *pool, int64_t *allocated)
 {
     int i;
     AVFrame *frame;
     const AVPixFmtDescriptor *desc;
+    int64_t new_bytes = 0;
 
     frame = av_frame_alloc();
     if (!frame) {
@@ -219,7 +439,7 @@ AVFrame *ff_frame_pool_get(FFFramePool *pool)
             if (!pool->pools[i])
                 break;
 
-            frame->buf[i] = av_buffer_pool_get(pool->pools[i]);
+            frame->buf[i] = frame_pool_get_buffer(pool, pool->pools[i], &new_bytes);
             if (!frame->buf[i])
                 goto fail;
 
@@ -258,13 +478,13 @@ AVFrame *ff_frame_pool_get(FFFramePool *pool)
         }
 
         for (i = 0; i < FFMIN(pool->planes, AV_NUM_DATA_POINTERS); i++) {
-            frame->buf[i] = av_buffer_pool_get(pool->pools[0]);
+            frame->buf[i] = frame_pool_get_buffer(pool, pool->pools[0], &new_bytes);
             if (!frame->buf[i])
                 goto fail;
             frame->extended_data[i] = frame->data[i] = frame->buf[i]->data;
         }
         for (i = 0; i < frame->nb_extended_buf; i++) {
-            frame->extended_buf[i] = av_buffer_pool_get(pool->pools[0]);
+            frame->extended_buf[i] = frame_pool_get_buffer(pool, pool->pools[0], &new_bytes);
             if (!frame->extended_buf[i])
                 goto fail;
             frame->extended_data[i + AV_NUM_DATA_POINTERS] = frame->extended_buf[i]->data;
@@ -275,6 +495,8 @@ AVFrame *ff_frame_pool_get(FFFramePool *pool)
         av_assert0(0);
     }
 
+    if (allocated)
+        *allocated = new_bytes;
     return frame;
 fail:
     av_frame_free(&frame);
@@ -288,9 +510,12 @@ void ff_frame_pool_uninit(FFFramePool **pool)
     if (!pool || !*pool)
         return;
 
-    for (i = 0; i < 4; i++) {
-        av_buffer_pool_uninit(&(*pool)->pools[i]);
+    /* the shared pools belong to the set */
+    if (!(*pool)->set) {
+        for (i = 0; i < 4; i++)
+            av_buffer_pool_uninit(&(*pool)->pools[i]);
     }
 
+    new_buffers_uninit(&(*pool)->new_buffers);
     av_freep(pool);
 }
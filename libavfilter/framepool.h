@@ -31,6 +31,33 @@
  */
 typedef struct FFFramePool FFFramePool;
 
+/**
+ * Set of buffer pools shared by several frame pools, typically those of all
+ * the links of a filter graph. The buffers are grouped by size class, so that
+ * frames of similar sizes reuse the same buffers, whatever link they are
+ * allocated for. This structure is opaque; it is allocated with
+ * ff_buffer_pool_set_alloc() and freed with ff_buffer_pool_set_free().
+ */
+typedef struct FFBufferPoolSet FFBufferPoolSet;
+
+/**
+ * Allocate a set of shared buffer pools.
+ *
+ * @param alloc a function that will be used to allocate new buffers when
+ * a pool is empty. May be NULL, then the default allocator will be used
+ * (av_buffer_alloc()).
+ * @return newly created set on success, NULL on error.
+ */
+FFBufferPoolSet *ff_buffer_pool_set_alloc(AVBufferRef* (*alloc)(int size));
+
+/**
+ * Free the set. The frame pools using it must have been freed before, but
+ * some of the allocated frames may still be in use.
+ *
+ * @param set pointer to the set to be freed. It will be set to NULL.
+ */
+void ff_buffer_pool_set_free(FFBufferPoolSet **set);
+
 /**
  * Allocate and initialize a video frame pool.
  *
@@ -41,13 +68,16 @@ typedef struct FFFramePool FFFramePool;
  * @param height height of each frame in this pool
  * @param format format of each frame in this pool
  * @param align buffers alignement of each frame in this pool
+ * @param set if not NULL, take the buffers from the shared pools of this set
+ * instead of private pools, alloc is then ignored
  * @return newly created video frame pool on success, NULL on error.
  */
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
                                       int width,
                                       int height,
                                       enum AVPixelFormat format,
-                                      int align);
+                                      int align,
+                                      FFBufferPoolSet *set);
 
 /**
  * Allocate and initialize an audio frame pool.
@@ -59,13 +89,16 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
  * @param nb_samples number of samples of each frame in this pool
  * @param format format of each frame in this pool
  * @param align buffers alignement of each frame in this pool
+ * @param set if not NULL, take the buffers from the shared pools of this set
+ * instead of a private pool, alloc is then ignored
  * @return newly created audio frame pool on success, NULL on error.
  */
 FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
                                       int channels,
                                       int samples,
                                       enum AVSampleFormat format,
-                                      int align);
+                                      int align,
+                                      FFBufferPoolSet *set);
 
 /**
  * Deallocate the frame pool. It is safe to call this function while
@@ -110,9 +143,11 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
  * Allocate a new AVFrame, reussing old buffers from the pool when available.
  * This function may be called simultaneously from multiple threads.
  *
+ * @param allocated if not NULL, set to the size in bytes of the buffers newly
+ * allocated for this frame, as opposed to reused ones
  * @return a new AVFrame on success, NULL on error.
  */
-AVFrame *ff_frame_pool_get(FFFramePool *pool);
+AVFrame *ff_frame_pool_get(FFFramePool *pool, int64_t *allocated);
 
 
 #endif /* AVFILTER_FRAMEPOOL_H */
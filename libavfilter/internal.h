@@ -132,16 +132,29 @@ struct AVFilterPad {
      * input pads only.
      */
     int needs_writable;
+
+    /**
+     * The filter can write its output into the input frame, when the frame
+     * is writable and the output link has the same properties as the input
+     * link. This is checked when the graph is configured; the filter then
+     * gets its output frame with ff_get_video_buffer_in_place().
+     *
+     * input pads only.
+     */
+    int in_place;
 };
 
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+    FFBufferPoolSet *buffer_pools;  ///< shared by the frame pools of all links
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    struct FrameThreadContext *frame_thread;
+    int in_place;                   ///< output may be written into the input
 };
 
 /**
@@ -391,6 +404,15 @@ static inline int ff_norm_qscale(int qscale, int type)
  */
 int ff_filter_get_nb_threads(AVFilterContext *ctx);
 
+/**
+ * Get the buffer pools the frame pool of a link should use, NULL if the link
+ * is not part of a graph.
+ */
+static inline FFBufferPoolSet *ff_filter_link_buffer_pools(AVFilterLink *link)
+{
+    return link->src->graph ? link->src->graph->internal->buffer_pools : NULL;
+}
+
 /**
  * Generic processing of user supplied commands that are set
  * in the same way as the filter options.
@@ -22,6 +22,7 @@
 #define AVFILTER_MOTION_ESTIMATION_H
 
 #include "libavutil/avutil.h"
+#include "libavutil/pixelutils.h"
 
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
@@ -57,6 +58,8 @@ typedef struct AVMotionEstContext {
     int pred_y;     ///< median predictor y
     AVMotionEstPredictor preds[2];
 
+    av_pixelutils_sad_fn sad[6];    ///< SAD of 1<<n x 1<<n blocks, NULL if unavailable
+
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
 } AVMotionEstContext;
@@ -64,6 +67,27 @@ typedef struct AVMotionEstContext {
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
+/**
+ * Sum of absolute differences between the size x size blocks at cur and ref.
+ */
+static av_always_inline uint64_t ff_me_sad(AVMotionEstContext *me_ctx,
+                                          const uint8_t *cur, const uint8_t *ref,
+                                          ptrdiff_t linesize, int size)
+{
+    int n = av_log2(size);
+    uint64_t sad = 0;
+    int i, j;
+
+    if (n < FF_ARRAY_ELEMS(me_ctx->sad) && me_ctx->sad[n] && size == 1 << n)
+        return me_ctx->sad[n](cur, linesize, ref, linesize);
+
+    for (j = 0; j < size; j++, cur += linesize, ref += linesize)
+        for (i = 0; i < size; i++)
+            sad += FFABS(cur[i] - ref[i]);
+
+    return sad;
+}
+
 uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv);
 
 uint64_t ff_me_search_esa(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *mv);
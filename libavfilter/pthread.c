@@ -23,12 +23,17 @@
 
 #include "config.h"
 
+#include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
 #include "libavutil/slicethread.h"
 
+#include "framepool.h"
+#include "framequeue.h"
+
+#define FF_INTERNAL_FIELDS 1
 #include "avfilter.h"
 #include "internal.h"
 #include "thread.h"
@@ -75,7 +80,10 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
-    nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
+    if (c->graph->shared_threads)
+        nb_threads = avpriv_slicethread_create_shared(&c->thread, c, worker_func, nb_threads);
+    else
+        nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
     if (nb_threads <= 1)
         avpriv_slicethread_free(&c->thread);
     return FFMAX(nb_threads, 1);
@@ -83,6 +91,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
 
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
+    ThreadContext *c;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -90,11 +99,12 @@ int ff_graph_thread_init(AVFilterGraph *graph)
         return 0;
     }
 
-    graph->internal->thread = av_mallocz(sizeof(ThreadContext));
-    if (!graph->internal->thread)
+    graph->internal->thread = c = av_mallocz(sizeof(ThreadContext));
+    if (!c)
         return AVERROR(ENOMEM);
+    c->graph = graph;
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(c, graph->nb_threads);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
@@ -114,3 +124,280 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+enum FrameSlotState {
+    SLOT_IDLE,
+    SLOT_SUBMITTED,
+    SLOT_DONE,
+};
+
+/**
+ * One frame being filtered in its own thread. The job sees private copies
+ * of the filter context and its links, so that the scheduler can keep
+ * using the real ones meanwhile; the output link of the copy queues the
+ * frames in its own fifo, and allocates them from its own pool.
+ */
+typedef struct FrameThreadSlot {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int thread_init;
+    int die;
+    enum FrameSlotState state;
+
+    AVFilterContext ctx;
+    AVFilterInternal internal;
+    AVFilterLink inlink, outlink;
+    AVFilterLink *inlinks[1], *outlinks[1];
+    AVFilterContext sink;       ///< stands for the destination of outlink
+    AVFilterPad sink_pad;
+
+    int (*filter_frame)(AVFilterLink *, AVFrame *);
+    AVFrame *frame;
+    int ret;
+    int64_t pool_bytes;         ///< outlink.pool_bytes when submitted
+} FrameThreadSlot;
+
+typedef struct FrameThreadContext {
+    FrameThreadSlot *slots;
+    int nb_slots;
+    int next_submit;
+    int next_output;
+    int nb_pending;
+} FrameThreadContext;
+
+static int serial_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                          void *arg, int *ret, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++) {
+        int r = func(ctx, arg, i, nb_jobs);
+        if (ret)
+            ret[i] = r;
+    }
+    return 0;
+}
+
+static void *frame_worker(void *arg)
+{
+    FrameThreadSlot *slot = arg;
+
+    pthread_mutex_lock(&slot->mutex);
+    while (1) {
+        int ret;
+
+        while (slot->state != SLOT_SUBMITTED && !slot->die)
+            pthread_cond_wait(&slot->cond, &slot->mutex);
+        if (slot->die)
+            break;
+        pthread_mutex_unlock(&slot->mutex);
+
+        ret = slot->filter_frame(&slot->inlink, slot->frame);
+
+        pthread_mutex_lock(&slot->mutex);
+        slot->frame = NULL;
+        slot->ret   = ret;
+        slot->state = SLOT_DONE;
+        pthread_cond_signal(&slot->cond);
+    }
+    pthread_mutex_unlock(&slot->mutex);
+
+    return NULL;
+}
+
+/* The fifo and the frame pool of the copies belong to the slot. */
+static void copy_link(AVFilterLink *dst, const AVFilterLink *src)
+{
+    FFFrameQueue fifo = dst->fifo;
+    void *frame_pool  = dst->frame_pool;
+
+    memcpy(dst, src, sizeof(*dst));
+    dst->fifo       = fifo;
+    dst->frame_pool = frame_pool;
+}
+
+static void wait_slot(FrameThreadSlot *slot)
+{
+    pthread_mutex_lock(&slot->mutex);
+    while (slot->state == SLOT_SUBMITTED)
+        pthread_cond_wait(&slot->cond, &slot->mutex);
+    pthread_mutex_unlock(&slot->mutex);
+}
+
+int ff_filter_frame_thread_submit(AVFilterContext *ctx,
+                                  int (*filter_frame)(AVFilterLink *, AVFrame *),
+                                  AVFrame *frame)
+{
+    FrameThreadContext *ft = ctx->internal->frame_thread;
+    FrameThreadSlot *slot  = &ft->slots[ft->next_submit];
+    AVFilterLink *outlink  = ctx->outputs[0];
+
+    av_assert0(ft->nb_pending < ft->nb_slots && slot->state == SLOT_IDLE);
+
+    slot->ctx          = *ctx;
+    slot->ctx.inputs   = slot->inlinks;
+    slot->ctx.outputs  = slot->outlinks;
+    slot->ctx.internal = &slot->internal;
+    slot->internal.in_place = ctx->internal->in_place;
+
+    copy_link(&slot->inlink, ctx->inputs[0]);
+    slot->inlink.dst = &slot->ctx;
+
+    copy_link(&slot->outlink, outlink);
+    slot->outlink.src    = &slot->ctx;
+    slot->outlink.dst    = &slot->sink;
+    slot->outlink.dstpad = &slot->sink_pad;
+    slot->pool_bytes     = slot->outlink.pool_bytes;
+
+    slot->sink.av_class = outlink->dst->av_class;
+    slot->sink.filter   = outlink->dst->filter;
+    slot->sink.name     = outlink->dst->name;
+    slot->sink_pad.name = "default";
+    slot->sink_pad.type = outlink->type;
+
+    slot->filter_frame = filter_frame;
+    slot->frame        = frame;
+
+    pthread_mutex_lock(&slot->mutex);
+    slot->state = SLOT_SUBMITTED;
+    pthread_cond_signal(&slot->cond);
+    pthread_mutex_unlock(&slot->mutex);
+
+    ft->next_submit = (ft->next_submit + 1) % ft->nb_slots;
+    ft->nb_pending++;
+    return 0;
+}
+
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int max_pending)
+{
+    FrameThreadContext *ft = ctx->internal->frame_thread;
+    AVFilterLink *outlink  = ctx->outputs[0];
+
+    while (ft->nb_pending) {
+        FrameThreadSlot *slot = &ft->slots[ft->next_output];
+        int ret;
+
+        pthread_mutex_lock(&slot->mutex);
+        if (slot->state != SLOT_DONE && ft->nb_pending <= max_pending) {
+            pthread_mutex_unlock(&slot->mutex);
+            break;
+        }
+        while (slot->state != SLOT_DONE)
+            pthread_cond_wait(&slot->cond, &slot->mutex);
+        slot->state = SLOT_IDLE;
+        pthread_mutex_unlock(&slot->mutex);
+
+        ft->next_output = (ft->next_output + 1) % ft->nb_slots;
+        ft->nb_pending--;
+
+        outlink->pool_bytes += slot->outlink.pool_bytes - slot->pool_bytes;
+        ret = slot->ret;
+        while (ff_framequeue_queued_frames(&slot->outlink.fifo)) {
+            AVFrame *frame = ff_framequeue_take(&slot->outlink.fifo);
+            if (ret >= 0)
+                ret = ff_filter_frame(outlink, frame);
+            else
+                av_frame_free(&frame);
+        }
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+void ff_filter_frame_thread_wait(AVFilterContext *ctx)
+{
+    FrameThreadContext *ft = ctx->internal->frame_thread;
+    int i;
+
+    if (!ft)
+        return;
+
+    for (i = 0; i < ft->nb_slots; i++)
+        wait_slot(&ft->slots[i]);
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+    FrameThreadContext *ft = ctx->internal->frame_thread;
+    int i;
+
+    if (!ft)
+        return;
+
+    for (i = 0; i < ft->nb_slots; i++) {
+        FrameThreadSlot *slot = &ft->slots[i];
+
+        if (slot->thread_init) {
+            wait_slot(slot);
+            pthread_mutex_lock(&slot->mutex);
+            slot->die = 1;
+            pthread_cond_signal(&slot->cond);
+            pthread_mutex_unlock(&slot->mutex);
+            pthread_join(slot->thread, NULL);
+            pthread_mutex_destroy(&slot->mutex);
+            pthread_cond_destroy(&slot->cond);
+        }
+        ff_framequeue_free(&slot->inlink.fifo);
+        ff_framequeue_free(&slot->outlink.fifo);
+        ff_frame_pool_uninit((FFFramePool **)&slot->inlink.frame_pool);
+        ff_frame_pool_uninit((FFFramePool **)&slot->outlink.frame_pool);
+    }
+    av_freep(&ft->slots);
+    av_freep(&ctx->internal->frame_thread);
+}
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx)
+{
+    FrameThreadContext *ft;
+    int nb_slots = ff_filter_get_nb_threads(ctx);
+    int i, ret;
+
+    if (nb_slots <= 1 || ctx->filter->activate ||
+        ctx->nb_inputs != 1 || ctx->nb_outputs != 1)
+        return 0;
+
+    ft = ctx->internal->frame_thread = av_mallocz(sizeof(*ft));
+    if (!ft)
+        return AVERROR(ENOMEM);
+    ft->slots = av_mallocz_array(nb_slots, sizeof(*ft->slots));
+    if (!ft->slots) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ft->nb_slots = nb_slots;
+
+    for (i = 0; i < nb_slots; i++) {
+        FrameThreadSlot *slot = &ft->slots[i];
+
+        slot->inlinks[0]       = &slot->inlink;
+        slot->outlinks[0]      = &slot->outlink;
+        slot->internal.execute = serial_execute;
+        ff_framequeue_init(&slot->inlink.fifo,  &ctx->graph->internal->frame_queues);
+        ff_framequeue_init(&slot->outlink.fifo, &ctx->graph->internal->frame_queues);
+
+        if ((ret = pthread_mutex_init(&slot->mutex, NULL))) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        if ((ret = pthread_cond_init(&slot->cond, NULL))) {
+            pthread_mutex_destroy(&slot->mutex);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        if ((ret = pthread_create(&slot->thread, NULL, frame_worker, slot))) {
+            pthread_mutex_destroy(&slot->mutex);
+            pthread_cond_destroy(&slot->cond);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        slot->thread_init = 1;
+    }
+
+    return 1;
+
+fail:
+    ff_filter_frame_thread_free(ctx);
+    return ret;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/lfg.h"
+#include "libavfilter/drawutils.c"
+
+#define MAX_W 67
+
+/* reference implementation, the generic per pixel path of blend_line_hv() */
+static void blend_line_ref(uint8_t *dst, int dst_delta,
+                           unsigned src, unsigned alpha,
+                           const uint8_t *mask, int mask_linesize,
+                           int w, unsigned hsub, unsigned vsub)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        blend_pixel(dst + x * dst_delta, src, alpha, mask, mask_linesize, 3,
+                    1 << hsub, 1 << vsub, hsub + vsub, x << hsub);
+}
+
+static int check(AVLFG *lfg, int dst_delta, unsigned hsub, unsigned vsub)
+{
+    uint8_t mask[2 * (2 * MAX_W)];
+    uint8_t dst[MAX_W * 3], ref[MAX_W * 3];
+    int i, j;
+
+    for (i = 0; i < 200; i++) {
+        unsigned src   = av_lfg_get(lfg) & 0xff;
+        unsigned alpha = (0x10307 * (av_lfg_get(lfg) & 0xff) + 0x3) >> 8;
+        int w = 1 + av_lfg_get(lfg) % MAX_W;
+
+        for (j = 0; j < sizeof(mask); j++) {
+            /* favour the transparent and opaque values of real masks */
+            switch (av_lfg_get(lfg) & 3) {
+            case 0:  mask[j] = 0;                       break;
+            case 1:  mask[j] = 255;                     break;
+            default: mask[j] = av_lfg_get(lfg) & 0xff;  break;
+            }
+        }
+        for (j = 0; j < sizeof(dst); j++)
+            dst[j] = ref[j] = av_lfg_get(lfg) & 0xff;
+
+        blend_line_mask8(dst, dst_delta, src, alpha, mask, 2 * MAX_W,
+                         w, hsub, vsub);
+        blend_line_ref(ref, dst_delta, src, alpha, mask, 2 * MAX_W,
+                       w, hsub, vsub);
+        if (memcmp(dst, ref, sizeof(dst))) {
+            for (j = 0; dst[j] == ref[j]; j++);
+            printf("%dx%d delta %d w %d: byte %d is %d instead of %d\n",
+                   1 << hsub, 1 << vsub, dst_delta, w, j, dst[j], ref[j]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        int dst_delta;
+        unsigned hsub, vsub;
+    } tests[] = {
+        { "none",  1, 0, 0 },
+        { "none",  3, 0, 0 },
+        { "2x1",   1, 1, 0 },
+        { "1x2",   1, 0, 1 },
+        { "2x2",   1, 1, 1 },
+    };
+    AVLFG lfg;
+    int i, ret = 0;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        int r = check(&lfg, tests[i].dst_delta, tests[i].hsub, tests[i].vsub);
+        printf("subsampling %s, pixel step %d: %s\n", tests[i].name,
+               tests[i].dst_delta, r ? "failed" : "ok");
+        ret |= r;
+    }
+    return ret;
+}
@@ -25,4 +25,41 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Set up frame threading for a filter with AVFILTER_FLAG_FRAME_THREADS.
+ *
+ * @return 1 if frame threading is used, 0 if it is not possible for this
+ *         filter instance, a negative error code on failure
+ */
+int ff_filter_frame_thread_init(AVFilterContext *ctx);
+
+/**
+ * Wait for the pending frames, discard their output and stop the threads.
+ */
+void ff_filter_frame_thread_free(AVFilterContext *ctx);
+
+/**
+ * Start filtering a frame in a free thread. There must be one, see
+ * ff_filter_frame_thread_output(). The filter_frame callback is called with a
+ * private copy of the input link, whose output link queues the frames
+ * for ff_filter_frame_thread_output().
+ */
+int ff_filter_frame_thread_submit(AVFilterContext *ctx,
+                                  int (*filter_frame)(AVFilterLink *, AVFrame *),
+                                  AVFrame *frame);
+
+/**
+ * Send the frames of the finished jobs to the output link, in submission
+ * order, waiting until at most max_pending jobs remain.
+ *
+ * @return the first error returned by a job, 0 otherwise
+ */
+int ff_filter_frame_thread_output(AVFilterContext *ctx, int max_pending);
+
+/**
+ * Wait until no job is running, so that the filter private context can be
+ * modified. Their output is kept for ff_filter_frame_thread_output().
+ */
+void ff_filter_frame_thread_wait(AVFilterContext *ctx);
+
 #endif /* AVFILTER_THREAD_H */
@@ -132,4 +132,14 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Same as avfilter_transform(), but only write the destination rows in
+ * [slice_start, slice_end). The whole source image may be read.
+ */
+int ff_transform_slice(const uint8_t *src, uint8_t *dst,
+                       int src_stride, int dst_stride,
+                       int width, int height, const float *matrix,
+                       enum InterpolateMethod interpolate,
+                       enum FillMethod fill, int slice_start, int slice_end);
+
 #endif /* AVFILTER_TRANSFORM_H */
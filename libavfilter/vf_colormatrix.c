@@ -427,12 +427,11 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     AVFrame *out;
     ThreadData td = {0};
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    out = ff_get_video_buffer_in_place(outlink, in);
     if (!out) {
         av_frame_free(&in);
         return AVERROR(ENOMEM);
     }
-    av_frame_copy_props(out, in);
 
     if (color->source == COLOR_MODE_NONE) {
         enum AVColorSpace cs = in->colorspace;
@@ -448,7 +447,9 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         case AVCOL_SPC_BT2020_CL : source = COLOR_MODE_BT2020    ; break;
         default :
             av_log(ctx, AV_LOG_ERROR, "Input frame does not specify a supported colorspace, and none has been specified as source either\n");
-            av_frame_free(&out);
+            if (out != in)
+                av_frame_free(&out);
+            av_frame_free(&in);
             return AVERROR(EINVAL);
         }
         color->mode = source * 5 + color->dest;
@@ -485,7 +486,8 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         ctx->internal->execute(ctx, process_slice_uyvy422, &td, NULL,
                                FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
 
-    av_frame_free(&in);
+    if (out != in)
+        av_frame_free(&in);
     return ff_filter_frame(outlink, out);
 }
 
@@ -495,6 +497,7 @@ static const AVFilterPad colormatrix_inputs[] = {
         .type         = AVMEDIA_TYPE_VIDEO,
         .config_props = config_input,
         .filter_frame = filter_frame,
+        .in_place     = 1,
     },
     { NULL }
 };
@@ -53,6 +53,7 @@
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
+#include "libavutil/avstring.h"
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -82,12 +83,27 @@ static const AVOption deshake_options[] = {
         { "exhaustive", "exhaustive search",      0, AV_OPT_TYPE_CONST, {.i64=EXHAUSTIVE},       INT_MIN, INT_MAX, FLAGS, "smode" },
         { "less",       "less exhaustive search", 0, AV_OPT_TYPE_CONST, {.i64=SMART_EXHAUSTIVE}, INT_MIN, INT_MAX, FLAGS, "smode" },
     { "filename", "set motion search detailed log file name", OFFSET(filename), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
+    { "input", "read motion from a log file instead of searching", OFFSET(input), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "opencl", "ignored",                              OFFSET(opencl), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL }
 };
 
 AVFILTER_DEFINE_CLASS(deshake);
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_rows, nb_cols;
+} ThreadData;
+
+typedef struct TransformThreadData {
+    AVFrame *in, *out;
+    const float *matrix[3];
+    int plane_w[3], plane_h[3];
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+} TransformThreadData;
+
 static int cmp(const void *a, const void *b)
 {
     return FFDIFFSIGN(*(const double *)a, *(const double *)b);
@@ -158,8 +174,8 @@ static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
         tmp = mv->x;
         tmp2 = mv->y;
 
-        for (y = tmp2 - 1; y <= tmp2 + 1; y++) {
-            for (x = tmp - 1; x <= tmp + 1; x++) {
+        for (y = FFMAX(tmp2 - 1, -deshake->ry); y <= FFMIN(tmp2 + 1, deshake->ry); y++) {
+            for (x = FFMAX(tmp - 1, -deshake->rx); x <= FFMIN(tmp + 1, deshake->rx); x++) {
                 if (x == tmp && y == tmp2)
                     continue;
 
@@ -225,6 +241,36 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+/**
+ * Find the motion of the blocks in a range of block rows.
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    const ThreadData *td = arg;
+    const int row_start = (td->nb_rows *  jobnr   ) / nb_jobs;
+    const int row_end   = (td->nb_rows * (jobnr+1)) / nb_jobs;
+    int row, col;
+
+    for (row = row_start; row < row_end; row++) {
+        const int y = deshake->ry + row * deshake->blocksize * 2;
+        for (col = 0; col < td->nb_cols; col++) {
+            const int x = deshake->rx + col * 16;
+            IntMotionVector *mv = &deshake->mvs[row * td->nb_cols + col];
+
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                mv->x = mv->y = 0;
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, mv);
+            } else {
+                mv->x = mv->y = -1;
+            }
+        }
+    }
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,19 +278,35 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData td;
+    int x, y, row, col;
     int count_max_value = 0;
-    int contrast;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
     av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    if (!deshake->angles)
+        return AVERROR(ENOMEM);
+
+    td.src1    = src1;
+    td.src2    = src2;
+    td.stride  = stride;
+    td.nb_rows = td.nb_cols = 0;
+    // We use a width of 16 here to match the sad function
+    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2)
+        td.nb_rows++;
+    for (x = deshake->rx; x < width - deshake->rx - 16; x += 16)
+        td.nb_cols++;
+
+    av_fast_malloc(&deshake->mvs, &deshake->mvs_size, td.nb_rows * td.nb_cols * sizeof(*deshake->mvs));
+    if (!deshake->mvs)
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -253,25 +315,25 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // Find motion for every block
+    if (td.nb_rows && td.nb_cols)
+        ctx->internal->execute(ctx, find_motion_slice, &td, NULL,
+                               FFMIN(td.nb_rows, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    // Store the motion vectors in the counts
+    for (row = 0; row < td.nb_rows; row++) {
+        y = deshake->ry + row * deshake->blocksize * 2;
+        for (col = 0; col < td.nb_cols; col++) {
+            IntMotionVector *mv = &deshake->mvs[row * td.nb_cols + col];
+            x = deshake->rx + col * 16;
+            if (mv->x != -1 && mv->y != -1) {
+                deshake->counts[mv->x + deshake->rx][mv->y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, mv);
+
+                center_x += mv->x;
+                center_y += mv->y;
             }
         }
     }
@@ -310,6 +372,25 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
+}
+
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const TransformThreadData *td = arg;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        const int slice_start = (td->plane_h[i] *  jobnr   ) / nb_jobs;
+        const int slice_end   = (td->plane_h[i] * (jobnr+1)) / nb_jobs;
+
+        // Transform the luma and chroma planes
+        ff_transform_slice(td->in->data[i], td->out->data[i],
+                           td->in->linesize[i], td->out->linesize[i],
+                           td->plane_w[i], td->plane_h[i], td->matrix[i],
+                           td->interpolate, td->fill, slice_start, slice_end);
+    }
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -318,23 +399,74 @@ static int deshake_transform_c(AVFilterContext *ctx,
                                     enum InterpolateMethod interpolate,
                                     enum FillMethod fill, AVFrame *in, AVFrame *out)
 {
-    int i = 0, ret = 0;
-    const float *matrixs[3];
-    int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    TransformThreadData td;
 
-    for (i = 0; i < 3; i++) {
-        // Transform the luma and chroma planes
-        ret = avfilter_transform(in->data[i], out->data[i], in->linesize[i], out->linesize[i],
-                                 plane_w[i], plane_h[i], matrixs[i], interpolate, fill);
-        if (ret < 0)
-            return ret;
+    if ((unsigned)interpolate >= INTERPOLATE_COUNT)
+        return AVERROR(EINVAL);
+
+    td.in  = in;
+    td.out = out;
+    td.matrix[0] = matrix_y;
+    td.matrix[1] = td.matrix[2] = matrix_uv;
+    td.plane_w[0] = width;
+    td.plane_w[1] = td.plane_w[2] = cw;
+    td.plane_h[0] = height;
+    td.plane_h[1] = td.plane_h[2] = ch;
+    td.interpolate = interpolate;
+    td.fill = fill;
+
+    ctx->internal->execute(ctx, transform_slice, &td, NULL,
+                           FFMIN(ch, ff_filter_get_nb_threads(ctx)));
+    return 0;
+}
+
+/**
+ * Read the original motion of every frame from a log written by the
+ * filename option.
+ */
+static av_cold int load_motion(AVFilterContext *ctx)
+{
+    DeshakeContext *deshake = ctx->priv;
+    char line[256];
+    FILE *f;
+    int ret = 0;
+
+    if (deshake->filename && !strcmp(deshake->filename, deshake->input)) {
+        av_log(ctx, AV_LOG_ERROR, "filename and input must be different files\n");
+        return AVERROR(EINVAL);
     }
+
+    f = fopen(deshake->input, "r");
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "Cannot open motion log '%s'\n", deshake->input);
+        return ret;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        Transform t;
+        double avg, fin;
+
+        // The header line and anything else malformed is skipped
+        if (av_sscanf(line, "%lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf",
+                      &t.vec.x, &avg, &fin, &t.vec.y, &avg, &fin,
+                      &t.angle, &avg, &fin, &t.zoom) != 10)
+            continue;
+        if ((ret = av_reallocp_array(&deshake->motion, deshake->nb_motion + 1,
+                                     sizeof(*deshake->motion))) < 0) {
+            deshake->nb_motion = 0;
+            goto end;
+        }
+        deshake->motion[deshake->nb_motion++] = t;
+    }
+
+    if (!deshake->nb_motion) {
+        av_log(ctx, AV_LOG_ERROR, "No motion found in '%s'\n", deshake->input);
+        ret = AVERROR_INVALIDDATA;
+    }
+
+end:
+    fclose(f);
     return ret;
 }
 
@@ -351,6 +483,12 @@ static av_cold int init(AVFilterContext *ctx)
         return AVERROR_PATCHWELCOME;
     }
 
+    if (deshake->input) {
+        int ret = load_motion(ctx);
+        if (ret < 0)
+            return ret;
+    }
+
     if (deshake->filename)
         deshake->fp = fopen(deshake->filename, "w");
     if (deshake->fp)
@@ -403,6 +541,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->mvs);
+    deshake->mvs_size = 0;
+    av_freep(&deshake->motion);
+    deshake->nb_motion = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -435,9 +577,18 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     if (!deshake->sad)
         return AVERROR(EINVAL);
 
-    if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
+    if (deshake->input && deshake->motion_pos == deshake->nb_motion) {
+        av_log(link->dst, AV_LOG_WARNING, "Motion log has only %d frames, "
+               "searching motion for the remaining ones\n", deshake->nb_motion);
+        deshake->motion_pos++;
+    }
+
+    if (deshake->motion_pos < deshake->nb_motion) {
+        // Use the motion found by a previous pass
+        t = deshake->motion[deshake->motion_pos++];
+    } else if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,9 +605,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        av_frame_free(&out);
+        return ret;
     }
-
 
     // Copy transform so we can output it later to compare to the smoothed value
     orig.vec.x = t.vec.x;
@@ -482,9 +637,10 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     t.vec.y *= -1;
     t.angle *= -1;
 
-    // Write statistics to file
+    // Write statistics to file, the original motion exactly so that a
+    // second pass reading it with the input option gives the same output
     if (deshake->fp) {
-        snprintf(tmp, 256, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f\n", orig.vec.x, deshake->avg.vec.x, t.vec.x, orig.vec.y, deshake->avg.vec.y, t.vec.y, orig.angle, deshake->avg.angle, t.angle, orig.zoom, deshake->avg.zoom, t.zoom);
+        snprintf(tmp, 256, "%.17g, %f, %f, %.17g, %f, %f, %.17g, %f, %f, %.17g, %f, %f\n", orig.vec.x, deshake->avg.vec.x, t.vec.x, orig.vec.y, deshake->avg.vec.y, t.vec.y, orig.angle, deshake->avg.angle, t.angle, orig.zoom, deshake->avg.zoom, t.zoom);
         fwrite(tmp, 1, strlen(tmp), deshake->fp);
     }
 
@@ -560,4 +716,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -261,13 +261,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     const AVPixFmtDescriptor *desc;
     int i;
 
-    out = ff_get_video_buffer(outlink, inlink->w, inlink->h);
+    out = ff_get_video_buffer_in_place(outlink, in);
     if (!out) {
         av_frame_free(&in);
         return AVERROR(ENOMEM);
     }
 
-    av_frame_copy_props(out, in);
     desc = av_pix_fmt_desc_get(inlink->format);
 
     eq->var_values[VAR_N]   = inlink->frame_count_out;
@@ -293,12 +292,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         if (eq->param[i].adjust)
             eq->param[i].adjust(&eq->param[i], out->data[i], out->linesize[i],
                                  in->data[i], in->linesize[i], w, h);
-        else
+        else if (out != in)
             av_image_copy_plane(out->data[i], out->linesize[i],
                                 in->data[i], in->linesize[i], w, h);
     }
 
-    av_frame_free(&in);
+    if (out != in)
+        av_frame_free(&in);
     return ff_filter_frame(outlink, out);
 }
 
@@ -339,6 +339,7 @@ static const AVFilterPad eq_inputs[] = {
         .type = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
         .config_props = config_props,
+        .in_place     = 1,
     },
     { NULL }
 };
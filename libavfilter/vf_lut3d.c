@@ -69,18 +69,30 @@ typedef struct Lut3DPreLut {
     float* lut[3];
 } Lut3DPreLut;
 
+/**
+ * Position in the 3D LUT of an input component value, with the offsets
+ * already multiplied by the stride of that component.
+ */
+typedef struct Lut3DCoord {
+    int near, prev, next;
+    float d;
+} Lut3DCoord;
+
 typedef struct LUT3DContext {
     const AVClass *class;
     int interpolation;          ///<interp_mode
     char *file;
     uint8_t rgba_map[4];
     int step;
+    int depth;
     avfilter_action_func *interp;
     struct rgbvec scale;
     struct rgbvec *lut;
     int lutsize;
     int lutsize2;
     Lut3DPreLut prelut;
+    Lut3DCoord *coords[3];      ///< per component, for each integer input value
+    int coords_lutsize;         ///< lutsize the coords were computed for, 0 if none
 #if CONFIG_HALDCLUT_FILTER
     uint8_t clut_rgba_map[4];
     int clut_step;
@@ -159,22 +171,18 @@ static inline struct rgbvec interp_nearest(const LUT3DContext *lut3d,
  * Interpolate using the 8 vertices of a cube
  * @see https://en.wikipedia.org/wiki/Trilinear_interpolation
  */
-static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
-                                             const struct rgbvec *s)
+static av_always_inline struct rgbvec trilinear(const struct rgbvec *lut,
+                                                const int prev[3], const int next[3],
+                                                const struct rgbvec d)
 {
-    const int lutsize2 = lut3d->lutsize2;
-    const int lutsize  = lut3d->lutsize;
-    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
-    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
-    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-    const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-    const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
-    const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
-    const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
+    const struct rgbvec c000 = lut[prev[0] + prev[1] + prev[2]];
+    const struct rgbvec c001 = lut[prev[0] + prev[1] + next[2]];
+    const struct rgbvec c010 = lut[prev[0] + next[1] + prev[2]];
+    const struct rgbvec c011 = lut[prev[0] + next[1] + next[2]];
+    const struct rgbvec c100 = lut[next[0] + prev[1] + prev[2]];
+    const struct rgbvec c101 = lut[next[0] + prev[1] + next[2]];
+    const struct rgbvec c110 = lut[next[0] + next[1] + prev[2]];
+    const struct rgbvec c111 = lut[next[0] + next[1] + next[2]];
     const struct rgbvec c00  = lerp(&c000, &c100, d.r);
     const struct rgbvec c10  = lerp(&c010, &c110, d.r);
     const struct rgbvec c01  = lerp(&c001, &c101, d.r);
@@ -189,53 +197,49 @@ static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
  * Tetrahedral interpolation. Based on code found in Truelight Software Library paper.
  * @see http://www.filmlight.ltd.uk/pdf/whitepapers/FL-TL-TN-0057-SoftwareLib.pdf
  */
-static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
-                                               const struct rgbvec *s)
+static av_always_inline struct rgbvec tetrahedral(const struct rgbvec *lut,
+                                                  const int prev[3], const int next[3],
+                                                  const struct rgbvec d)
 {
-    const int lutsize2 = lut3d->lutsize2;
-    const int lutsize  = lut3d->lutsize;
-    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
-    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
-    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
+    const struct rgbvec c000 = lut[prev[0] + prev[1] + prev[2]];
+    const struct rgbvec c111 = lut[next[0] + next[1] + next[2]];
     struct rgbvec c;
     if (d.r > d.g) {
         if (d.g > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c100 = lut[next[0] + prev[1] + prev[2]];
+            const struct rgbvec c110 = lut[next[0] + next[1] + prev[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.g) * c100.r + (d.g-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.g) * c100.g + (d.g-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.g) * c100.b + (d.g-d.b) * c110.b + (d.b) * c111.b;
         } else if (d.r > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c100 = lut[next[0] + prev[1] + prev[2]];
+            const struct rgbvec c101 = lut[next[0] + prev[1] + next[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.b) * c100.r + (d.b-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.b) * c100.g + (d.b-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.b) * c100.b + (d.b-d.g) * c101.b + (d.g) * c111.b;
         } else {
-            const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c001 = lut[prev[0] + prev[1] + next[2]];
+            const struct rgbvec c101 = lut[next[0] + prev[1] + next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.r) * c001.r + (d.r-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.r) * c001.g + (d.r-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.r) * c001.b + (d.r-d.g) * c101.b + (d.g) * c111.b;
         }
     } else {
         if (d.b > d.g) {
-            const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
+            const struct rgbvec c001 = lut[prev[0] + prev[1] + next[2]];
+            const struct rgbvec c011 = lut[prev[0] + next[1] + next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.g) * c001.r + (d.g-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.g) * c001.g + (d.g-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.g) * c001.b + (d.g-d.r) * c011.b + (d.r) * c111.b;
         } else if (d.b > d.r) {
-            const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
+            const struct rgbvec c010 = lut[prev[0] + next[1] + prev[2]];
+            const struct rgbvec c011 = lut[prev[0] + next[1] + next[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.b) * c010.r + (d.b-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.b) * c010.g + (d.b-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.b) * c010.b + (d.b-d.r) * c011.b + (d.r) * c111.b;
         } else {
-            const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c010 = lut[prev[0] + next[1] + prev[2]];
+            const struct rgbvec c110 = lut[next[0] + next[1] + prev[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.r) * c010.r + (d.r-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.r) * c010.g + (d.r-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.r) * c010.b + (d.r-d.b) * c110.b + (d.b) * c111.b;
@@ -244,6 +248,57 @@ static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
     return c;
 }
 
+static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
+                                             const struct rgbvec *s)
+{
+    const int lutsize2 = lut3d->lutsize2;
+    const int lutsize  = lut3d->lutsize;
+    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
+    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
+    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
+    const int prev_offset[] = {prev[0] * lutsize2, prev[1] * lutsize, prev[2]};
+    const int next_offset[] = {next[0] * lutsize2, next[1] * lutsize, next[2]};
+    return trilinear(lut3d->lut, prev_offset, next_offset, d);
+}
+
+static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
+                                               const struct rgbvec *s)
+{
+    const int lutsize2 = lut3d->lutsize2;
+    const int lutsize  = lut3d->lutsize;
+    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
+    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
+    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
+    const int prev_offset[] = {prev[0] * lutsize2, prev[1] * lutsize, prev[2]};
+    const int next_offset[] = {next[0] * lutsize2, next[1] * lutsize, next[2]};
+    return tetrahedral(lut3d->lut, prev_offset, next_offset, d);
+}
+
+/* same as above, from precomputed coordinates */
+static inline struct rgbvec interp_coords_nearest(const struct rgbvec *lut, const Lut3DCoord *r,
+                                                  const Lut3DCoord *g, const Lut3DCoord *b)
+{
+    return lut[r->near + g->near + b->near];
+}
+
+static inline struct rgbvec interp_coords_trilinear(const struct rgbvec *lut, const Lut3DCoord *r,
+                                                    const Lut3DCoord *g, const Lut3DCoord *b)
+{
+    const int prev[] = {r->prev, g->prev, b->prev};
+    const int next[] = {r->next, g->next, b->next};
+    const struct rgbvec d = {r->d, g->d, b->d};
+    return trilinear(lut, prev, next, d);
+}
+
+static inline struct rgbvec interp_coords_tetrahedral(const struct rgbvec *lut, const Lut3DCoord *r,
+                                                      const Lut3DCoord *g, const Lut3DCoord *b)
+{
+    const int prev[] = {r->prev, g->prev, b->prev};
+    const int next[] = {r->next, g->next, b->next};
+    const struct rgbvec d = {r->d, g->d, b->d};
+    return tetrahedral(lut, prev, next, d);
+}
+
 static inline float prelut_interp_1d_linear(const Lut3DPreLut *prelut,
                                             int idx, const float s)
 {
@@ -272,6 +327,48 @@ static inline struct rgbvec apply_prelut(const Lut3DPreLut *prelut,
     return c;
 }
 
+/**
+ * Integer inputs up to this depth look up their position in the LUT (after
+ * the prelut and scaling) in per-component tables instead of computing it
+ * for every pixel.
+ */
+#define MAX_COORDS_DEPTH 12
+
+static int compute_coords(LUT3DContext *lut3d)
+{
+    const Lut3DPreLut *prelut = &lut3d->prelut;
+    const int max = (1 << lut3d->depth) - 1;
+    const float lut_max = lut3d->lutsize - 1;
+    const float scale_f = 1.0f / max;
+    const float scale[3] = {lut3d->scale.r * lut_max,
+                            lut3d->scale.g * lut_max,
+                            lut3d->scale.b * lut_max};
+    const int stride[3] = {lut3d->lutsize2, lut3d->lutsize, 1};
+    int c, v;
+
+    for (c = 0; c < 3; c++) {
+        Lut3DCoord *coords;
+
+        av_freep(&lut3d->coords[c]);
+        coords = lut3d->coords[c] = av_malloc_array(max + 1, sizeof(*coords));
+        if (!coords)
+            return AVERROR(ENOMEM);
+
+        for (v = 0; v <= max; v++) {
+            float s = v * scale_f;
+            if (prelut->size > 0)
+                s = prelut_interp_1d_linear(prelut, c, s);
+            s = av_clipf(s * scale[c], 0, lut_max);
+            coords[v].near = NEAR(s) * stride[c];
+            coords[v].prev = PREV(s) * stride[c];
+            coords[v].next = NEXT(s) * stride[c];
+            coords[v].d    = s - PREV(s);
+        }
+    }
+    lut3d->coords_lutsize = lut3d->lutsize;
+    return 0;
+}
+
 #define DEFINE_INTERP_FUNC_PLANAR(name, nbits, depth)                                                  \
 static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
 {                                                                                                      \
@@ -297,6 +394,10 @@ static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, i
     const float scale_r = lut3d->scale.r * lut_max;                                                    \
     const float scale_g = lut3d->scale.g * lut_max;                                                    \
     const float scale_b = lut3d->scale.b * lut_max;                                                    \
+    const int max = (1<<depth) - 1;                                                                    \
+    const Lut3DCoord *coords_r = lut3d->coords[0];                                                     \
+    const Lut3DCoord *coords_g = lut3d->coords[1];                                                     \
+    const Lut3DCoord *coords_b = lut3d->coords[2];                                                     \
                                                                                                        \
     for (y = slice_start; y < slice_end; y++) {                                                        \
         uint##nbits##_t *dstg = (uint##nbits##_t *)grow;                                               \
@@ -308,14 +409,21 @@ static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, i
         const uint##nbits##_t *srcr = (const uint##nbits##_t *)srcrrow;                                \
         const uint##nbits##_t *srca = (const uint##nbits##_t *)srcarow;                                \
         for (x = 0; x < in->width; x++) {                                                              \
-            const struct rgbvec rgb = {srcr[x] * scale_f,                                              \
-                                       srcg[x] * scale_f,                                              \
-                                       srcb[x] * scale_f};                                             \
-            const struct rgbvec prelut_rgb = apply_prelut(prelut, &rgb);                               \
-            const struct rgbvec scaled_rgb = {av_clipf(prelut_rgb.r * scale_r, 0, lut_max),            \
-                                              av_clipf(prelut_rgb.g * scale_g, 0, lut_max),            \
-                                              av_clipf(prelut_rgb.b * scale_b, 0, lut_max)};           \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                     \
+            struct rgbvec vec;                                                                         \
+            if (depth <= MAX_COORDS_DEPTH) {                                                           \
+                vec = interp_coords_##name(lut3d->lut, &coords_r[FFMIN(srcr[x], max)],                 \
+                                                       &coords_g[FFMIN(srcg[x], max)],                 \
+                                                       &coords_b[FFMIN(srcb[x], max)]);                \
+            } else {                                                                                   \
+                const struct rgbvec rgb = {srcr[x] * scale_f,                                          \
+                                           srcg[x] * scale_f,                                          \
+                                           srcb[x] * scale_f};                                         \
+                const struct rgbvec prelut_rgb = apply_prelut(prelut, &rgb);                           \
+                const struct rgbvec scaled_rgb = {av_clipf(prelut_rgb.r * scale_r, 0, lut_max),        \
+                                                  av_clipf(prelut_rgb.g * scale_g, 0, lut_max),        \
+                                                  av_clipf(prelut_rgb.b * scale_b, 0, lut_max)};       \
+                vec = interp_##name(lut3d, &scaled_rgb);                                               \
+            }                                                                                          \
             dstr[x] = av_clip_uintp2(vec.r * (float)((1<<depth) - 1), depth);                          \
             dstg[x] = av_clip_uintp2(vec.g * (float)((1<<depth) - 1), depth);                          \
             dstb[x] = av_clip_uintp2(vec.b * (float)((1<<depth) - 1), depth);                          \
@@ -447,19 +555,29 @@ static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, i
     const float scale_r = lut3d->scale.r * lut_max;                                                 \
     const float scale_g = lut3d->scale.g * lut_max;                                                 \
     const float scale_b = lut3d->scale.b * lut_max;                                                 \
+    const Lut3DCoord *coords_r = lut3d->coords[0];                                                  \
+    const Lut3DCoord *coords_g = lut3d->coords[1];                                                  \
+    const Lut3DCoord *coords_b = lut3d->coords[2];                                                  \
                                                                                                     \
     for (y = slice_start; y < slice_end; y++) {                                                     \
         uint##nbits##_t *dst = (uint##nbits##_t *)dstrow;                                           \
         const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow;                               \
         for (x = 0; x < in->width * step; x += step) {                                              \
-            const struct rgbvec rgb = {src[x + r] * scale_f,                                        \
-                                       src[x + g] * scale_f,                                        \
-                                       src[x + b] * scale_f};                                       \
-            const struct rgbvec prelut_rgb = apply_prelut(prelut, &rgb);                            \
-            const struct rgbvec scaled_rgb = {av_clipf(prelut_rgb.r * scale_r, 0, lut_max),         \
-                                              av_clipf(prelut_rgb.g * scale_g, 0, lut_max),         \
-                                              av_clipf(prelut_rgb.b * scale_b, 0, lut_max)};        \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                  \
+            struct rgbvec vec;                                                                      \
+            if (nbits <= MAX_COORDS_DEPTH) {                                                        \
+                vec = interp_coords_##name(lut3d->lut, &coords_r[src[x + r]],                       \
+                                                       &coords_g[src[x + g]],                       \
+                                                       &coords_b[src[x + b]]);                      \
+            } else {                                                                                \
+                const struct rgbvec rgb = {src[x + r] * scale_f,                                    \
+                                           src[x + g] * scale_f,                                    \
+                                           src[x + b] * scale_f};                                   \
+                const struct rgbvec prelut_rgb = apply_prelut(prelut, &rgb);                        \
+                const struct rgbvec scaled_rgb = {av_clipf(prelut_rgb.r * scale_r, 0, lut_max),     \
+                                                  av_clipf(prelut_rgb.g * scale_g, 0, lut_max),     \
+                                                  av_clipf(prelut_rgb.b * scale_b, 0, lut_max)};    \
+                vec = interp_##name(lut3d, &scaled_rgb);                                            \
+            }                                                                                       \
             dst[x + r] = av_clip_uint##nbits(vec.r * (float)((1<<nbits) - 1));                      \
             dst[x + g] = av_clip_uint##nbits(vec.g * (float)((1<<nbits) - 1));                      \
             dst[x + b] = av_clip_uint##nbits(vec.b * (float)((1<<nbits) - 1));                      \
@@ -1068,6 +1186,8 @@ static int config_input(AVFilterLink *inlink)
     isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
     ff_fill_rgba_map(lut3d->rgba_map, inlink->format);
     lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + is16bit);
+    lut3d->depth = isfloat ? 0 : depth;
+    lut3d->coords_lutsize = 0;
 
 #define SET_FUNC(name) do {                                     \
     if (planar && !isfloat) {                                   \
@@ -1103,6 +1223,12 @@ static AVFrame *apply_lut(AVFilterLink *inlink, AVFrame *in)
     AVFrame *out;
     ThreadData td;
 
+    if (lut3d->depth > 0 && lut3d->depth <= MAX_COORDS_DEPTH &&
+        lut3d->coords_lutsize != lut3d->lutsize && compute_coords(lut3d) < 0) {
+        av_frame_free(&in);
+        return NULL;
+    }
+
     if (av_frame_is_writable(in)) {
         out = in;
     } else {
@@ -1202,6 +1328,7 @@ static av_cold void lut3d_uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++) {
         av_freep(&lut3d->prelut.lut[i]);
+        av_freep(&lut3d->coords[i]);
     }
 }
 
@@ -1443,6 +1570,8 @@ static int update_apply_clut(FFFrameSync *fs)
     else
         update_clut_packed(ctx->priv, second);
     out = apply_lut(inlink, master);
+    if (!out)
+        return AVERROR(ENOMEM);
     return ff_filter_frame(ctx->outputs[0], out);
 }
 
@@ -1457,8 +1586,11 @@ static av_cold int haldclut_init(AVFilterContext *ctx)
 static av_cold void haldclut_uninit(AVFilterContext *ctx)
 {
     LUT3DContext *lut3d = ctx->priv;
+    int i;
     ff_framesync_uninit(&lut3d->fs);
     av_freep(&lut3d->lut);
+    for (i = 0; i < 3; i++)
+        av_freep(&lut3d->coords[i]);
 }
 
 static const AVOption haldclut_options[] = {
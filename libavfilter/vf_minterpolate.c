@@ -26,6 +26,7 @@
 #include "libavutil/motion_vector.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
@@ -163,6 +164,14 @@ typedef struct Frame {
     Block *blocks;
 } Frame;
 
+typedef struct ThreadData {
+    Block *blocks;
+    uint8_t *data_ref[2];
+    int pred_x, pred_y;
+    int alpha;
+    AVFrame *out;
+} ThreadData;
+
 typedef struct MIContext {
     const AVClass *class;
     AVMotionEstContext me_ctx;
@@ -181,6 +190,7 @@ typedef struct MIContext {
     PixelMVS *pixel_mvs;
     PixelWeights *pixel_weights;
     PixelRefs *pixel_refs;
+    uint64_t (*nb_sbads)[9];
     int (*mv_table[3])[2][2];
     int64_t out_pts;
     int b_width, b_height, b_count;
@@ -196,6 +206,13 @@ typedef struct MIContext {
     int log2_chroma_w;
     int log2_chroma_h;
     int nb_planes;
+
+    int wavefront;
+    int *row_progress;
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t progress_cond;
+#endif
 } MIContext;
 
 #define OFFSET(x) offsetof(MIContext, x)
@@ -263,20 +280,17 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     int linesize = me_ctx->linesize;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, me_ctx->x_min, me_ctx->x_max);
     y = av_clip(y, me_ctx->y_min, me_ctx->y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - me_ctx->x_min, me_ctx->x_max - x), FFMIN(x - me_ctx->x_min, me_ctx->x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - me_ctx->y_min, me_ctx->y_max - y), FFMIN(y - me_ctx->y_min, me_ctx->y_max - y));
 
-    data_cur += (y + mv_y) * linesize;
-    data_next += (y - mv_y) * linesize;
-
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    sbad = ff_me_sad(me_ctx, data_cur + x + mv_x + (y + mv_y) * linesize,
+                     data_next + x - mv_x + (y - mv_y) * linesize,
+                     linesize, me_ctx->mb_size);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -292,17 +306,19 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, x_min, x_max);
     y = av_clip(y, y_min, y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - x_min, x_max - x), FFMIN(x - x_min, x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - y_min, y_max - y), FFMIN(y - y_min, y_max - y));
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    x -= me_ctx->mb_size / 2;
+    y -= me_ctx->mb_size / 2;
+    sbad = ff_me_sad(me_ctx, data_cur + x + mv_x + (y + mv_y) * linesize,
+                     data_next + x - mv_x + (y - mv_y) * linesize,
+                     linesize, me_ctx->mb_size * 3 / 2 + me_ctx->mb_size / 2);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -318,17 +334,16 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
     int mv_x = x_mv - x;
     int mv_y = y_mv - y;
-    int i, j;
-    uint64_t sad = 0;
+    uint64_t sad;
 
-    x = av_clip(x, x_min, x_max);
-    y = av_clip(y, y_min, y_max);
-    x_mv = av_clip(x_mv, x_min, x_max);
-    y_mv = av_clip(y_mv, y_min, y_max);
+    x = av_clip(x, x_min, x_max) - me_ctx->mb_size / 2;
+    y = av_clip(y, y_min, y_max) - me_ctx->mb_size / 2;
+    x_mv = av_clip(x_mv, x_min, x_max) - me_ctx->mb_size / 2;
+    y_mv = av_clip(y_mv, y_min, y_max) - me_ctx->mb_size / 2;
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    sad = ff_me_sad(me_ctx, data_cur + x + y * linesize,
+                    data_ref + x_mv + y_mv * linesize,
+                    linesize, me_ctx->mb_size * 3 / 2 + me_ctx->mb_size / 2);
 
     return sad + (FFABS(mv_x - me_ctx->pred_x) + FFABS(mv_y - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -375,6 +390,13 @@ static int config_input(AVFilterLink *inlink)
             if (!(mi_ctx->int_blocks = av_mallocz_array(mi_ctx->b_count, sizeof(Block))))
                 return AVERROR(ENOMEM);
 
+        if (mi_ctx->me_mode == ME_MODE_BILAT && mi_ctx->mc_mode == MC_MODE_AOBMC)
+            if (!(mi_ctx->nb_sbads = av_mallocz_array(mi_ctx->b_count, sizeof(*mi_ctx->nb_sbads))))
+                return AVERROR(ENOMEM);
+
+        if (!(mi_ctx->row_progress = av_mallocz_array(2 * mi_ctx->b_height, sizeof(*mi_ctx->row_progress))))
+            return AVERROR(ENOMEM);
+
         if (mi_ctx->me_method == AV_ME_METHOD_EPZS) {
             for (i = 0; i < 3; i++) {
                 mi_ctx->mv_table[i] = av_mallocz_array(mi_ctx->b_count, sizeof(*mi_ctx->mv_table[0]));
@@ -424,9 +446,9 @@ static int config_output(AVFilterLink *outlink)
         preds.nb++;\
     } while(0)
 
-static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int dir)
+static void search_mv(MIContext *mi_ctx, AVMotionEstContext *me_ctx, Block *blocks,
+                      int mb_x, int mb_y, int dir)
 {
-    AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
     AVMotionEstPredictor *preds = me_ctx->preds;
     Block *block = &blocks[mb_x + mb_y * mi_ctx->b_width];
 
@@ -566,8 +588,91 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
     block->mvs[dir][1] = mv[1] - y_mb;
 }
 
-static void bilateral_me(MIContext *mi_ctx)
+static void report_row_progress(MIContext *mi_ctx, int row, int n)
 {
+#if HAVE_THREADS
+    pthread_mutex_lock(&mi_ctx->progress_mutex);
+    mi_ctx->row_progress[row] = n;
+    pthread_cond_broadcast(&mi_ctx->progress_cond);
+    pthread_mutex_unlock(&mi_ctx->progress_mutex);
+#endif
+}
+
+static void await_row_progress(MIContext *mi_ctx, int row, int n)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&mi_ctx->progress_mutex);
+    while (mi_ctx->row_progress[row] < n)
+        pthread_cond_wait(&mi_ctx->progress_cond, &mi_ctx->progress_mutex);
+    pthread_mutex_unlock(&mi_ctx->progress_mutex);
+#endif
+}
+
+static int search_mv_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    AVMotionEstContext me_ctx = mi_ctx->me_ctx;
+    const int dir  = jobnr / mi_ctx->b_height;
+    const int mb_y = jobnr % mi_ctx->b_height;
+    int mb_x;
+
+    me_ctx.data_ref = td->data_ref[dir];
+
+    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+        /* the predictive searches need the left, top and top-right neighbours */
+        if (mi_ctx->wavefront && mb_y)
+            await_row_progress(mi_ctx, jobnr - 1, FFMIN(mb_x + 2, mi_ctx->b_width));
+
+        search_mv(mi_ctx, &me_ctx, td->blocks, mb_x, mb_y, dir);
+
+        if (mi_ctx->wavefront)
+            report_row_progress(mi_ctx, jobnr, mb_x + 1);
+    }
+
+    if (jobnr == nb_jobs - 1) {
+        td->pred_x = me_ctx.pred_x;
+        td->pred_y = me_ctx.pred_y;
+    }
+
+    return 0;
+}
+
+/**
+ * Search the motion vectors of all blocks, one block row per job. Rows are
+ * processed as a wavefront when the search method uses neighbour predictors.
+ * The shared ME context is left with the predictor of the last block, as if
+ * the blocks had been searched in raster order.
+ */
+static void search_mvs(AVFilterContext *ctx, Block *blocks, uint8_t *ref0, uint8_t *ref1, int nb_dirs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData td = { .blocks = blocks, .data_ref = { ref0, ref1 } };
+    const int nb_jobs = mi_ctx->b_height * nb_dirs;
+    const int predictive = mi_ctx->me_method == AV_ME_METHOD_EPZS ||
+                           mi_ctx->me_method == AV_ME_METHOD_UMH;
+    int i;
+
+    mi_ctx->wavefront = predictive && ff_filter_get_nb_threads(ctx) > 1;
+    memset(mi_ctx->row_progress, 0, nb_jobs * sizeof(*mi_ctx->row_progress));
+
+    td.pred_x = mi_ctx->me_ctx.pred_x;
+    td.pred_y = mi_ctx->me_ctx.pred_y;
+    /* rows waiting for each other's progress must all run concurrently,
+     * which the shared pool does not guarantee */
+    if (mi_ctx->wavefront && ctx->graph->shared_threads) {
+        mi_ctx->wavefront = 0;
+        for (i = 0; i < nb_jobs; i++)
+            search_mv_slice(ctx, &td, i, nb_jobs);
+    } else
+        ctx->internal->execute(ctx, search_mv_slice, &td, NULL, nb_jobs);
+    mi_ctx->me_ctx.pred_x = td.pred_x;
+    mi_ctx->me_ctx.pred_y = td.pred_y;
+}
+
+static void bilateral_me(AVFilterContext *ctx)
+{
+    MIContext *mi_ctx = ctx->priv;
     Block *block;
     int mb_x, mb_y;
 
@@ -582,9 +687,60 @@ static void bilateral_me(MIContext *mi_ctx)
             block->mvs[0][1] = 0;
         }
 
-    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-            search_mv(mi_ctx, mi_ctx->int_blocks, mb_x, mb_y, 0);
+    search_mvs(ctx, mi_ctx->int_blocks, mi_ctx->me_ctx.data_ref, NULL, 1);
+}
+
+static int block_sbad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    const int slice_start = (mi_ctx->b_height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (mi_ctx->b_height * (jobnr + 1)) / nb_jobs;
+    int mb_x, mb_y;
+
+    for (mb_y = slice_start; mb_y < slice_end; mb_y++)
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+            int x_mb = mb_x << mi_ctx->log2_mb_size;
+            int y_mb = mb_y << mi_ctx->log2_mb_size;
+            Block *block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+
+            block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
+        }
+
+    return 0;
+}
+
+/**
+ * Cost of each block's motion vector applied to its 8 neighbours, used to
+ * weight the overlapped area in adaptive OBMC. Neighbours outside of the
+ * block grid get 0, which leaves the OBMC weight untouched.
+ */
+static int nb_sbads_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    const int slice_start = (mi_ctx->b_height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (mi_ctx->b_height * (jobnr + 1)) / nb_jobs;
+    int mb_x, mb_y, nb_x, nb_y;
+
+    for (mb_y = slice_start; mb_y < slice_end; mb_y++)
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+            Block *block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+            uint64_t *sbads = mi_ctx->nb_sbads[mb_x + mb_y * mi_ctx->b_width];
+
+            for (nb_y = mb_y - 1; nb_y <= mb_y + 1; nb_y++)
+                for (nb_x = mb_x - 1; nb_x <= mb_x + 1; nb_x++) {
+                    int x_nb = nb_x << mi_ctx->log2_mb_size;
+                    int y_nb = nb_y << mi_ctx->log2_mb_size;
+                    uint64_t *sbad = &sbads[nb_x - mb_x + 1 + (nb_y - mb_y + 1) * 3];
+
+                    if (nb_x < 0 || nb_x >= mi_ctx->b_width || nb_y < 0 || nb_y >= mi_ctx->b_height ||
+                        nb_x == mb_x && nb_y == mb_y)
+                        *sbad = 0;
+                    else
+                        *sbad = get_sbad(&mi_ctx->me_ctx, x_nb, y_nb, x_nb + block->mvs[0][0], y_nb + block->mvs[0][1]);
+                }
+        }
+
+    return 0;
 }
 
 static int var_size_bme(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n)
@@ -744,7 +900,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
     AVFilterContext *ctx = inlink->dst;
     MIContext *mi_ctx = ctx->priv;
     Frame frame_tmp;
-    int mb_x, mb_y, dir;
+    int mb_x, mb_y;
 
     av_frame_free(&mi_ctx->frames[0].avf);
     frame_tmp = mi_ctx->frames[0];
@@ -762,15 +918,12 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
         if (mi_ctx->me_mode == ME_MODE_BIDIR) {
 
             if (mi_ctx->frames[1].avf) {
-                for (dir = 0; dir < 2; dir++) {
-                    mi_ctx->me_ctx.linesize = mi_ctx->frames[2].avf->linesize[0];
-                    mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
-                    mi_ctx->me_ctx.data_ref = mi_ctx->frames[dir ? 3 : 1].avf->data[0];
-
-                    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-                            search_mv(mi_ctx, mi_ctx->frames[2].blocks, mb_x, mb_y, dir);
-                }
+                mi_ctx->me_ctx.linesize = mi_ctx->frames[2].avf->linesize[0];
+                mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
+
+                search_mvs(ctx, mi_ctx->frames[2].blocks,
+                           mi_ctx->frames[1].avf->data[0],
+                           mi_ctx->frames[3].avf->data[0], 2);
             }
 
         } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
@@ -784,19 +937,11 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
             mi_ctx->me_ctx.data_cur = mi_ctx->frames[1].avf->data[0];
             mi_ctx->me_ctx.data_ref = mi_ctx->frames[2].avf->data[0];
 
-            bilateral_me(mi_ctx);
+            bilateral_me(ctx);
 
-            if (mi_ctx->mc_mode == MC_MODE_AOBMC) {
-
-                for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
-                        int x_mb = mb_x << mi_ctx->log2_mb_size;
-                        int y_mb = mb_y << mi_ctx->log2_mb_size;
-                        block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
-
-                        block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
-                    }
-            }
+            if (mi_ctx->mc_mode == MC_MODE_AOBMC)
+                ctx->internal->execute(ctx, block_sbad_slice, NULL, NULL,
+                                       FFMIN(mi_ctx->b_height, ff_filter_get_nb_threads(ctx)));
 
             if (mi_ctx->vsbmc) {
 
@@ -819,6 +964,10 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
                 if (ret = cluster_mvs(mi_ctx))
                     return ret;
             }
+
+            if (mi_ctx->mc_mode == MC_MODE_AOBMC)
+                ctx->internal->execute(ctx, nb_sbads_slice, NULL, NULL,
+                                       FFMIN(mi_ctx->b_height, ff_filter_get_nb_threads(ctx)));
         }
     }
 
@@ -865,17 +1014,13 @@ static int detect_scene_change(MIContext *mi_ctx)
         pixel_refs->nb++;\
     } while(0)
 
-static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
+static void bidirectional_obmc(MIContext *mi_ctx, int alpha, int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
     int height = mi_ctx->frames[0].avf->height;
     int mb_y, mb_x, dir;
 
-    for (y = 0; y < height; y++)
-        for (x = 0; x < width; x++)
-            mi_ctx->pixel_refs[x + y * width].nb = 0;
-
     for (dir = 0; dir < 2; dir++)
         for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
             for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
@@ -889,9 +1034,9 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
                 start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2 + mv_y * a / ALPHA_MAX;
 
                 startc_x = av_clip(start_x, 0, width - 1);
-                startc_y = av_clip(start_y, 0, height - 1);
+                startc_y = FFMAX(av_clip(start_y, 0, height - 1), slice_start);
                 endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-                endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
+                endc_y = FFMIN(av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1), slice_end);
 
                 if (dir) {
                     mv_x = -mv_x;
@@ -915,65 +1060,80 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
             }
 }
 
-static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
+static av_always_inline int mc_pixel(MIContext *mi_ctx, int alpha, int plane, int chroma,
+                                     int x, int y, int width)
 {
-    int x, y, plane;
+    int x_mv, y_mv;
+    int weight_sum = 0;
+    int i, val = 0;
+    PixelMVS *pixel_mvs = &mi_ctx->pixel_mvs[x + y * width];
+    PixelWeights *pixel_weights = &mi_ctx->pixel_weights[x + y * width];
+    PixelRefs *pixel_refs = &mi_ctx->pixel_refs[x + y * width];
+
+    for (i = 0; i < pixel_refs->nb; i++)
+        weight_sum += pixel_weights->weights[i];
+
+    if (!weight_sum || !pixel_refs->nb) {
+        pixel_weights->weights[0] = ALPHA_MAX - alpha;
+        pixel_refs->refs[0] = 1;
+        pixel_mvs->mvs[0][0] = 0;
+        pixel_mvs->mvs[0][1] = 0;
+        pixel_weights->weights[1] = alpha;
+        pixel_refs->refs[1] = 2;
+        pixel_mvs->mvs[1][0] = 0;
+        pixel_mvs->mvs[1][1] = 0;
+        pixel_refs->nb = 2;
+
+        weight_sum = ALPHA_MAX;
+    }
 
-    for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
-        int width = avf_out->width;
-        int height = avf_out->height;
-        int chroma = plane == 1 || plane == 2;
+    for (i = 0; i < pixel_refs->nb; i++) {
+        Frame *frame = &mi_ctx->frames[pixel_refs->refs[i]];
+        if (chroma) {
+            x_mv = (x >> mi_ctx->log2_chroma_w) + pixel_mvs->mvs[i][0] / (1 << mi_ctx->log2_chroma_w);
+            y_mv = (y >> mi_ctx->log2_chroma_h) + pixel_mvs->mvs[i][1] / (1 << mi_ctx->log2_chroma_h);
+        } else {
+            x_mv = x + pixel_mvs->mvs[i][0];
+            y_mv = y + pixel_mvs->mvs[i][1];
+        }
 
-        for (y = 0; y < height; y++)
-            for (x = 0; x < width; x++) {
-                int x_mv, y_mv;
-                int weight_sum = 0;
-                int i, val = 0;
-                PixelMVS *pixel_mvs = &mi_ctx->pixel_mvs[x + y * avf_out->width];
-                PixelWeights *pixel_weights = &mi_ctx->pixel_weights[x + y * avf_out->width];
-                PixelRefs *pixel_refs = &mi_ctx->pixel_refs[x + y * avf_out->width];
-
-                for (i = 0; i < pixel_refs->nb; i++)
-                    weight_sum += pixel_weights->weights[i];
-
-                if (!weight_sum || !pixel_refs->nb) {
-                    pixel_weights->weights[0] = ALPHA_MAX - alpha;
-                    pixel_refs->refs[0] = 1;
-                    pixel_mvs->mvs[0][0] = 0;
-                    pixel_mvs->mvs[0][1] = 0;
-                    pixel_weights->weights[1] = alpha;
-                    pixel_refs->refs[1] = 2;
-                    pixel_mvs->mvs[1][0] = 0;
-                    pixel_mvs->mvs[1][1] = 0;
-                    pixel_refs->nb = 2;
-
-                    weight_sum = ALPHA_MAX;
-                }
+        val += pixel_weights->weights[i] * frame->avf->data[plane][x_mv + y_mv * frame->avf->linesize[plane]];
+    }
 
-                for (i = 0; i < pixel_refs->nb; i++) {
-                    Frame *frame = &mi_ctx->frames[pixel_refs->refs[i]];
-                    if (chroma) {
-                        x_mv = (x >> mi_ctx->log2_chroma_w) + pixel_mvs->mvs[i][0] / (1 << mi_ctx->log2_chroma_w);
-                        y_mv = (y >> mi_ctx->log2_chroma_h) + pixel_mvs->mvs[i][1] / (1 << mi_ctx->log2_chroma_h);
-                    } else {
-                        x_mv = x + pixel_mvs->mvs[i][0];
-                        y_mv = y + pixel_mvs->mvs[i][1];
-                    }
+    return ROUNDED_DIV(val, weight_sum);
+}
 
-                    val += pixel_weights->weights[i] * frame->avf->data[plane][x_mv + y_mv * frame->avf->linesize[plane]];
-                }
+static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out, int slice_start, int slice_end)
+{
+    const int width  = avf_out->width;
+    const int height = avf_out->height;
+    int x, y, plane;
 
-                val = ROUNDED_DIV(val, weight_sum);
+    for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
+        uint8_t *dst = avf_out->data[plane];
+        ptrdiff_t linesize = avf_out->linesize[plane];
+
+        if (plane != 1 && plane != 2) {
+            for (y = slice_start; y < slice_end; y++)
+                for (x = 0; x < width; x++)
+                    dst[x + y * linesize] = mc_pixel(mi_ctx, alpha, plane, 0, x, y, width);
+            continue;
+        }
 
-                if (chroma)
-                    avf_out->data[plane][(x >> mi_ctx->log2_chroma_w) + (y >> mi_ctx->log2_chroma_h) * avf_out->linesize[plane]] = val;
-                else
-                    avf_out->data[plane][x + y * avf_out->linesize[plane]] = val;
+        /* each chroma sample takes the value interpolated at the last luma
+         * position mapping to it, only compute that one */
+        for (y = slice_start >> mi_ctx->log2_chroma_h; y < AV_CEIL_RSHIFT(slice_end, mi_ctx->log2_chroma_h); y++) {
+            int y_luma = FFMIN(((y + 1) << mi_ctx->log2_chroma_h) - 1, height - 1);
+            for (x = 0; x < AV_CEIL_RSHIFT(width, mi_ctx->log2_chroma_w); x++) {
+                int x_luma = FFMIN(((x + 1) << mi_ctx->log2_chroma_w) - 1, width - 1);
+                dst[x + y * linesize] = mc_pixel(mi_ctx, alpha, plane, 1, x_luma, y_luma, width);
             }
+        }
     }
 }
 
-static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha)
+static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha,
+                         int slice_start, int slice_end)
 {
     int sb_x, sb_y;
     int width = mi_ctx->frames[0].avf->width;
@@ -984,7 +1144,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
             Block *sb = &block->subs[sb_x + sb_y * 2];
 
             if (sb->sb)
-                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha);
+                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha,
+                             slice_start, slice_end);
             else {
                 int x, y;
                 int mv_x = sb->mvs[0][0] * 2;
@@ -993,7 +1154,9 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
                 int start_x = x_mb + (sb_x << (n - 1));
                 int start_y = y_mb + (sb_y << (n - 1));
                 int end_x = start_x + (1 << (n - 1));
-                int end_y = start_y + (1 << (n - 1));
+                int end_y = FFMIN(start_y + (1 << (n - 1)), slice_end);
+
+                start_y = FFMAX(start_y, slice_start);
 
                 for (y = start_y; y < end_y; y++)  {
                     int y_min = -y;
@@ -1012,7 +1175,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
         }
 }
 
-static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha)
+static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha,
+                           int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
@@ -1020,30 +1184,20 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
 
     Block *nb;
     int nb_x, nb_y;
-    uint64_t sbads[9];
+    const uint64_t *sbads = mi_ctx->nb_sbads ? mi_ctx->nb_sbads[mb_x + mb_y * mi_ctx->b_width] : NULL;
 
     int mv_x = block->mvs[0][0] * 2;
     int mv_y = block->mvs[0][1] * 2;
     int start_x, start_y;
     int startc_x, startc_y, endc_x, endc_y;
 
-    if (mi_ctx->mc_mode == MC_MODE_AOBMC)
-        for (nb_y = FFMAX(0, mb_y - 1); nb_y < FFMIN(mb_y + 2, mi_ctx->b_height); nb_y++)
-            for (nb_x = FFMAX(0, mb_x - 1); nb_x < FFMIN(mb_x + 2, mi_ctx->b_width); nb_x++) {
-                int x_nb = nb_x << mi_ctx->log2_mb_size;
-                int y_nb = nb_y << mi_ctx->log2_mb_size;
-
-                if (nb_x - mb_x || nb_y - mb_y)
-                    sbads[nb_x - mb_x + 1 + (nb_y - mb_y + 1) * 3] = get_sbad(&mi_ctx->me_ctx, x_nb, y_nb, x_nb + block->mvs[0][0], y_nb + block->mvs[0][1]);
-            }
-
     start_x = (mb_x << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
     start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
 
     startc_x = av_clip(start_x, 0, width - 1);
-    startc_y = av_clip(start_y, 0, height - 1);
+    startc_y = FFMAX(av_clip(start_y, 0, height - 1), slice_start);
     endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-    endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
+    endc_y = FFMIN(av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1), slice_end);
 
     for (y = startc_y; y < endc_y; y++) {
         int y_min = -y;
@@ -1062,11 +1216,14 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
 
                 if (nb_x || nb_y) {
                     uint64_t sbad = sbads[nb_x + 1 + (nb_y + 1) * 3];
-                    nb = &mi_ctx->int_blocks[mb_x + nb_x + (mb_y + nb_y) * mi_ctx->b_width];
 
-                    if (sbad && sbad != UINT64_MAX && nb->sbad != UINT64_MAX) {
-                        int phi = av_clip(ALPHA_MAX * nb->sbad / sbad, 0, ALPHA_MAX);
-                        obmc_weight = obmc_weight * phi / ALPHA_MAX;
+                    /* 0 for neighbours outside of the block grid */
+                    if (sbad && sbad != UINT64_MAX) {
+                        nb = &mi_ctx->int_blocks[mb_x + nb_x + (mb_y + nb_y) * mi_ctx->b_width];
+                        if (nb->sbad != UINT64_MAX) {
+                            int phi = av_clip(ALPHA_MAX * nb->sbad / sbad, 0, ALPHA_MAX);
+                            obmc_weight = obmc_weight * phi / ALPHA_MAX;
+                        }
                     }
                 }
             }
@@ -1076,13 +1233,92 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
     }
 }
 
+/**
+ * Motion compensate the rows [slice_start, slice_end) of the output. Every
+ * job walks the blocks in the same order and only keeps the contributions
+ * falling inside its rows, so the per pixel lists are built exactly as if
+ * the whole frame was processed at once. Slices are aligned on chroma rows.
+ */
+static int mc_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    const int width  = td->out->width;
+    const int height = td->out->height;
+    const int align  = 1 << mi_ctx->log2_chroma_h;
+    const int slice_start = FFMIN(FFALIGN((height *  jobnr     ) / nb_jobs, align), height);
+    const int slice_end   = jobnr == nb_jobs - 1 ? height :
+                            FFMIN(FFALIGN((height * (jobnr + 1)) / nb_jobs, align), height);
+    int x, y;
+
+    for (y = slice_start; y < slice_end; y++)
+        for (x = 0; x < width; x++)
+            mi_ctx->pixel_refs[x + y * width].nb = 0;
+
+    if (mi_ctx->me_mode == ME_MODE_BIDIR) {
+        bidirectional_obmc(mi_ctx, td->alpha, slice_start, slice_end);
+    } else {
+        const int mb_start = FFMAX((slice_start >> mi_ctx->log2_mb_size) - 2, 0);
+        const int mb_end   = FFMIN((slice_end   >> mi_ctx->log2_mb_size) + 2, mi_ctx->b_height);
+        int mb_x, mb_y;
+
+        for (mb_y = mb_start; mb_y < mb_end; mb_y++)
+            for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+                Block *block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+
+                if (block->sb)
+                    var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size,
+                                 mi_ctx->log2_mb_size, td->alpha, slice_start, slice_end);
+
+                bilateral_obmc(mi_ctx, block, mb_x, mb_y, td->alpha, slice_start, slice_end);
+            }
+    }
+
+    set_frame_data(mi_ctx, td->alpha, td->out, slice_start, slice_end);
+
+    return 0;
+}
+
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *avf_out = td->out;
+    const int alpha = td->alpha;
+    int x, y, plane;
+
+    for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
+        int width = avf_out->width;
+        int height = avf_out->height;
+        int slice_start, slice_end;
+
+        if (plane == 1 || plane == 2) {
+            width = AV_CEIL_RSHIFT(width, mi_ctx->log2_chroma_w);
+            height = AV_CEIL_RSHIFT(height, mi_ctx->log2_chroma_h);
+        }
+
+        slice_start = (height *  jobnr     ) / nb_jobs;
+        slice_end   = (height * (jobnr + 1)) / nb_jobs;
+
+        for (y = slice_start; y < slice_end; y++) {
+            for (x = 0; x < width; x++) {
+                avf_out->data[plane][x + y * avf_out->linesize[plane]] =
+                    (alpha  * mi_ctx->frames[2].avf->data[plane][x + y * mi_ctx->frames[2].avf->linesize[plane]] +
+                     (ALPHA_MAX - alpha) * mi_ctx->frames[1].avf->data[plane][x + y * mi_ctx->frames[1].avf->linesize[plane]] + 512) >> 10;
+            }
+        }
+    }
+
+    return 0;
+}
+
 static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
 {
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     MIContext *mi_ctx = ctx->priv;
-    int x, y;
-    int plane, alpha;
+    ThreadData td;
+    int alpha;
     int64_t pts;
 
     pts = av_rescale(avf_out->pts, (int64_t) ALPHA_MAX * outlink->time_base.num * inlink->time_base.den,
@@ -1103,57 +1339,22 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
         return;
     }
 
+    td.alpha = alpha;
+    td.out = avf_out;
+
     switch(mi_ctx->mi_mode) {
         case MI_MODE_DUP:
             av_frame_copy(avf_out, alpha > ALPHA_MAX / 2 ? mi_ctx->frames[2].avf : mi_ctx->frames[1].avf);
 
             break;
         case MI_MODE_BLEND:
-            for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
-                int width = avf_out->width;
-                int height = avf_out->height;
-
-                if (plane == 1 || plane == 2) {
-                    width = AV_CEIL_RSHIFT(width, mi_ctx->log2_chroma_w);
-                    height = AV_CEIL_RSHIFT(height, mi_ctx->log2_chroma_h);
-                }
-
-                for (y = 0; y < height; y++) {
-                    for (x = 0; x < width; x++) {
-                        avf_out->data[plane][x + y * avf_out->linesize[plane]] =
-                            (alpha  * mi_ctx->frames[2].avf->data[plane][x + y * mi_ctx->frames[2].avf->linesize[plane]] +
-                             (ALPHA_MAX - alpha) * mi_ctx->frames[1].avf->data[plane][x + y * mi_ctx->frames[1].avf->linesize[plane]] + 512) >> 10;
-                    }
-                }
-            }
+            ctx->internal->execute(ctx, blend_slice, &td, NULL,
+                                   FFMIN(avf_out->height, ff_filter_get_nb_threads(ctx)));
 
             break;
         case MI_MODE_MCI:
-            if (mi_ctx->me_mode == ME_MODE_BIDIR) {
-                bidirectional_obmc(mi_ctx, alpha);
-                set_frame_data(mi_ctx, alpha, avf_out);
-
-            } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
-                int mb_x, mb_y;
-                Block *block;
-
-                for (y = 0; y < mi_ctx->frames[0].avf->height; y++)
-                    for (x = 0; x < mi_ctx->frames[0].avf->width; x++)
-                        mi_ctx->pixel_refs[x + y * mi_ctx->frames[0].avf->width].nb = 0;
-
-                for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
-                        block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
-
-                        if (block->sb)
-                            var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size, alpha);
-
-                        bilateral_obmc(mi_ctx, block, mb_x, mb_y, alpha);
-
-                    }
-
-                set_frame_data(mi_ctx, alpha, avf_out);
-            }
+            ctx->internal->execute(ctx, mc_slice, &td, NULL,
+                                   FFMIN(avf_out->height, ff_filter_get_nb_threads(ctx)));
 
             break;
     }
@@ -1209,6 +1410,18 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *avf_in)
     return 0;
 }
 
+static av_cold int init(AVFilterContext *ctx)
+{
+#if HAVE_THREADS
+    MIContext *mi_ctx = ctx->priv;
+
+    pthread_mutex_init(&mi_ctx->progress_mutex, NULL);
+    pthread_cond_init(&mi_ctx->progress_cond, NULL);
+#endif
+
+    return 0;
+}
+
 static av_cold void free_blocks(Block *block, int sb)
 {
     if (block->subs)
@@ -1225,6 +1438,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&mi_ctx->pixel_mvs);
     av_freep(&mi_ctx->pixel_weights);
     av_freep(&mi_ctx->pixel_refs);
+    av_freep(&mi_ctx->nb_sbads);
+    av_freep(&mi_ctx->row_progress);
     if (mi_ctx->int_blocks)
         for (m = 0; m < mi_ctx->b_count; m++)
             free_blocks(&mi_ctx->int_blocks[m], 0);
@@ -1238,6 +1453,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++)
         av_freep(&mi_ctx->mv_table[i]);
+
+#if HAVE_THREADS
+    pthread_mutex_destroy(&mi_ctx->progress_mutex);
+    pthread_cond_destroy(&mi_ctx->progress_cond);
+#endif
 }
 
 static const AVFilterPad minterpolate_inputs[] = {
@@ -1264,8 +1484,10 @@ AVFilter ff_vf_minterpolate = {
     .description   = NULL_IF_CONFIG_SMALL("Frame rate conversion using Motion Interpolation."),
     .priv_size     = sizeof(MIContext),
     .priv_class    = &minterpolate_class,
+    .init          = init,
     .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = minterpolate_inputs,
     .outputs       = minterpolate_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
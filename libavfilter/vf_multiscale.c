@@ -0,0 +1,362 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale the input to several sizes at once, each one being scaled from
+ * the smallest already scaled picture which is at least as large
+ */
+
+#include <stdio.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "scale_eval.h"
+#include "video.h"
+
+typedef struct Rung {
+    int w, h;                  ///< requested size, as given by the user
+    int src;                   ///< index of the rung scaled from, -1 for the input
+    struct SwsContext *sws;
+} Rung;
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    int flags;
+
+    Rung *rungs;
+    int nb_rungs;
+} MultiScaleContext;
+
+static int parse_size(AVFilterContext *ctx, const char *str, int *w, int *h)
+{
+    char tail;
+
+    if (sscanf(str, "%dx%d%c", w, h, &tail) == 2) {
+        if (!*w || !*h || (*w < 0 && *h < 0)) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", str);
+            return AVERROR(EINVAL);
+        }
+        return 0;
+    }
+    if (av_parse_video_size(w, h, str) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", str);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *p, *saveptr = NULL;
+    int i, ret = 0;
+
+    if (!s->sizes_str || !*s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (p = sizes; (p = av_strtok(p, "|", &saveptr)); p = NULL) {
+        Rung *rung;
+
+        ret = av_reallocp_array(&s->rungs, s->nb_rungs + 1, sizeof(*s->rungs));
+        if (ret < 0) {
+            s->nb_rungs = 0;
+            goto end;
+        }
+        rung = &s->rungs[s->nb_rungs];
+        memset(rung, 0, sizeof(*rung));
+        if ((ret = parse_size(ctx, p, &rung->w, &rung->h)) < 0)
+            goto end;
+        s->nb_rungs++;
+    }
+
+    for (i = 0; i < s->nb_rungs; i++) {
+        AVFilterPad pad = { 0 };
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name = av_asprintf("output%d", i);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+
+        if ((ret = ff_insert_outpad(ctx, i, &pad)) < 0) {
+            av_freep(&pad.name);
+            goto end;
+        }
+    }
+
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < s->nb_rungs; i++)
+        sws_freeContext(s->rungs[i].sws);
+    av_freep(&s->rungs);
+    s->nb_rungs = 0;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    /* every rung is scaled from another one, so all of them share the
+     * input format */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    return ff_set_common_formats(ctx, formats);
+}
+
+static void rung_dimensions(AVFilterContext *ctx, int i, int *w, int *h)
+{
+    MultiScaleContext *s = ctx->priv;
+
+    *w = s->rungs[i].w;
+    *h = s->rungs[i].h;
+    ff_scale_adjust_dimensions(ctx->inputs[0], w, h, 0, 1);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    int idx = FF_OUTLINK_IDX(outlink);
+    Rung *rung = &s->rungs[idx];
+    int w, h, src_w = inlink->w, src_h = inlink->h;
+    int i, ret;
+
+    rung_dimensions(ctx, idx, &w, &h);
+    if (w > INT_MAX / 2 || h > INT_MAX / 2 ||
+        av_image_check_size(w, h, 0, ctx) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid size for output %d: %dx%d\n", idx, w, h);
+        return AVERROR(EINVAL);
+    }
+    outlink->w = w;
+    outlink->h = h;
+
+    /* scale from the smallest of the previous rungs which is large enough,
+     * falling back to the input */
+    rung->src = -1;
+    for (i = 0; i < idx; i++) {
+        int prev_w, prev_h;
+
+        rung_dimensions(ctx, i, &prev_w, &prev_h);
+        if (prev_w >= w && prev_h >= h &&
+            (int64_t)prev_w * prev_h < (int64_t)src_w * src_h) {
+            rung->src = i;
+            src_w     = prev_w;
+            src_h     = prev_h;
+        }
+    }
+
+    sws_freeContext(rung->sws);
+    rung->sws = NULL;
+    if (src_w != w || src_h != h) {
+        rung->sws = sws_alloc_context();
+        if (!rung->sws)
+            return AVERROR(ENOMEM);
+
+        av_opt_set_int(rung->sws, "srcw", src_w, 0);
+        av_opt_set_int(rung->sws, "srch", src_h, 0);
+        av_opt_set_int(rung->sws, "src_format", inlink->format, 0);
+        av_opt_set_int(rung->sws, "dstw", w, 0);
+        av_opt_set_int(rung->sws, "dsth", h, 0);
+        av_opt_set_int(rung->sws, "dst_format", outlink->format, 0);
+        av_opt_set_int(rung->sws, "sws_flags", s->flags, 0);
+        av_opt_set_int(rung->sws, "threads", ff_filter_get_nb_threads(ctx), 0);
+
+        if ((ret = sws_init_context(rung->sws, NULL, NULL)) < 0)
+            return ret;
+    }
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ h * inlink->w, w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: %dx%d from %s (%dx%d)\n",
+           idx, w, h, rung->src < 0 ? "input" : ctx->output_pads[rung->src].name,
+           src_w, src_h);
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    AVFrame **out;
+    uint8_t *needed;
+    int i, ret = 0;
+
+    out    = av_mallocz_array(s->nb_rungs, sizeof(*out));
+    needed = av_mallocz(s->nb_rungs);
+    if (!out || !needed) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* a rung is needed if its output is still open or if a needed rung is
+     * scaled from it */
+    for (i = s->nb_rungs - 1; i >= 0; i--) {
+        if (!ff_outlink_get_status(ctx->outputs[i]))
+            needed[i] = 1;
+        if (needed[i] && s->rungs[i].src >= 0)
+            needed[s->rungs[i].src] = 1;
+    }
+
+    /* scale all the rungs before sending any of them, as the recipients may
+     * write to the frames which are used as sources of the smaller rungs */
+    for (i = 0; i < s->nb_rungs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        const Rung *rung = &s->rungs[i];
+        const AVFrame *src = rung->src < 0 ? in : out[rung->src];
+
+        if (!needed[i])
+            continue;
+
+        if (!rung->sws) {
+            out[i] = av_frame_clone(src);
+            if (!out[i]) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            continue;
+        }
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_frame_copy_props(out[i], in);
+        out[i]->width  = outlink->w;
+        out[i]->height = outlink->h;
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+
+        sws_scale(rung->sws, (const uint8_t * const *)src->data, src->linesize,
+                  0, src->height, out[i]->data, out[i]->linesize);
+    }
+
+    ret = AVERROR_EOF;
+    for (i = 0; i < s->nb_rungs; i++) {
+        AVFrame *frame = out[i];
+
+        out[i] = NULL;
+        if (!frame || ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&frame);
+            continue;
+        }
+        ret = ff_filter_frame(ctx->outputs[i], frame);
+        if (ret < 0)
+            break;
+    }
+
+end:
+    if (out)
+        for (i = 0; i < s->nb_rungs; i++)
+            av_frame_free(&out[i]);
+    av_free(out);
+    av_free(needed);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption multiscale_options[] = {
+    { "sizes", "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { "flags", "set libswscale scaling flags", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" }, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_multiscale = {
+    .name          = "multiscale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input to several sizes, each one scaled from a larger one."),
+    .priv_size     = sizeof(MultiScaleContext),
+    .priv_class    = &multiscale_class,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = multiscale_inputs,
+    .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
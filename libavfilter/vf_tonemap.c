@@ -39,6 +39,25 @@
 #include "internal.h"
 #include "video.h"
 
+/* LUT sizes and fixed-point precision of the 10-bit YUV path */
+#define LIN_LUT_BITS   12
+#define LIN_LUT_SIZE   (1 << LIN_LUT_BITS)
+#define DELIN_LUT_BITS 16
+#define DELIN_LUT_SIZE (1 << DELIN_LUT_BITS)
+#define TONE_LUT_SIZE  1024
+#define COEFF_SHIFT    14
+
+#define ST2084_MAX_LUMINANCE 10000.0
+#define ST2084_M1 0.1593017578125
+#define ST2084_M2 78.84375
+#define ST2084_C1 0.8359375
+#define ST2084_C2 18.8515625
+#define ST2084_C3 18.6875
+
+#define HLG_A 0.17883277
+#define HLG_B 0.28466892
+#define HLG_C 0.55991073
+
 enum TonemapAlgorithm {
     TONEMAP_NONE,
     TONEMAP_LINEAR,
@@ -69,14 +88,44 @@ typedef struct TonemapContext {
     double peak;
 
     const struct LumaCoefficients *coeffs;
+
+    /* state of the 10-bit YUV path, rebuilt when the input properties change */
+    int lut_valid;
+    double lut_peak;
+    enum AVColorTransferCharacteristic lut_trc;
+    enum AVColorPrimaries lut_primaries;
+    enum AVColorSpace lut_colorspace;
+    enum AVColorRange lut_range;
+
+    float lin_lut[LIN_LUT_SIZE];        ///< nonlinear R'G'B' -> linear light
+    float tone_lut[TONE_LUT_SIZE + 1];  ///< signal -> scale factor, over [0, peak]
+    float tone_lut_scale;               ///< signal -> tone_lut index
+    uint16_t delin_lut[DELIN_LUT_SIZE]; ///< linear light -> BT.709 R'G'B'
+    float rgb2rgb[3][3];
+    int rgb2rgb_passthrough;
+    int yuv2rgb[3][3];
+    int rgb2yuv[3][3];
+    int in_yoff;
 } TonemapContext;
 
 static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_GBRPF32,
     AV_PIX_FMT_GBRAPF32,
+    AV_PIX_FMT_YUV420P10,
+    AV_PIX_FMT_P010,
     AV_PIX_FMT_NONE,
 };
 
+static const struct PrimaryCoefficients primaries_table[AVCOL_PRI_NB] = {
+    [AVCOL_PRI_BT709]  = { 0.640, 0.330, 0.300, 0.600, 0.150, 0.060 },
+    [AVCOL_PRI_BT2020] = { 0.708, 0.292, 0.170, 0.797, 0.131, 0.046 },
+};
+
+static const struct WhitepointCoefficients whitepoint_table[AVCOL_PRI_NB] = {
+    [AVCOL_PRI_BT709]  = { 0.3127, 0.3290 },
+    [AVCOL_PRI_BT2020] = { 0.3127, 0.3290 },
+};
+
 static int query_formats(AVFilterContext *ctx)
 {
     return ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
@@ -126,6 +175,37 @@ static float mobius(float in, float j, double peak)
     return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
 }
 
+static float map_signal(const TonemapContext *s, float sig, double peak)
+{
+    switch(s->tonemap) {
+    default:
+    case TONEMAP_NONE:
+        // do nothing
+        break;
+    case TONEMAP_LINEAR:
+        sig = sig * s->param / peak;
+        break;
+    case TONEMAP_GAMMA:
+        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
+                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
+        break;
+    case TONEMAP_CLIP:
+        sig = av_clipf(sig * s->param, 0, 1.0f);
+        break;
+    case TONEMAP_HABLE:
+        sig = hable(sig) / hable(peak);
+        break;
+    case TONEMAP_REINHARD:
+        sig = sig / (sig + s->param) * (peak + s->param) / peak;
+        break;
+    case TONEMAP_MOBIUS:
+        sig = mobius(sig, s->param, peak);
+        break;
+    }
+
+    return sig;
+}
+
 #define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
 static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
                     const AVPixFmtDescriptor *desc, int x, int y, double peak)
@@ -157,32 +237,7 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
      * out-of-bounds clipping */
     sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
     sig_orig = sig;
-
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
-    case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
-        break;
-    case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
-        break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
-        break;
-    case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
-        break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
-        break;
-    }
+    sig = map_signal(s, sig, peak);
 
     /* apply the computed scale factor to the color,
      * linearly to prevent discoloration */
@@ -215,6 +270,303 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     return 0;
 }
 
+static double eotf_st2084(double x)
+{
+    double p = pow(x, 1.0 / ST2084_M2);
+    double a = FFMAX(p - ST2084_C1, 0.0);
+    double b = FFMAX(ST2084_C2 - ST2084_C3 * p, 1e-6);
+    double c = pow(a / b, 1.0 / ST2084_M1);
+    return x > 0.0 ? c * ST2084_MAX_LUMINANCE / REFERENCE_WHITE : 0.0;
+}
+
+static double inverse_oetf_hlg(double x)
+{
+    return x < 0.5 ? 4.0 * x * x : exp((x - HLG_C) / HLG_A) + HLG_B;
+}
+
+/**
+ * Build the tables of the 10-bit YUV path for the properties of in: the
+ * YUV -> R'G'B' matrix, the linearization LUT, the tone curve, the gamut
+ * conversion to BT.709 and the BT.709 output transfer and matrix.
+ */
+static int init_yuv_luts(AVFilterContext *ctx, const AVFrame *in, double peak)
+{
+    TonemapContext *s = ctx->priv;
+    enum AVColorTransferCharacteristic trc = in->color_trc;
+    enum AVColorPrimaries primaries = in->color_primaries;
+    enum AVColorSpace colorspace = in->colorspace;
+    const struct LumaCoefficients *coeffs;
+    double rgb2yuv[3][3], yuv2rgb[3][3];
+    double scale[3], gamma;
+    int i, j;
+
+    if (s->lut_valid && s->lut_peak == peak && s->lut_trc == trc &&
+        s->lut_primaries == primaries && s->lut_colorspace == colorspace &&
+        s->lut_range == in->color_range)
+        return 0;
+
+    if (trc != AVCOL_TRC_SMPTE2084 && trc != AVCOL_TRC_ARIB_STD_B67) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported transfer '%s' for YUV input, "
+               "only SMPTE ST 2084 and ARIB STD-B67 are supported\n",
+               av_color_transfer_name(trc));
+        return AVERROR(EINVAL);
+    }
+
+    if (primaries == AVCOL_PRI_UNSPECIFIED)
+        primaries = AVCOL_PRI_BT2020;
+    if (primaries != AVCOL_PRI_BT2020 && primaries != AVCOL_PRI_BT709) {
+        av_log(ctx, AV_LOG_WARNING, "Unsupported primaries '%s', "
+               "gamut mapping is disabled\n", av_color_primaries_name(primaries));
+        primaries = AVCOL_PRI_BT709;
+    }
+
+    coeffs = ff_get_luma_coefficients(colorspace);
+    if (!coeffs || colorspace == AVCOL_SPC_RGB || colorspace == AVCOL_SPC_YCGCO) {
+        if (colorspace != AVCOL_SPC_UNSPECIFIED)
+            av_log(ctx, AV_LOG_WARNING, "Unsupported color space '%s', "
+                   "assuming BT.2020\n", av_color_space_name(colorspace));
+        coeffs = ff_get_luma_coefficients(AVCOL_SPC_BT2020_NCL);
+    }
+    s->coeffs = coeffs;
+
+    /* 10-bit Y'CbCr -> R'G'B', in units of the linearization LUT */
+    ff_fill_rgb2yuv_table(coeffs, rgb2yuv);
+    ff_matrix_invert_3x3(rgb2yuv, yuv2rgb);
+    if (in->color_range == AVCOL_RANGE_JPEG) {
+        s->in_yoff = 0;
+        scale[0] = scale[1] = scale[2] = 1.0 / 1023;
+    } else {
+        s->in_yoff = 64;
+        scale[0] = 1.0 / 876;
+        scale[1] = scale[2] = 1.0 / 896;
+    }
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            s->yuv2rgb[i][j] = lrint(yuv2rgb[i][j] * scale[j] * (LIN_LUT_SIZE - 1) *
+                                     (1 << COEFF_SHIFT));
+
+    /* BT.709 R'G'B' -> limited range 10-bit Y'CbCr */
+    ff_fill_rgb2yuv_table(ff_get_luma_coefficients(AVCOL_SPC_BT709), rgb2yuv);
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            s->rgb2yuv[i][j] = lrint(rgb2yuv[i][j] * (i ? 896 : 876) /
+                                     (LIN_LUT_SIZE - 1) * (1 << COEFF_SHIFT));
+
+    /* linear light, 1.0 being the reference white; the HLG OOTF is applied
+     * per component, which keeps it a LUT at the cost of a slight hue shift
+     * in saturated highlights */
+    gamma = FFMAX(1.0, 1.2 + 0.42 * log10(peak * REFERENCE_WHITE / 1000.0));
+    for (i = 0; i < LIN_LUT_SIZE; i++) {
+        double x = (double)i / (LIN_LUT_SIZE - 1);
+        if (trc == AVCOL_TRC_SMPTE2084)
+            s->lin_lut[i] = eotf_st2084(x);
+        else
+            s->lin_lut[i] = peak * pow(inverse_oetf_hlg(x) / 12.0, gamma);
+    }
+
+    /* ratio between the mapped and the original signal, see tonemap() */
+    for (i = 0; i <= TONE_LUT_SIZE; i++) {
+        float sig = FFMAX(peak * i / TONE_LUT_SIZE, 1e-6);
+        s->tone_lut[i] = map_signal(s, sig, peak) / sig;
+    }
+    s->tone_lut_scale = TONE_LUT_SIZE / peak;
+
+    if (primaries != AVCOL_PRI_BT709) {
+        double rgb2xyz[3][3], xyz2rgb[3][3], rgb2rgb[3][3];
+
+        ff_fill_rgb2xyz_table(&primaries_table[AVCOL_PRI_BT709],
+                              &whitepoint_table[AVCOL_PRI_BT709], rgb2xyz);
+        ff_matrix_invert_3x3(rgb2xyz, xyz2rgb);
+        ff_fill_rgb2xyz_table(&primaries_table[primaries],
+                              &whitepoint_table[primaries], rgb2xyz);
+        ff_matrix_mul_3x3(rgb2rgb, rgb2xyz, xyz2rgb);
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+                s->rgb2rgb[i][j] = rgb2rgb[i][j];
+        s->rgb2rgb_passthrough = 0;
+    } else {
+        s->rgb2rgb_passthrough = 1;
+    }
+
+    /* BT.1886 inverse EOTF */
+    for (i = 0; i < DELIN_LUT_SIZE; i++)
+        s->delin_lut[i] = lrint(pow((double)i / (DELIN_LUT_SIZE - 1), 1.0 / 2.4) *
+                                (LIN_LUT_SIZE - 1));
+
+    s->lut_valid      = 1;
+    s->lut_peak       = peak;
+    s->lut_trc        = in->color_trc;
+    s->lut_primaries  = in->color_primaries;
+    s->lut_colorspace = in->colorspace;
+    s->lut_range      = in->color_range;
+
+    return 0;
+}
+
+/**
+ * Tonemap n pixels of linear light in place. The loops are kept free of
+ * cross-iteration dependencies so that the compiler can vectorize them.
+ */
+static void tonemap_linear(const TonemapContext *s, float *r, float *g, float *b, int n)
+{
+    int i;
+
+    if (s->desat > 0) {
+        const float cr = s->coeffs->cr, cg = s->coeffs->cg, cb = s->coeffs->cb;
+        const float desat = s->desat;
+
+        for (i = 0; i < n; i++) {
+            float luma = cr * r[i] + cg * g[i] + cb * b[i];
+            float overbright = FFMAX(luma - desat, 1e-6f) / FFMAX(luma, 1e-6f);
+            r[i] = MIX(r[i], luma, overbright);
+            g[i] = MIX(g[i], luma, overbright);
+            b[i] = MIX(b[i], luma, overbright);
+        }
+    }
+
+    if (s->tonemap != TONEMAP_NONE) {
+        for (i = 0; i < n; i++) {
+            float sig = FFMAX(FFMAX3(r[i], g[i], b[i]), 1e-6f);
+            float idx = sig * s->tone_lut_scale;
+            float ratio;
+
+            if (idx < TONE_LUT_SIZE) {
+                int j = idx;
+                ratio = s->tone_lut[j] + (s->tone_lut[j + 1] - s->tone_lut[j]) * (idx - j);
+            } else {
+                ratio = map_signal(s, sig, s->lut_peak) / sig;
+            }
+            r[i] *= ratio;
+            g[i] *= ratio;
+            b[i] *= ratio;
+        }
+    }
+
+    if (!s->rgb2rgb_passthrough) {
+        const float (*m)[3] = s->rgb2rgb;
+
+        for (i = 0; i < n; i++) {
+            float r2 = m[0][0] * r[i] + m[0][1] * g[i] + m[0][2] * b[i];
+            float g2 = m[1][0] * r[i] + m[1][1] * g[i] + m[1][2] * b[i];
+            float b2 = m[2][0] * r[i] + m[2][1] * g[i] + m[2][2] * b[i];
+            r[i] = r2;
+            g[i] = g2;
+            b[i] = b2;
+        }
+    }
+}
+
+#define CHUNK_SIZE 64
+
+/**
+ * Tonemap rows [slice_start, slice_end) of 2x2 blocks of a 4:2:0 10-bit
+ * frame. Samples are stored in the low bits for planar formats and in the
+ * high bits for P010, whose chroma is interleaved. Each pair of rows is
+ * processed in chunks of CHUNK_SIZE columns, one stage at a time: Y'CbCr to
+ * linear R'G'B', tonemapping and gamut mapping, then output transfer and
+ * Y'CbCr.
+ */
+static av_always_inline void tonemap_yuv420_10(const TonemapContext *s,
+                                               AVFrame *out, const AVFrame *in,
+                                               int slice_start, int slice_end,
+                                               int p010)
+{
+    const int shift = p010 ? 6 : 0;
+    const int cstep = p010 ? 2 : 1;
+    const int w = in->width, h = in->height;
+    const int yoff = s->in_yoff;
+    const int rnd = 1 << (COEFF_SHIFT - 1);
+    const int (*m)[3] = s->yuv2rgb;
+    const int (*k)[3] = s->rgb2yuv;
+    const uint16_t *srcu = (const uint16_t *)in->data[1];
+    const uint16_t *srcv = p010 ? srcu + 1 : (const uint16_t *)in->data[2];
+    uint16_t *dstu = (uint16_t *)out->data[1];
+    uint16_t *dstv = p010 ? dstu + 1 : (uint16_t *)out->data[2];
+    float r[2 * CHUNK_SIZE], g[2 * CHUNK_SIZE], b[2 * CHUNK_SIZE];
+    int16_t ro[2 * CHUNK_SIZE], go[2 * CHUNK_SIZE], bo[2 * CHUNK_SIZE];
+    int by, x0, yy, i;
+
+    for (by = slice_start; by < slice_end; by++) {
+        const int y0 = 2 * by, y1 = FFMIN(y0 + 1, h - 1);
+        const uint16_t *srcy[2] = {
+            (const uint16_t *)(in->data[0] + y0 * in->linesize[0]),
+            (const uint16_t *)(in->data[0] + y1 * in->linesize[0]),
+        };
+        uint16_t *dsty[2] = {
+            (uint16_t *)(out->data[0] + y0 * out->linesize[0]),
+            (uint16_t *)(out->data[0] + y1 * out->linesize[0]),
+        };
+        const uint16_t *su = srcu + by * in->linesize[1] / 2;
+        const uint16_t *sv = srcv + by * in->linesize[p010 ? 1 : 2] / 2;
+        uint16_t *du = dstu + by * out->linesize[1] / 2;
+        uint16_t *dv = dstv + by * out->linesize[p010 ? 1 : 2] / 2;
+
+        for (x0 = 0; x0 < w; x0 += CHUNK_SIZE) {
+            const int n = FFMIN(CHUNK_SIZE, w - x0);
+
+            for (yy = 0; yy < 2; yy++) {
+                for (i = 0; i < n; i++) {
+                    const int x = x0 + i, cx = (x >> 1) * cstep;
+                    int y = (srcy[yy][x] >> shift) - yoff;
+                    int u = (su[cx] >> shift) - 512;
+                    int v = (sv[cx] >> shift) - 512;
+                    int ir = (m[0][0] * y + m[0][1] * u + m[0][2] * v + rnd) >> COEFF_SHIFT;
+                    int ig = (m[1][0] * y + m[1][1] * u + m[1][2] * v + rnd) >> COEFF_SHIFT;
+                    int ib = (m[2][0] * y + m[2][1] * u + m[2][2] * v + rnd) >> COEFF_SHIFT;
+                    r[yy * CHUNK_SIZE + i] = s->lin_lut[av_clip_uintp2(ir, LIN_LUT_BITS)];
+                    g[yy * CHUNK_SIZE + i] = s->lin_lut[av_clip_uintp2(ig, LIN_LUT_BITS)];
+                    b[yy * CHUNK_SIZE + i] = s->lin_lut[av_clip_uintp2(ib, LIN_LUT_BITS)];
+                }
+            }
+
+            tonemap_linear(s, r, g, b, n);
+            tonemap_linear(s, r + CHUNK_SIZE, g + CHUNK_SIZE, b + CHUNK_SIZE, n);
+
+            for (yy = 0; yy < 2; yy++) {
+                for (i = 0; i < n; i++) {
+                    const int j = yy * CHUNK_SIZE + i;
+                    int y;
+
+                    ro[j] = s->delin_lut[(int)(av_clipf(r[j], 0.0f, 1.0f) * (DELIN_LUT_SIZE - 1) + 0.5f)];
+                    go[j] = s->delin_lut[(int)(av_clipf(g[j], 0.0f, 1.0f) * (DELIN_LUT_SIZE - 1) + 0.5f)];
+                    bo[j] = s->delin_lut[(int)(av_clipf(b[j], 0.0f, 1.0f) * (DELIN_LUT_SIZE - 1) + 0.5f)];
+                    y = 64 + ((k[0][0] * ro[j] + k[0][1] * go[j] + k[0][2] * bo[j] + rnd) >> COEFF_SHIFT);
+                    dsty[yy][x0 + i] = av_clip_uintp2(y, 10) << shift;
+                }
+            }
+
+            for (i = 0; i < n; i += 2) {
+                /* the last column of an odd width is its own neighbour */
+                const int i1 = FFMIN(i + 1, n - 1);
+                const int cx = ((x0 + i) >> 1) * cstep;
+                int sr = ro[i] + ro[i1] + ro[CHUNK_SIZE + i] + ro[CHUNK_SIZE + i1];
+                int sg = go[i] + go[i1] + go[CHUNK_SIZE + i] + go[CHUNK_SIZE + i1];
+                int sb = bo[i] + bo[i1] + bo[CHUNK_SIZE + i] + bo[CHUNK_SIZE + i1];
+                int u = 512 + ((k[1][0] * sr + k[1][1] * sg + k[1][2] * sb + (rnd << 2)) >> (COEFF_SHIFT + 2));
+                int v = 512 + ((k[2][0] * sr + k[2][1] * sg + k[2][2] * sb + (rnd << 2)) >> (COEFF_SHIFT + 2));
+                du[cx] = av_clip_uintp2(u, 10) << shift;
+                dv[cx] = av_clip_uintp2(v, 10) << shift;
+            }
+        }
+    }
+}
+
+static int tonemap_yuv_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TonemapContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int nb_rows = (td->in->height + 1) >> 1;
+    const int slice_start = (nb_rows * jobnr) / nb_jobs;
+    const int slice_end = (nb_rows * (jobnr+1)) / nb_jobs;
+
+    if (td->in->format == AV_PIX_FMT_P010)
+        tonemap_yuv420_10(s, td->out, td->in, slice_start, slice_end, 1);
+    else
+        tonemap_yuv420_10(s, td->out, td->in, slice_start, slice_end, 0);
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     AVFilterContext *ctx = link->dst;
@@ -232,17 +584,46 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         return AVERROR_BUG;
     }
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    out = ff_get_video_buffer_in_place(outlink, in);
     if (!out) {
         av_frame_free(&in);
         return AVERROR(ENOMEM);
     }
 
-    ret = av_frame_copy_props(out, in);
-    if (ret < 0) {
-        av_frame_free(&in);
-        av_frame_free(&out);
-        return ret;
+    if (!(desc->flags & AV_PIX_FMT_FLAG_FLOAT) &&
+        in->color_trc == AVCOL_TRC_UNSPECIFIED) {
+        av_log(s, AV_LOG_WARNING, "Untagged transfer, assuming SMPTE ST 2084\n");
+        in->color_trc = AVCOL_TRC_SMPTE2084;
+    }
+
+    /* read peak from side data if not passed in */
+    if (!peak) {
+        peak = ff_determine_signal_peak(in);
+        av_log(s, AV_LOG_DEBUG, "Computed signal peak: %f\n", peak);
+    }
+
+    td.out = out;
+    td.in = in;
+    td.desc = desc;
+    td.peak = peak;
+
+    /* 10-bit YUV is converted to BT.709 SDR in a single pass */
+    if (!(desc->flags & AV_PIX_FMT_FLAG_FLOAT)) {
+        ret = init_yuv_luts(ctx, in, peak);
+        if (ret < 0) {
+            if (out != in)
+                av_frame_free(&out);
+            av_frame_free(&in);
+            return ret;
+        }
+        ctx->internal->execute(ctx, tonemap_yuv_slice, &td, NULL,
+                               FFMIN((in->height + 1) >> 1, ff_filter_get_nb_threads(ctx)));
+
+        out->color_trc       = AVCOL_TRC_BT709;
+        out->color_primaries = AVCOL_PRI_BT709;
+        out->colorspace      = AVCOL_SPC_BT709;
+        out->color_range     = AVCOL_RANGE_MPEG;
+        goto done;
     }
 
     /* input and output transfer will be linear */
@@ -252,12 +633,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     } else if (in->color_trc != AVCOL_TRC_LINEAR)
         av_log(s, AV_LOG_WARNING, "Tonemapping works on linear light only\n");
 
-    /* read peak from side data if not passed in */
-    if (!peak) {
-        peak = ff_determine_signal_peak(in);
-        av_log(s, AV_LOG_DEBUG, "Computed signal peak: %f\n", peak);
-    }
-
     /* load original color space even if pixel format is RGB to compute overbrights */
     s->coeffs = &luma_coefficients[in->colorspace];
     if (s->desat > 0 && (in->colorspace == AVCOL_SPC_UNSPECIFIED || !s->coeffs)) {
@@ -271,17 +646,14 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     }
 
     /* do the tone map */
-    td.out = out;
-    td.in = in;
-    td.desc = desc;
-    td.peak = peak;
     ctx->internal->execute(ctx, tonemap_slice, &td, NULL, FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
 
     /* copy/generate alpha if needed */
     if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        av_image_copy_plane(out->data[3], out->linesize[3],
-                            in->data[3], in->linesize[3],
-                            out->linesize[3], outlink->h);
+        if (out != in)
+            av_image_copy_plane(out->data[3], out->linesize[3],
+                                in->data[3], in->linesize[3],
+                                out->linesize[3], outlink->h);
     } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
         for (y = 0; y < out->height; y++) {
             for (x = 0; x < out->width; x++) {
@@ -291,7 +663,9 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         }
     }
 
-    av_frame_free(&in);
+done:
+    if (out != in)
+        av_frame_free(&in);
 
     ff_update_hdr_metadata(out, peak);
 
@@ -322,6 +696,7 @@ static const AVFilterPad tonemap_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .in_place     = 1,
     },
     { NULL }
 };
@@ -27,6 +27,7 @@
 #include "internal.h"
 #include "filters.h"
 #include "video.h"
+#include "xfadedsp.h"
 
 enum XFadeTransitions {
     CUSTOM = -1,
@@ -95,6 +96,9 @@ typedef struct XFadeContext {
     void (*transitionf)(AVFilterContext *ctx, const AVFrame *a, const AVFrame *b, AVFrame *out, float progress,
                         int slice_start, int slice_end, int jobnr);
 
+    XFadeDSPContext dsp;
+    float *noise;           ///< per pixel noise of the dissolve transition
+
     AVExpr *e;
 } XFadeContext;
 
@@ -139,6 +143,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     XFadeContext *s = ctx->priv;
 
     av_expr_free(s->e);
+    av_freep(&s->noise);
 }
 
 #define OFFSET(x) offsetof(XFadeContext, x)
@@ -249,34 +254,27 @@ static inline float smoothstep(float edge0, float edge1, float x)
     return t * t * (3.f - 2.f * t);
 }
 
-#define FADE_TRANSITION(name, type, div)                                             \
-static void fade##name##_transition(AVFilterContext *ctx,                            \
-                            const AVFrame *a, const AVFrame *b, AVFrame *out,        \
-                            float progress,                                          \
-                            int slice_start, int slice_end, int jobnr)               \
-{                                                                                    \
-    XFadeContext *s = ctx->priv;                                                     \
-    const int height = slice_end - slice_start;                                      \
-                                                                                     \
-    for (int p = 0; p < s->nb_planes; p++) {                                         \
-        const type *xf0 = (const type *)(a->data[p] + slice_start * a->linesize[p]); \
-        const type *xf1 = (const type *)(b->data[p] + slice_start * b->linesize[p]); \
-        type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
-                                                                                     \
-        for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = mix(xf0[x], xf1[x], progress);                              \
-            }                                                                        \
-                                                                                     \
-            dst += out->linesize[p] / div;                                           \
-            xf0 += a->linesize[p] / div;                                             \
-            xf1 += b->linesize[p] / div;                                             \
-        }                                                                            \
-    }                                                                                \
-}
+static void fade_transition(AVFilterContext *ctx,
+                            const AVFrame *a, const AVFrame *b, AVFrame *out,
+                            float progress,
+                            int slice_start, int slice_end, int jobnr)
+{
+    XFadeContext *s = ctx->priv;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const uint8_t *xf0 = a->data[p] + slice_start * a->linesize[p];
+        const uint8_t *xf1 = b->data[p] + slice_start * b->linesize[p];
+        uint8_t *dst = out->data[p] + slice_start * out->linesize[p];
 
-FADE_TRANSITION(8, uint8_t, 1)
-FADE_TRANSITION(16, uint16_t, 2)
+        for (int y = slice_start; y < slice_end; y++) {
+            s->dsp.fade(dst, xf0, xf1, out->width, progress);
+
+            dst += out->linesize[p];
+            xf0 += a->linesize[p];
+            xf1 += b->linesize[p];
+        }
+    }
+}
 
 #define WIPELEFT_TRANSITION(name, type, div)                                         \
 static void wipeleft##name##_transition(AVFilterContext *ctx,                        \
@@ -287,6 +285,7 @@ static void wipeleft##name##_transition(AVFilterContext *ctx,
     XFadeContext *s = ctx->priv;                                                     \
     const int height = slice_end - slice_start;                                      \
     const int z = out->width * progress;                                             \
+    const int n = FFMIN(z + 1, out->width);                                          \
                                                                                      \
     for (int p = 0; p < s->nb_planes; p++) {                                         \
         const type *xf0 = (const type *)(a->data[p] + slice_start * a->linesize[p]); \
@@ -294,9 +293,8 @@ static void wipeleft##name##_transition(AVFilterContext *ctx,
         type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
                                                                                      \
         for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = x > z ? xf1[x] : xf0[x];                                    \
-            }                                                                        \
+            memcpy(dst, xf0, n * sizeof(type));                                      \
+            memcpy(dst + n, xf1 + n, (out->width - n) * sizeof(type));               \
                                                                                      \
             dst += out->linesize[p] / div;                                           \
             xf0 += a->linesize[p] / div;                                             \
@@ -317,6 +315,7 @@ static void wiperight##name##_transition(AVFilterContext *ctx,
     XFadeContext *s = ctx->priv;                                                     \
     const int height = slice_end - slice_start;                                      \
     const int z = out->width * (1.f - progress);                                     \
+    const int n = FFMIN(z + 1, out->width);                                          \
                                                                                      \
     for (int p = 0; p < s->nb_planes; p++) {                                         \
         const type *xf0 = (const type *)(a->data[p] + slice_start * a->linesize[p]); \
@@ -324,9 +323,8 @@ static void wiperight##name##_transition(AVFilterContext *ctx,
         type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
                                                                                      \
         for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = x > z ? xf0[x] : xf1[x];                                    \
-            }                                                                        \
+            memcpy(dst, xf1, n * sizeof(type));                                      \
+            memcpy(dst + n, xf0 + n, (out->width - n) * sizeof(type));               \
                                                                                      \
             dst += out->linesize[p] / div;                                           \
             xf0 += a->linesize[p] / div;                                             \
@@ -354,9 +352,7 @@ static void wipeup##name##_transition(AVFilterContext *ctx,
         type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
                                                                                      \
         for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = slice_start + y > z ? xf1[x] : xf0[x];                      \
-            }                                                                        \
+            memcpy(dst, slice_start + y > z ? xf1 : xf0, out->width * sizeof(type)); \
                                                                                      \
             dst += out->linesize[p] / div;                                           \
             xf0 += a->linesize[p] / div;                                             \
@@ -384,9 +380,7 @@ static void wipedown##name##_transition(AVFilterContext *ctx,
         type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
                                                                                      \
         for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = slice_start + y > z ? xf0[x] : xf1[x];                      \
-            }                                                                        \
+            memcpy(dst, slice_start + y > z ? xf0 : xf1, out->width * sizeof(type)); \
                                                                                      \
             dst += out->linesize[p] / div;                                           \
             xf0 += a->linesize[p] / div;                                             \
@@ -629,71 +623,50 @@ static void distance##name##_transition(AVFilterContext *ctx,
 DISTANCE_TRANSITION(8, uint8_t, 1)
 DISTANCE_TRANSITION(16, uint16_t, 2)
 
-#define FADEBLACK_TRANSITION(name, type, div)                                        \
-static void fadeblack##name##_transition(AVFilterContext *ctx,                       \
-                            const AVFrame *a, const AVFrame *b, AVFrame *out,        \
-                            float progress,                                          \
-                            int slice_start, int slice_end, int jobnr)               \
-{                                                                                    \
-    XFadeContext *s = ctx->priv;                                                     \
-    const int height = slice_end - slice_start;                                      \
-    const float phase = 0.2f;                                                        \
-                                                                                     \
-    for (int p = 0; p < s->nb_planes; p++) {                                         \
-        const type *xf0 = (const type *)(a->data[p] + slice_start * a->linesize[p]); \
-        const type *xf1 = (const type *)(b->data[p] + slice_start * b->linesize[p]); \
-        type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
-        const int bg = s->black[p];                                                  \
-                                                                                     \
-        for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = mix(mix(xf0[x], bg, smoothstep(1.f-phase, 1.f, progress)),  \
-                         mix(bg, xf1[x], smoothstep(phase, 1.f, progress)),          \
-                             progress);                                              \
-            }                                                                        \
-                                                                                     \
-            dst += out->linesize[p] / div;                                           \
-            xf0 += a->linesize[p] / div;                                             \
-            xf1 += b->linesize[p] / div;                                             \
-        }                                                                            \
-    }                                                                                \
+static void fade_bg(AVFilterContext *ctx,
+                    const AVFrame *a, const AVFrame *b, AVFrame *out,
+                    float progress, int slice_start, int slice_end,
+                    const uint16_t *bg)
+{
+    XFadeContext *s = ctx->priv;
+    const float phase = 0.2f;
+    const float a_bg = smoothstep(1.f-phase, 1.f, progress);
+    const float bg_b = smoothstep(phase, 1.f, progress);
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const uint8_t *xf0 = a->data[p] + slice_start * a->linesize[p];
+        const uint8_t *xf1 = b->data[p] + slice_start * b->linesize[p];
+        uint8_t *dst = out->data[p] + slice_start * out->linesize[p];
+
+        for (int y = slice_start; y < slice_end; y++) {
+            s->dsp.fade_bg(dst, xf0, xf1, out->width, progress, a_bg, bg_b, bg[p]);
+
+            dst += out->linesize[p];
+            xf0 += a->linesize[p];
+            xf1 += b->linesize[p];
+        }
+    }
 }
 
-FADEBLACK_TRANSITION(8, uint8_t, 1)
-FADEBLACK_TRANSITION(16, uint16_t, 2)
+static void fadeblack_transition(AVFilterContext *ctx,
+                                 const AVFrame *a, const AVFrame *b, AVFrame *out,
+                                 float progress,
+                                 int slice_start, int slice_end, int jobnr)
+{
+    XFadeContext *s = ctx->priv;
 
-#define FADEWHITE_TRANSITION(name, type, div)                                        \
-static void fadewhite##name##_transition(AVFilterContext *ctx,                       \
-                            const AVFrame *a, const AVFrame *b, AVFrame *out,        \
-                            float progress,                                          \
-                            int slice_start, int slice_end, int jobnr)               \
-{                                                                                    \
-    XFadeContext *s = ctx->priv;                                                     \
-    const int height = slice_end - slice_start;                                      \
-    const float phase = 0.2f;                                                        \
-                                                                                     \
-    for (int p = 0; p < s->nb_planes; p++) {                                         \
-        const type *xf0 = (const type *)(a->data[p] + slice_start * a->linesize[p]); \
-        const type *xf1 = (const type *)(b->data[p] + slice_start * b->linesize[p]); \
-        type *dst = (type *)(out->data[p] + slice_start * out->linesize[p]);         \
-        const int bg = s->white[p];                                                  \
-                                                                                     \
-        for (int y = 0; y < height; y++) {                                           \
-            for (int x = 0; x < out->width; x++) {                                   \
-                dst[x] = mix(mix(xf0[x], bg, smoothstep(1.f-phase, 1.f, progress)),  \
-                         mix(bg, xf1[x], smoothstep(phase, 1.f, progress)),          \
-                             progress);                                              \
-            }                                                                        \
-                                                                                     \
-            dst += out->linesize[p] / div;                                           \
-            xf0 += a->linesize[p] / div;                                             \
-            xf1 += b->linesize[p] / div;                                             \
-        }                                                                            \
-    }                                                                                \
+    fade_bg(ctx, a, b, out, progress, slice_start, slice_end, s->black);
 }
 
-FADEWHITE_TRANSITION(8, uint8_t, 1)
-FADEWHITE_TRANSITION(16, uint16_t, 2)
+static void fadewhite_transition(AVFilterContext *ctx,
+                                 const AVFrame *a, const AVFrame *b, AVFrame *out,
+                                 float progress,
+                                 int slice_start, int slice_end, int jobnr)
+{
+    XFadeContext *s = ctx->priv;
+
+    fade_bg(ctx, a, b, out, progress, slice_start, slice_end, s->white);
+}
 
 #define RADIAL_TRANSITION(name, type, div)                                           \
 static void radial##name##_transition(AVFilterContext *ctx,                          \
@@ -1006,31 +979,28 @@ static float frand(int x, int y)
     return r - floorf(r);
 }
 
-#define DISSOLVE_TRANSITION(name, type, div)                                         \
-static void dissolve##name##_transition(AVFilterContext *ctx,                        \
-                            const AVFrame *a, const AVFrame *b, AVFrame *out,        \
-                            float progress,                                          \
-                            int slice_start, int slice_end, int jobnr)               \
-{                                                                                    \
-    XFadeContext *s = ctx->priv;                                                     \
-    const int width = out->width;                                                    \
-                                                                                     \
-    for (int y = slice_start; y < slice_end; y++) {                                  \
-        for (int x = 0; x < width; x++) {                                            \
-            const float smooth = frand(x, y) * 2.f + progress * 2.f - 1.5f;          \
-            for (int p = 0; p < s->nb_planes; p++) {                                 \
-                const type *xf0 = (const type *)(a->data[p] + y * a->linesize[p]);   \
-                const type *xf1 = (const type *)(b->data[p] + y * b->linesize[p]);   \
-                type *dst = (type *)(out->data[p] + y * out->linesize[p]);           \
-                                                                                     \
-                dst[x] = smooth >= 0.5f ? xf0[x] : xf1[x];                           \
-            }                                                                        \
-        }                                                                            \
-    }                                                                                \
-}
+static void dissolve_transition(AVFilterContext *ctx,
+                                const AVFrame *a, const AVFrame *b, AVFrame *out,
+                                float progress,
+                                int slice_start, int slice_end, int jobnr)
+{
+    XFadeContext *s = ctx->priv;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const uint8_t *xf0 = a->data[p] + slice_start * a->linesize[p];
+        const uint8_t *xf1 = b->data[p] + slice_start * b->linesize[p];
+        uint8_t *dst = out->data[p] + slice_start * out->linesize[p];
 
-DISSOLVE_TRANSITION(8, uint8_t, 1)
-DISSOLVE_TRANSITION(16, uint16_t, 2)
+        for (int y = slice_start; y < slice_end; y++) {
+            s->dsp.dissolve(dst, xf0, xf1, s->noise + y * out->width,
+                            out->width, progress);
+
+            dst += out->linesize[p];
+            xf0 += a->linesize[p];
+            xf1 += b->linesize[p];
+        }
+    }
+}
 
 #define PIXELIZE_TRANSITION(name, type, div)                                         \
 static void pixelize##name##_transition(AVFilterContext *ctx,                        \
@@ -1390,7 +1360,7 @@ static int config_output(AVFilterLink *outlink)
 
     switch (s->transition) {
     case CUSTOM:     s->transitionf = s->depth <= 8 ? custom8_transition     : custom16_transition;     break;
-    case FADE:       s->transitionf = s->depth <= 8 ? fade8_transition       : fade16_transition;       break;
+    case FADE:       s->transitionf = fade_transition;                                                   break;
     case WIPELEFT:   s->transitionf = s->depth <= 8 ? wipeleft8_transition   : wipeleft16_transition;   break;
     case WIPERIGHT:  s->transitionf = s->depth <= 8 ? wiperight8_transition  : wiperight16_transition;  break;
     case WIPEUP:     s->transitionf = s->depth <= 8 ? wipeup8_transition     : wipeup16_transition;     break;
@@ -1402,8 +1372,8 @@ static int config_output(AVFilterLink *outlink)
     case CIRCLECROP: s->transitionf = s->depth <= 8 ? circlecrop8_transition : circlecrop16_transition; break;
     case RECTCROP:   s->transitionf = s->depth <= 8 ? rectcrop8_transition   : rectcrop16_transition;   break;
     case DISTANCE:   s->transitionf = s->depth <= 8 ? distance8_transition   : distance16_transition;   break;
-    case FADEBLACK:  s->transitionf = s->depth <= 8 ? fadeblack8_transition  : fadeblack16_transition;  break;
-    case FADEWHITE:  s->transitionf = s->depth <= 8 ? fadewhite8_transition  : fadewhite16_transition;  break;
+    case FADEBLACK:  s->transitionf = fadeblack_transition;                                              break;
+    case FADEWHITE:  s->transitionf = fadewhite_transition;                                              break;
     case RADIAL:     s->transitionf = s->depth <= 8 ? radial8_transition     : radial16_transition;     break;
     case SMOOTHLEFT: s->transitionf = s->depth <= 8 ? smoothleft8_transition : smoothleft16_transition; break;
     case SMOOTHRIGHT:s->transitionf = s->depth <= 8 ? smoothright8_transition: smoothright16_transition;break;
@@ -1415,7 +1385,7 @@ static int config_output(AVFilterLink *outlink)
     case VERTCLOSE:  s->transitionf = s->depth <= 8 ? vertclose8_transition  : vertclose16_transition;  break;
     case HORZOPEN:   s->transitionf = s->depth <= 8 ? horzopen8_transition   : horzopen16_transition;   break;
     case HORZCLOSE:  s->transitionf = s->depth <= 8 ? horzclose8_transition  : horzclose16_transition;  break;
-    case DISSOLVE:   s->transitionf = s->depth <= 8 ? dissolve8_transition   : dissolve16_transition;   break;
+    case DISSOLVE:   s->transitionf = dissolve_transition;                                               break;
     case PIXELIZE:   s->transitionf = s->depth <= 8 ? pixelize8_transition   : pixelize16_transition;   break;
     case DIAGTL:     s->transitionf = s->depth <= 8 ? diagtl8_transition     : diagtl16_transition;     break;
     case DIAGTR:     s->transitionf = s->depth <= 8 ? diagtr8_transition     : diagtr16_transition;     break;
@@ -1427,6 +1397,18 @@ static int config_output(AVFilterLink *outlink)
     case VDSLICE:    s->transitionf = s->depth <= 8 ? vdslice8_transition    : vdslice16_transition;    break;
     }
 
+    ff_xfadedsp_init(&s->dsp, s->depth);
+
+    if (s->transition == DISSOLVE) {
+        av_freep(&s->noise);
+        s->noise = av_malloc_array(outlink->w, outlink->h * sizeof(*s->noise));
+        if (!s->noise)
+            return AVERROR(ENOMEM);
+        for (int y = 0; y < outlink->h; y++)
+            for (int x = 0; x < outlink->w; x++)
+                s->noise[y * outlink->w + x] = frand(x, y);
+    }
+
     if (s->transition == CUSTOM) {
         static const char *const func2_names[]    = {
             "a0", "a1", "a2", "a3",
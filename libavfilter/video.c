@@ -44,6 +44,7 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     AVFrame *frame = NULL;
+    int64_t allocated;
     int pool_width = 0;
     int pool_height = 0;
     int pool_align = 0;
@@ -66,7 +67,8 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                    link->format, BUFFER_ALIGN);
+                                                    link->format, BUFFER_ALIGN,
+                                                    ff_filter_link_buffer_pools(link));
         if (!link->frame_pool)
             return NULL;
     } else {
@@ -81,15 +83,17 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 
             ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
             link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                        link->format, BUFFER_ALIGN);
+                                                        link->format, BUFFER_ALIGN,
+                                                        ff_filter_link_buffer_pools(link));
             if (!link->frame_pool)
                 return NULL;
         }
     }
 
-    frame = ff_frame_pool_get(link->frame_pool);
+    frame = ff_frame_pool_get(link->frame_pool, &allocated);
     if (!frame)
         return NULL;
+    link->pool_bytes += allocated;
 
     frame->sample_aspect_ratio = link->sample_aspect_ratio;
 
@@ -110,3 +114,22 @@ AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
 
     return ret;
 }
+
+AVFrame *ff_get_video_buffer_in_place(AVFilterLink *link, AVFrame *in)
+{
+    AVFrame *out;
+
+    if (link->src->internal->in_place && av_frame_is_writable(in) &&
+        in->width == link->w && in->height == link->h)
+        return in;
+
+    out = ff_get_video_buffer(link, link->w, link->h);
+    if (!out)
+        return NULL;
+    if (av_frame_copy_props(out, in) < 0) {
+        av_frame_free(&out);
+        return NULL;
+    }
+
+    return out;
+}
@@ -38,4 +38,15 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h);
  */
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h);
 
+/**
+ * Get the frame a filter with an in_place input pad writes its output to:
+ * the input frame itself if possible, a new picture buffer with the
+ * properties of the input frame otherwise.
+ *
+ * @param link  the output link of the filter
+ * @param in    the input frame, it is never freed
+ * @return      in, a new frame, or NULL on error
+ */
+AVFrame *ff_get_video_buffer_in_place(AVFilterLink *link, AVFrame *in);
+
 #endif /* AVFILTER_VIDEO_H */
@@ -0,0 +1,111 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "xfadedsp.h"
+
+static inline float mix(float a, float b, float mix)
+{
+    return a * mix + b * (1.f - mix);
+}
+
+/*
+ * The 8 bits kernels compute the products of mix() once per possible
+ * sample value instead of once per sample, which gives the same result.
+ */
+static void fade8_line(uint8_t *dst, const uint8_t *xf0, const uint8_t *xf1,
+                       int width, float progress)
+{
+    float t0[256], t1[256];
+
+    for (int i = 0; i < 256; i++) {
+        t0[i] = i * progress;
+        t1[i] = i * (1.f - progress);
+    }
+    for (int x = 0; x < width; x++)
+        dst[x] = t0[xf0[x]] + t1[xf1[x]];
+}
+
+static void fade16_line(uint8_t *dstp, const uint8_t *ap, const uint8_t *bp,
+                        int width, float progress)
+{
+    const uint16_t *xf0 = (const uint16_t *)ap;
+    const uint16_t *xf1 = (const uint16_t *)bp;
+    uint16_t *dst = (uint16_t *)dstp;
+
+    for (int x = 0; x < width; x++)
+        dst[x] = mix(xf0[x], xf1[x], progress);
+}
+
+static void fade_bg8_line(uint8_t *dst, const uint8_t *xf0, const uint8_t *xf1,
+                          int width, float progress,
+                          float a_bg, float bg_b, int bg)
+{
+    float t0[256], t1[256];
+
+    for (int i = 0; i < 256; i++) {
+        t0[i] = mix(i, bg, a_bg) * progress;
+        t1[i] = mix(bg, i, bg_b) * (1.f - progress);
+    }
+    for (int x = 0; x < width; x++)
+        dst[x] = t0[xf0[x]] + t1[xf1[x]];
+}
+
+static void fade_bg16_line(uint8_t *dstp, const uint8_t *ap, const uint8_t *bp,
+                           int width, float progress,
+                           float a_bg, float bg_b, int bg)
+{
+    const uint16_t *xf0 = (const uint16_t *)ap;
+    const uint16_t *xf1 = (const uint16_t *)bp;
+    uint16_t *dst = (uint16_t *)dstp;
+
+    for (int x = 0; x < width; x++)
+        dst[x] = mix(mix(xf0[x], bg, a_bg), mix(bg, xf1[x], bg_b), progress);
+}
+
+#define DISSOLVE_LINE(name, type)                                                    \
+static void dissolve##name##_line(uint8_t *dstp, const uint8_t *ap, const uint8_t *bp,\
+                                  const float *noise, int width, float progress)     \
+{                                                                                    \
+    const type *xf0 = (const type *)ap;                                              \
+    const type *xf1 = (const type *)bp;                                              \
+    type *dst = (type *)dstp;                                                        \
+                                                                                     \
+    for (int x = 0; x < width; x++) {                                                \
+        const float smooth = noise[x] * 2.f + progress * 2.f - 1.5f;                 \
+        dst[x] = smooth >= 0.5f ? xf0[x] : xf1[x];                                   \
+    }                                                                                \
+}
+
+DISSOLVE_LINE(8, uint8_t)
+DISSOLVE_LINE(16, uint16_t)
+
+av_cold void ff_xfadedsp_init(XFadeDSPContext *dsp, int depth)
+{
+    if (depth <= 8) {
+        dsp->fade     = fade8_line;
+        dsp->fade_bg  = fade_bg8_line;
+        dsp->dissolve = dissolve8_line;
+    } else {
+        dsp->fade     = fade16_line;
+        dsp->fade_bg  = fade_bg16_line;
+        dsp->dissolve = dissolve16_line;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_XFADEDSP_H
+#define AVFILTER_XFADEDSP_H
+
+#include <stdint.h>
+
+/**
+ * Line kernels of the most common xfade transitions. All of them process
+ * width samples of 8 bits or 16 bits depending on the depth the context
+ * was initialized for.
+ */
+typedef struct XFadeDSPContext {
+    /**
+     * Cross fade: dst = a * progress + b * (1 - progress).
+     */
+    void (*fade)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                 int width, float progress);
+
+    /**
+     * Fade through the uniform value bg, a is first faded to bg by
+     * a_bg and bg to b by bg_b before both are cross faded.
+     */
+    void (*fade_bg)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                    int width, float progress, float a_bg, float bg_b, int bg);
+
+    /**
+     * Pick a or b depending on per sample noise values in [0, 1).
+     */
+    void (*dissolve)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                     const float *noise, int width, float progress);
+} XFadeDSPContext;
+
+void ff_xfadedsp_init(XFadeDSPContext *dsp, int depth);
+
+#endif /* AVFILTER_XFADEDSP_H */
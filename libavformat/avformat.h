@@ -1093,8 +1093,13 @@ typedef struct AVStream {
 #define MAX_REORDER_DELAY 16
     int64_t pts_buffer[MAX_REORDER_DELAY+1];
 
-    AVIndexEntry *index_entries; /**< Only used if the format does not
-                                    support seeking natively. */
+    /**
+     * Only used if the format does not support seeking natively.
+     * Some demuxers keep their index in compressed form and leave
+     * these fields empty, use avformat_index_get_entries_count() and
+     * avformat_index_get_entry() to access the index of any stream.
+     */
+    AVIndexEntry *index_entries;
     int nb_index_entries;
     unsigned int index_entries_allocated_size;
 
@@ -1248,6 +1253,26 @@ struct AVCodecParserContext *av_stream_get_parser(const AVStream *s);
  */
 int64_t    av_stream_get_end_pts(const AVStream *st);
 
+#define AVSTREAM_PARAM_CODEC       0x0001 ///< codec
+#define AVSTREAM_PARAM_FRAME_SIZE  0x0002 ///< audio frame size
+#define AVSTREAM_PARAM_SAMPLE_FMT  0x0004 ///< sample format
+#define AVSTREAM_PARAM_SAMPLE_RATE 0x0008 ///< sample rate
+#define AVSTREAM_PARAM_CHANNELS    0x0010 ///< number of channels
+#define AVSTREAM_PARAM_SIZE        0x0020 ///< video or subtitle size
+#define AVSTREAM_PARAM_PIX_FMT     0x0040 ///< pixel format
+#define AVSTREAM_PARAM_FRAME       0x0080 ///< a decoded frame, needed for some codecs
+
+/**
+ * Get the codec parameters of a stream that avformat_find_stream_info()
+ * could not find, e.g. because a stream did not start before the limits
+ * on the analysis were reached. The other parameters of the stream are
+ * valid and the caller may start decoding without waiting for these.
+ *
+ * @return a combination of AVSTREAM_PARAM_* flags, 0 if all parameters
+ *         were found or avformat_find_stream_info() was not called
+ */
+int av_stream_get_missing_params(const AVStream *st);
+
 #define AV_PROGRAM_RUNNING 1
 
 /**
@@ -1951,6 +1976,27 @@ typedef struct AVFormatContext {
      * - decoding: set by user
      */
     int max_probe_packets;
+
+    /**
+     * Maximum wall-clock time avformat_find_stream_info() spends reading
+     * and decoding packets, in AV_TIME_BASE units. When it is reached,
+     * the streams are analyzed with the packets read so far and the
+     * parameters that are still unknown are reported.
+     * 0 means no limit.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int64_t max_analyze_time;
+
+    /**
+     * Number of threads decoding the audio and video streams in
+     * avformat_find_stream_info(). Each stream then has its own decoder,
+     * running concurrently with the demuxing and the other streams.
+     * 0 means decoding on the calling thread.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int analyze_threads;
 } AVFormatContext;
 
 #if FF_API_FORMAT_GET_SET
@@ -2845,6 +2891,33 @@ int av_index_search_timestamp(AVStream *st, int64_t timestamp, int flags);
 int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags);
 
+/**
+ * Get the number of entries in the index of a stream.
+ */
+int avformat_index_get_entries_count(const AVStream *st);
+
+/**
+ * Get an entry of the index of a stream by number.
+ *
+ * @param idx index of the entry, from 0 to
+ *            avformat_index_get_entries_count() - 1
+ * @return a pointer to the entry, or NULL if idx is out of range.
+ *         The pointer is only valid until the next call to any index
+ *         function on this stream, or until more packets are read.
+ */
+const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx);
+
+/**
+ * Get the index entry for a specific timestamp, like
+ * av_index_search_timestamp().
+ *
+ * @return a pointer to the entry, or NULL if no such timestamp could be
+ *         found. The pointer is valid as for avformat_index_get_entry().
+ */
+const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
+                                                            int64_t wanted_timestamp,
+                                                            int flags);
+
 
 /**
  * Split a URL string into components.
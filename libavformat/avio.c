@@ -653,6 +653,13 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_map(URLContext *h, int64_t pos, const uint8_t **data)
+{
+    if (!h || !h->prot || !h->prot->url_map)
+        return AVERROR(ENOSYS);
+    return h->prot->url_map(h, pos, data);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
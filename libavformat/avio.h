@@ -349,6 +349,16 @@ typedef struct AVIOContext {
      * Try to buffer at least this amount of data before flushing it
      */
     int min_packet_size;
+
+    /**
+     * A callback that is used instead of read_packet to access the data
+     * at a given position in place; buffer then points into memory owned
+     * by the callback instead of an allocated buffer.
+     * If the underlying file is truncated while it is mapped, accessing
+     * the data past its new end raises SIGBUS.
+     * This is currently internal only, do not use from outside.
+     */
+    int (*read_map)(void *opaque, int64_t pos, const uint8_t **data);
 } AVIOContext;
 
 /**
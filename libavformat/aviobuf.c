@@ -524,6 +524,34 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 /* Input stream */
 
+static void fill_buffer_mapped(AVIOContext *s)
+{
+    const uint8_t *data;
+    int len = s->read_map(s->opaque, s->pos, &data);
+
+    if (len == AVERROR_EOF) {
+        s->eof_reached = 1;
+    } else if (len < 0) {
+        s->eof_reached = 1;
+        s->error = len;
+    } else {
+        if (s->update_checksum) {
+            if (s->buf_end > s->checksum_ptr)
+                s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
+                                                 s->buf_end - s->checksum_ptr);
+            s->checksum_ptr = (uint8_t *)data;
+        }
+        /* the buffer now points into memory owned by the protocol */
+        s->buffer      =
+        s->buf_ptr     =
+        s->buf_ptr_max = (uint8_t *)data;
+        s->buf_end     = s->buffer + len;
+        s->buffer_size = len;
+        s->pos        += len;
+        s->bytes_read += len;
+    }
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     int max_buffer_size = s->max_packet_size ?
@@ -540,6 +568,11 @@ static void fill_buffer(AVIOContext *s)
     if (s->eof_reached)
         return;
 
+    if (s->read_map) {
+        fill_buffer_mapped(s);
+        return;
+    }
+
     if (s->update_checksum && dst == s->buffer) {
         if (s->buf_end > s->checksum_ptr)
             s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
@@ -681,6 +714,14 @@ int ffio_read_size(AVIOContext *s, unsigned char *buf, int size)
 
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
 {
+    if (s->read_map && s->buf_end - s->buf_ptr < size && !s->eof_reached) {
+        /* map again from the current position to get the data in one piece */
+        int left = s->buf_end - s->buf_ptr;
+        s->pos        -= left;
+        s->bytes_read -= left;
+        s->buf_end     = s->buf_ptr;
+        fill_buffer(s);
+    }
     if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
         *data = s->buf_ptr;
         s->buf_ptr += size;
@@ -962,6 +1003,14 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     }
     (*s)->short_seek_get = (int (*)(void *))ffurl_get_short_seek;
     (*s)->av_class = &ff_avio_class;
+
+    /* Read in place from protocols which can map their data; the
+     * allocated buffer is then never used. */
+    if (!(*s)->write_flag && !(*s)->direct && ffurl_map(h, 0, NULL) >= 0) {
+        (*s)->read_map = (int (*)(void *, int64_t, const uint8_t **))ffurl_map;
+        av_freep(&(*s)->buffer);
+        (*s)->buf_ptr = (*s)->buf_ptr_max = (*s)->buf_end = NULL;
+    }
     return 0;
 fail:
     av_freep(&buffer);
@@ -989,7 +1038,7 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 
     buf_size += s->buf_ptr - s->buffer + max_buffer_size;
 
-    if (buf_size < filled || s->seekable || !s->read_packet)
+    if (buf_size < filled || s->seekable || !s->read_packet || s->read_map)
         return 0;
     av_assert0(!s->write_flag);
 
@@ -1011,6 +1060,11 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 int ffio_set_buf_size(AVIOContext *s, int buf_size)
 {
     uint8_t *buffer;
+
+    /* mapped data needs no buffer */
+    if (s->read_map)
+        return 0;
+
     buffer = av_malloc(buf_size);
     if (!buffer)
         return AVERROR(ENOMEM);
@@ -1029,6 +1083,9 @@ int ffio_realloc_buf(AVIOContext *s, int buf_size)
     uint8_t *buffer;
     int data_size;
 
+    if (s->read_map)
+        return 0;
+
     if (!s->buffer_size)
         return ffio_set_buf_size(s, buf_size);
 
@@ -1081,6 +1138,14 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char **bufp, int buf_si
         return AVERROR(EINVAL);
     }
 
+    /* the probe data is still available from the mapping */
+    if (s->read_map) {
+        int64_t ret;
+        av_freep(bufp);
+        ret = avio_seek(s, avio_tell(s) - buf_size, SEEK_SET);
+        return ret < 0 ? ret : 0;
+    }
+
     buffer_size = s->buf_end - s->buffer;
 
     /* the buffers must touch or overlap */
@@ -1155,7 +1220,8 @@ int avio_close(AVIOContext *s)
     h         = s->opaque;
     s->opaque = NULL;
 
-    av_freep(&s->buffer);
+    if (!s->read_map)
+        av_freep(&s->buffer);
     if (s->write_flag)
         av_log(s, AV_LOG_VERBOSE, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
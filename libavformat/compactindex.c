@@ -0,0 +1,429 @@
+/*
+ * Compact storage for stream indexes
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Each block starts at the timestamp and position stored in its header.
+ * Its entries are coded as records of
+ *   varint timestamp delta
+ *   varint zigzag position delta
+ *   varint size << 2 | flags
+ *   varint min_distance
+ *   varint run
+ * where the deltas are relative to the previous entry and the record
+ * stands for run + 1 entries with the same deltas, size, flags and
+ * distance. The first record of a block has zero deltas.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "compactindex.h"
+
+#define MAX_RECORD_SIZE (10 + 10 + 5 + 5 + 5)
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static uint64_t get_varint(const uint8_t **pp)
+{
+    const uint8_t *p = *pp;
+    uint64_t v = 0;
+    int shift = 0;
+
+    do {
+        v |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+
+    *pp = p;
+    return v;
+}
+
+FFCompactIndex *ff_compact_index_alloc(void)
+{
+    FFCompactIndex *ci = av_mallocz(sizeof(*ci));
+
+    if (ci)
+        ci->cached_block = -1;
+    return ci;
+}
+
+void ff_compact_index_free(FFCompactIndex **pci)
+{
+    FFCompactIndex *ci = *pci;
+    int k;
+
+    if (!ci)
+        return;
+    for (k = 0; k < ci->nb_blocks; k++)
+        av_free(ci->blocks[k].data);
+    av_free(ci->blocks);
+    av_freep(pci);
+}
+
+static void block_decode(const CompactIndexBlock *b, AVIndexEntry *entries)
+{
+    const uint8_t *p = b->data;
+    AVIndexEntry e = { .pos = b->pos, .timestamp = b->timestamp };
+    int n = 0;
+
+    while (n < b->nb_entries) {
+        uint64_t dts        = get_varint(&p);
+        uint64_t zpos       = get_varint(&p);
+        uint64_t dpos       = (zpos >> 1) ^ -(zpos & 1);
+        unsigned size_flags = get_varint(&p);
+        unsigned distance   = get_varint(&p);
+        unsigned run        = get_varint(&p);
+
+        e.size         = size_flags >> 2;
+        e.flags        = size_flags & 3;
+        e.min_distance = distance;
+        do {
+            e.timestamp  = (uint64_t)e.timestamp + dts;
+            e.pos        = (uint64_t)e.pos + dpos;
+            entries[n++] = e;
+        } while (run--);
+    }
+}
+
+static const AVIndexEntry *decode_cached(FFCompactIndex *ci, int k)
+{
+    if (ci->cached_block != k) {
+        block_decode(&ci->blocks[k], ci->cache);
+        ci->cached_block = k;
+    }
+    return ci->cache;
+}
+
+static int block_append(FFCompactIndex *ci, CompactIndexBlock *b,
+                        const AVIndexEntry *e)
+{
+    unsigned allocated = b->allocated;
+    int64_t dts = 0, dpos = 0;
+    uint8_t *p;
+
+    p = av_fast_realloc(b->data, &b->allocated, b->size + MAX_RECORD_SIZE);
+    if (!p)
+        return AVERROR(ENOMEM);
+    b->data   = p;
+    ci->size += b->allocated - allocated;
+
+    if (b->nb_entries) {
+        dts  = (uint64_t)e->timestamp - b->last.timestamp;
+        dpos = (uint64_t)e->pos       - b->last.pos;
+
+        if (dts == b->run_timestamp && dpos == b->run_pos &&
+            e->size         == b->last.size  &&
+            e->flags        == b->last.flags &&
+            e->min_distance == b->last.min_distance) {
+            p = put_varint(b->data + b->run_offset, ++b->run);
+            goto end;
+        }
+    } else {
+        b->timestamp = e->timestamp;
+        b->pos       = e->pos;
+    }
+
+    p = put_varint(b->data + b->size, dts);
+    p = put_varint(p, (uint64_t)dpos << 1 ^ (uint64_t)(dpos >> 63));
+    p = put_varint(p, (unsigned)e->size << 2 | e->flags);
+    p = put_varint(p, (unsigned)e->min_distance);
+    b->run_offset    = p - b->data;
+    b->run           = 0;
+    b->run_timestamp = dts;
+    b->run_pos       = dpos;
+    p = put_varint(p, 0);
+
+end:
+    b->size = p - b->data;
+    b->last = *e;
+    b->nb_entries++;
+    return 0;
+}
+
+static int block_encode(FFCompactIndex *ci, CompactIndexBlock *b,
+                        const AVIndexEntry *entries, int nb_entries)
+{
+    int i, ret;
+
+    b->nb_entries = 0;
+    b->size       = 0;
+    for (i = 0; i < nb_entries; i++)
+        if ((ret = block_append(ci, b, &entries[i])) < 0)
+            return ret;
+    return 0;
+}
+
+static CompactIndexBlock *insert_block(FFCompactIndex *ci, int k)
+{
+    unsigned allocated = ci->blocks_allocated;
+    CompactIndexBlock *blocks;
+
+    if (ci->nb_blocks >= INT_MAX / sizeof(*blocks) - 1)
+        return NULL;
+    blocks = av_fast_realloc(ci->blocks, &ci->blocks_allocated,
+                             (ci->nb_blocks + 1) * sizeof(*blocks));
+    if (!blocks)
+        return NULL;
+    ci->blocks = blocks;
+    ci->size  += ci->blocks_allocated - allocated;
+
+    memmove(blocks + k + 1, blocks + k, (ci->nb_blocks - k) * sizeof(*blocks));
+    memset(&blocks[k], 0, sizeof(*blocks));
+    ci->nb_blocks++;
+    if (ci->cached_block >= k)
+        ci->cached_block = -1;
+    return &blocks[k];
+}
+
+/**
+ * Drop empty blocks and recompute the entry numbers after the blocks
+ * were rewritten.
+ */
+static void update_blocks(FFCompactIndex *ci)
+{
+    int k, j, first = 0;
+
+    for (k = j = 0; k < ci->nb_blocks; k++) {
+        CompactIndexBlock *b = &ci->blocks[k];
+
+        if (!b->nb_entries) {
+            ci->size -= b->allocated;
+            av_freep(&b->data);
+            continue;
+        }
+        b->first         = first;
+        first           += b->nb_entries;
+        ci->blocks[j++]  = *b;
+    }
+    ci->nb_blocks    = j;
+    ci->nb_entries   = first;
+    ci->cached_block = -1;
+}
+
+static int append_entry(FFCompactIndex *ci, const AVIndexEntry *e)
+{
+    int k = ci->nb_blocks - 1, ret;
+
+    if (k < 0 || ci->blocks[k].nb_entries >= COMPACT_INDEX_BLOCK_ENTRIES) {
+        CompactIndexBlock *b = insert_block(ci, ++k);
+        if (!b)
+            return AVERROR(ENOMEM);
+        b->first = ci->nb_entries;
+    }
+
+    ret = block_append(ci, &ci->blocks[k], e);
+    if (ret < 0) {
+        if (!ci->blocks[k].nb_entries)
+            update_blocks(ci);
+        return ret;
+    }
+    if (ci->cached_block == k)
+        ci->cached_block = -1;
+    return ci->nb_entries++;
+}
+
+/**
+ * @return the last block starting at or before timestamp, -1 if none
+ */
+static int find_block(const FFCompactIndex *ci, int64_t timestamp)
+{
+    int a = -1, b = ci->nb_blocks;
+
+    while (b - a > 1) {
+        int m = (a + b) >> 1;
+        if (ci->blocks[m].timestamp <= timestamp)
+            a = m;
+        else
+            b = m;
+    }
+    return a;
+}
+
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags)
+{
+    AVIndexEntry e = {
+        .pos          = pos,
+        .timestamp    = timestamp,
+        .flags        = flags,
+        .size         = size,
+        .min_distance = distance,
+    };
+    AVIndexEntry *entries;
+    int k, i, n, ret;
+
+    if (ci->nb_entries >= INT_MAX - 1)
+        return -1;
+
+    if (!ci->nb_blocks || ci->blocks[ci->nb_blocks - 1].last.timestamp < timestamp)
+        return append_entry(ci, &e);
+
+    k = FFMAX(find_block(ci, timestamp), 0);
+    n = ci->blocks[k].nb_entries;
+
+    /* the cache serves as scratch buffer for the new block content */
+    decode_cached(ci, k);
+    ci->cached_block = -1;
+    entries = ci->cache;
+
+    for (i = 0; i < n && entries[i].timestamp < timestamp; i++)
+        ;
+    if (i < n && entries[i].timestamp == timestamp) {
+        // do not reduce the distance
+        if (entries[i].pos == pos && distance < entries[i].min_distance)
+            e.min_distance = entries[i].min_distance;
+    } else {
+        memmove(entries + i + 1, entries + i, (n - i) * sizeof(*entries));
+        n++;
+    }
+    entries[i] = e;
+
+    if (n > COMPACT_INDEX_BLOCK_ENTRIES) {
+        if (!insert_block(ci, k + 1))
+            return AVERROR(ENOMEM);
+        ret = block_encode(ci, &ci->blocks[k + 1], entries + n / 2, n - n / 2);
+        if (ret >= 0)
+            ret = block_encode(ci, &ci->blocks[k], entries, n / 2);
+    } else {
+        ret = block_encode(ci, &ci->blocks[k], entries, n);
+    }
+    update_blocks(ci);
+    if (ret < 0)
+        return ret;
+
+    return ci->blocks[k].first + i;
+}
+
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int idx)
+{
+    int a = 0, b = ci->nb_blocks;
+
+    if (idx < 0 || idx >= ci->nb_entries)
+        return NULL;
+    if (idx == ci->nb_entries - 1)
+        return &ci->blocks[ci->nb_blocks - 1].last;
+
+    while (b - a > 1) {
+        int m = (a + b) >> 1;
+        if (ci->blocks[m].first <= idx)
+            a = m;
+        else
+            b = m;
+    }
+    return &decode_cached(ci, a)[idx - ci->blocks[a].first];
+}
+
+int ff_compact_index_search(FFCompactIndex *ci, int64_t wanted_timestamp,
+                            int flags)
+{
+    int k = find_block(ci, wanted_timestamp);
+    int a, b, m;
+
+    /* a is the last entry at or before wanted_timestamp, b the first one
+     * at or after it */
+    if (k < 0) {
+        a = -1;
+        b = 0;
+    } else {
+        const CompactIndexBlock *blk = &ci->blocks[k];
+        int i = blk->nb_entries - 1;
+
+        if (blk->last.timestamp > wanted_timestamp) {
+            const AVIndexEntry *entries = decode_cached(ci, k);
+            for (i = 0; entries[i + 1].timestamp <= wanted_timestamp; i++)
+                ;
+        }
+        a = blk->first + i;
+        b = ff_compact_index_get(ci, a)->timestamp == wanted_timestamp ? a : a + 1;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < ci->nb_entries &&
+               !(ff_compact_index_get(ci, m)->flags & AVINDEX_KEYFRAME))
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+
+    if (m == ci->nb_entries)
+        return -1;
+    return m;
+}
+
+int ff_compact_index_reduce(FFCompactIndex *ci, size_t max_size)
+{
+    FFCompactIndex out = { .cached_block = -1 };
+    const CompactIndexBlock *last_block;
+    uint64_t span, keep, step;
+    int64_t prev = 0;
+    int k, i, ret = 0;
+
+    if (ci->size < max_size || ci->nb_entries <= 2)
+        return 0;
+
+    last_block = &ci->blocks[ci->nb_blocks - 1];
+    span = (uint64_t)last_block->last.timestamp - ci->blocks[0].timestamp;
+    keep = FFMAX(ci->nb_entries / 2, 1);
+    step = FFMAX((span + keep - 1) / keep, 1);
+
+    /* Timestamps are strictly increasing, so keeping entries at least step
+     * apart leaves at most keep + 2 of them. */
+    for (k = 0; k < ci->nb_blocks && ret >= 0; k++) {
+        const AVIndexEntry *entries = decode_cached(ci, k);
+        int nb_entries = ci->blocks[k].nb_entries;
+
+        for (i = 0; i < nb_entries; i++) {
+            int is_last = k == ci->nb_blocks - 1 && i == nb_entries - 1;
+
+            if (out.nb_entries && !is_last &&
+                (uint64_t)entries[i].timestamp - prev < step)
+                continue;
+            if ((ret = append_entry(&out, &entries[i])) < 0)
+                break;
+            prev = entries[i].timestamp;
+        }
+    }
+
+    if (ret < 0) {
+        for (k = 0; k < out.nb_blocks; k++)
+            av_free(out.blocks[k].data);
+        av_free(out.blocks);
+        return ret;
+    }
+
+    for (k = 0; k < ci->nb_blocks; k++)
+        av_free(ci->blocks[k].data);
+    av_free(ci->blocks);
+
+    ci->blocks           = out.blocks;
+    ci->nb_blocks        = out.nb_blocks;
+    ci->blocks_allocated = out.blocks_allocated;
+    ci->nb_entries       = out.nb_entries;
+    ci->size             = out.size;
+    ci->cached_block     = -1;
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Compact storage for stream indexes
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_COMPACTINDEX_H
+#define AVFORMAT_COMPACTINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avformat.h"
+
+/**
+ * Maximum number of entries in a block. Lookups decode at most one block.
+ */
+#define COMPACT_INDEX_BLOCK_ENTRIES 128
+
+typedef struct CompactIndexBlock {
+    int64_t timestamp;      ///< timestamp of the first entry
+    int64_t pos;            ///< position of the first entry
+    int first;              ///< number of entries in the previous blocks
+    int nb_entries;
+
+    AVIndexEntry last;      ///< last entry, appended entries are coded relative to it
+    int64_t run_timestamp;  ///< timestamp delta of the last record
+    int64_t run_pos;        ///< position delta of the last record
+    unsigned run;           ///< number of repetitions of the last record
+    unsigned run_offset;    ///< offset of the repetition count of the last record
+
+    uint8_t *data;
+    unsigned size;
+    unsigned allocated;
+} CompactIndexBlock;
+
+/**
+ * Sorted index of a stream, stored as blocks of delta and run-length coded
+ * entries. The blocks are found by binary search on their first timestamp,
+ * so that adding entries at the end and looking them up by timestamp
+ * or by number costs O(log n) plus the decoding of one block.
+ */
+typedef struct FFCompactIndex {
+    CompactIndexBlock *blocks;
+    int nb_blocks;
+    unsigned blocks_allocated;
+
+    int nb_entries;
+
+    /**
+     * Bytes allocated for the blocks and their data.
+     */
+    size_t size;
+
+    /**
+     * Decoded entries of the block cached_block, -1 if none.
+     */
+    int cached_block;
+    AVIndexEntry cache[COMPACT_INDEX_BLOCK_ENTRIES + 1];
+} FFCompactIndex;
+
+FFCompactIndex *ff_compact_index_alloc(void);
+
+void ff_compact_index_free(FFCompactIndex **pci);
+
+/**
+ * Add an entry, or update the entry with the same timestamp, like
+ * ff_add_index_entry() does for a flat index.
+ *
+ * @return the number of the entry or a negative error code
+ */
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags);
+
+/**
+ * Get an entry by number.
+ *
+ * @return a pointer to the entry, valid until the index is used again,
+ *         or NULL if there is no such entry
+ */
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int idx);
+
+/**
+ * Search an entry by timestamp, with the same flags and result as
+ * ff_index_search_timestamp().
+ */
+int ff_compact_index_search(FFCompactIndex *ci, int64_t wanted_timestamp,
+                            int flags);
+
+/**
+ * Drop about half of the entries if the index uses max_size bytes or
+ * more. The entries left are spread evenly over time and always include
+ * the first and last ones.
+ */
+int ff_compact_index_reduce(FFCompactIndex *ci, size_t max_size);
+
+#endif /* AVFORMAT_COMPACTINDEX_H */
@@ -35,6 +35,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -67,6 +70,11 @@
 
 /* standard file protocol */
 
+/* Size bounds of the windows handed out by file_map(); the window grows
+ * while the file is read sequentially and shrinks back after a seek. */
+#define MAP_WINDOW_MIN (256 * 1024)
+#define MAP_WINDOW_MAX (8 * 1024 * 1024)
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -74,6 +82,13 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int use_mmap;
+    uint8_t *map;
+    int64_t map_size;
+    int64_t map_pos;    ///< position of the next file_read()
+    int64_t map_next;   ///< position following the last window handed out
+    int64_t map_window;
+    int map_page;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +99,7 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "Map the file into memory and read it in place", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -111,6 +127,14 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->map) {
+        if (c->map_pos >= c->map_size)
+            return AVERROR_EOF;
+        size = FFMIN(size, c->map_size - c->map_pos);
+        memcpy(buf, c->map + c->map_pos, size);
+        c->map_next = c->map_pos += size;
+        return size;
+    }
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -243,6 +267,33 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->use_mmap) {
+#if HAVE_MMAP
+        if (flags & AVIO_FLAG_WRITE || c->follow || h->is_streamed ||
+            fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+            st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX) {
+            av_log(h, AV_LOG_VERBOSE, "Not mapping %s, reading it instead\n", filename);
+        } else {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map == MAP_FAILED) {
+                av_log(h, AV_LOG_WARNING, "Could not map %s: %s, reading it instead\n",
+                       filename, av_err2str(AVERROR(errno)));
+            } else {
+                c->map        = map;
+                c->map_size   = st.st_size;
+                c->map_window = MAP_WINDOW_MIN;
+#if HAVE_SYSCONF && defined(_SC_PAGESIZE)
+                c->map_page   = sysconf(_SC_PAGESIZE);
+#endif
+                if (c->map_page <= 0)
+                    c->map_page = 4096;
+            }
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "Memory mapping is not supported, reading %s instead\n", filename);
+#endif
+    }
+
     return 0;
 }
 
@@ -258,14 +309,67 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
 }
 
+static int file_map(URLContext *h, int64_t pos, const uint8_t **data)
+{
+    FileContext *c = h->priv_data;
+    int64_t len;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    if (!data)
+        return 0;
+    if (pos < 0)
+        return AVERROR(EINVAL);
+    if (pos >= c->map_size)
+        return AVERROR_EOF;
+
+    /* Let readahead follow the access pattern of the caller: sequential
+     * reads get larger and larger windows, a seek starts over small.
+     * Mapping again from inside the previous window counts as sequential. */
+    if (pos <= c->map_next && pos >= c->map_next - c->map_window)
+        c->map_window = FFMIN(c->map_window * 2, MAP_WINDOW_MAX);
+    else
+        c->map_window = MAP_WINDOW_MIN;
+    len = FFMIN(c->map_window, c->map_size - pos);
+
+#if HAVE_MMAP && defined(MADV_WILLNEED)
+    {
+        /* ask for this window and the one following it */
+        int64_t start = pos & ~(int64_t)(c->map_page - 1);
+        int64_t end   = FFMIN(pos + len + c->map_window, c->map_size);
+        madvise(c->map + start, end - start, MADV_WILLNEED);
+    }
+#endif
+
+    c->map_pos = c->map_next = pos + len;
+    *data = c->map + pos;
+    return len;
+}
+
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
     return close(c->fd);
 }
 
@@ -361,6 +465,7 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+    .url_map             = file_map,
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -1130,8 +1130,10 @@ skip:
 
     if ((s->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
         ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY ||
-         stream_type == FLV_STREAM_TYPE_AUDIO))
+         stream_type == FLV_STREAM_TYPE_AUDIO)) {
+        ff_reduce_index(s, st->index);
         av_add_index_entry(st, pos, dts, size, 0, AVINDEX_KEYFRAME);
+    }
 
     if (  (st->discard >= AVDISCARD_NONKEY && !((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || (stream_type == FLV_STREAM_TYPE_AUDIO)))
           ||(st->discard >= AVDISCARD_BIDIR  &&  ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_DISP_INTER && (stream_type == FLV_STREAM_TYPE_VIDEO)))
@@ -33,6 +33,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -47,6 +48,9 @@
 #define MPEG_TIME_BASE 90000
 #define MPEG_TIME_BASE_Q (AVRational){1, MPEG_TIME_BASE}
 
+#define PREFETCH_CHUNK_SIZE   (32 * 1024)
+#define PREFETCH_MAX_BUFFERED (16 * 1024 * 1024)
+
 /*
  * An apple http stream consists of a playlist with media segment files,
  * played sequentially. There may be several playlists with the same
@@ -79,6 +83,32 @@ struct segment {
 
 struct rendition;
 
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_LOADING,
+    PREFETCH_DONE
+};
+
+/*
+ * A segment downloaded ahead of time by one of the prefetch threads of
+ * a playlist. The data is appended by the downloading thread and consumed
+ * by read_data() while the download is still in progress.
+ */
+struct prefetch_slot {
+    enum PrefetchState state;
+    int seq_no;
+    struct segment seg;         /* private copy, url and key owned by the slot */
+    AVDictionary *avio_opts;    /* private copy of HLSContext.avio_opts */
+    int opened;
+    int cancelled;
+    int ret;                    /* status of the finished download */
+    uint8_t *buf;
+    unsigned int buf_size;
+    unsigned int len;
+    unsigned int read_offset;
+};
+
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
     PLS_TYPE_EVENT,
@@ -160,6 +190,20 @@ struct playlist {
      * playlist, if any. */
     int n_init_sections;
     struct segment **init_sections;
+
+    /* Segments being downloaded ahead, if prefetch_segments is set */
+    int n_prefetch;
+    struct prefetch_slot *prefetch;
+    struct prefetch_slot *cur_prefetch;
+#if HAVE_THREADS
+    int n_prefetch_threads;
+    pthread_t *prefetch_threads;
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_cond;
+    int prefetch_abort;
+    /* interrupts the I/O of the prefetch threads on abort */
+    AVIOInterruptCB prefetch_int_cb;
+#endif
 };
 
 /*
@@ -212,6 +256,7 @@ typedef struct HLSContext {
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
     AVIOContext *playlist_pb;
 } HLSContext;
 
@@ -243,11 +288,14 @@ static void free_init_section_list(struct playlist *pls)
     pls->n_init_sections = 0;
 }
 
+static void prefetch_stop(struct playlist *pls);
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
     for (i = 0; i < c->n_playlists; i++) {
         struct playlist *pls = c->playlists[i];
+        prefetch_stop(pls);
         free_segment_list(pls);
         free_init_section_list(pls);
         av_freep(&pls->main_streams);
@@ -624,8 +672,19 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 #endif
 }
 
+static int io_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                   AVDictionary **opts, const AVIOInterruptCB *int_cb)
+{
+    /* prefetching is only enabled with the default io_open() */
+    if (int_cb)
+        return ffio_open_whitelist(pb, url, AVIO_FLAG_READ, int_cb, opts,
+                                   s->protocol_whitelist, s->protocol_blacklist);
+    return s->io_open(s, pb, url, AVIO_FLAG_READ, opts);
+}
+
 static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary *opts, AVDictionary *opts2, int *is_http_out)
+                    AVDictionary *opts, AVDictionary *opts2, int *is_http_out,
+                    const AVIOInterruptCB *int_cb)
 {
     HLSContext *c = s->priv_data;
     AVDictionary *tmp = NULL;
@@ -685,10 +744,10 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
                 av_log(s, AV_LOG_WARNING,
                     "keepalive request failed for '%s' with error: '%s' when opening url, retrying with new connection\n",
                     url, av_err2str(ret));
-            ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
+            ret = io_open(s, pb, url, &tmp, int_cb);
         }
     } else {
-        ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
+        ret = io_open(s, pb, url, &tmp, int_cb);
     }
     if (ret >= 0) {
         // update cookies on http response with setcookies.
@@ -1219,7 +1278,14 @@ static void intercept_id3(struct playlist *pls, uint8_t *buf,
         pls->is_id3_timestamped = (pls->id3_mpegts_timestamp != AV_NOPTS_VALUE);
 }
 
-static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+/*
+ * Open a segment, fetching its key if needed. key_url and key cache the
+ * last key fetched, so that they can be kept per reading thread. int_cb,
+ * if set, is the interrupt callback of the reading thread.
+ */
+static int open_segment(HLSContext *c, struct playlist *pls, struct segment *seg,
+                        AVDictionary *avio_opts, char *key_url, uint8_t *key_buf,
+                        const AVIOInterruptCB *int_cb, AVIOContext **in)
 {
     AVDictionary *opts = NULL;
     int ret;
@@ -1239,14 +1305,14 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
            seg->url, seg->url_offset, pls->index);
 
     if (seg->key_type == KEY_NONE) {
-        ret = open_url(pls->parent, in, seg->url, c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, seg->url, avio_opts, opts, &is_http, int_cb);
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
-        if (strcmp(seg->key, pls->key_url)) {
+        if (strcmp(seg->key, key_url)) {
             AVIOContext *pb = NULL;
-            if (open_url(pls->parent, &pb, seg->key, c->avio_opts, opts, NULL) == 0) {
-                ret = avio_read(pb, pls->key, sizeof(pls->key));
-                if (ret != sizeof(pls->key)) {
+            if (open_url(pls->parent, &pb, seg->key, avio_opts, opts, NULL, int_cb) == 0) {
+                ret = avio_read(pb, key_buf, 16);
+                if (ret != 16) {
                     av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s\n",
                            seg->key);
                 }
@@ -1255,10 +1321,10 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
                 av_log(pls->parent, AV_LOG_ERROR, "Unable to open key file %s\n",
                        seg->key);
             }
-            av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
+            av_strlcpy(key_url, seg->key, MAX_URL_SIZE);
         }
         ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
-        ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
+        ff_data_to_hex(key, key_buf, 16, 0);
         iv[32] = key[32] = '\0';
         if (strstr(seg->url, "://"))
             snprintf(url, sizeof(url), "crypto+%s", seg->url);
@@ -1268,7 +1334,7 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
         av_dict_set(&opts, "key", key, 0);
         av_dict_set(&opts, "iv", iv, 0);
 
-        ret = open_url(pls->parent, in, url, c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, url, avio_opts, opts, &is_http, int_cb);
         if (ret < 0) {
             goto cleanup;
         }
@@ -1302,6 +1368,12 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
 
 cleanup:
     av_dict_free(&opts);
+    return ret;
+}
+
+static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+{
+    int ret = open_segment(c, pls, seg, c->avio_opts, pls->key_url, pls->key, NULL, in);
     pls->cur_seg_offset = 0;
     return ret;
 }
@@ -1363,6 +1435,398 @@ static int update_init_section(struct playlist *pls, struct segment *seg)
     return 0;
 }
 
+#if HAVE_THREADS
+static void prefetch_slot_reset(struct prefetch_slot *slot)
+{
+    av_freep(&slot->seg.url);
+    av_freep(&slot->seg.key);
+    av_dict_free(&slot->avio_opts);
+    slot->state       = PREFETCH_FREE;
+    slot->opened      = 0;
+    slot->cancelled   = 0;
+    slot->ret         = 0;
+    slot->len         = 0;
+    slot->read_offset = 0;
+}
+
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct playlist *pls = opaque;
+    int abort;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    abort = pls->prefetch_abort;
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    return abort || ff_check_interrupt(&pls->parent->interrupt_callback);
+}
+
+/* Must be called with prefetch_lock held. */
+static void prefetch_slot_release(struct prefetch_slot *slot)
+{
+    if (slot->state == PREFETCH_LOADING)
+        slot->cancelled = 1;
+    else
+        prefetch_slot_reset(slot);
+}
+
+static int prefetch_download(struct playlist *pls, struct prefetch_slot *slot,
+                             AVIOContext **in, char *key_url, uint8_t *key,
+                             uint8_t *chunk)
+{
+    HLSContext *c = pls->parent->priv_data;
+    struct segment *seg = &slot->seg;
+    int64_t offset = 0;
+    int ret;
+
+    ret = open_segment(c, pls, seg, slot->avio_opts, key_url, key,
+                       &pls->prefetch_int_cb, in);
+    pthread_mutex_lock(&pls->prefetch_lock);
+    slot->opened = ret >= 0;
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+    if (ret < 0)
+        return ret;
+
+    for (;;) {
+        int size = PREFETCH_CHUNK_SIZE;
+        uint8_t *buf;
+
+        /* limit read if the segment was only a part of a file */
+        if (seg->size >= 0)
+            size = FFMIN(size, seg->size - offset);
+        if (size <= 0) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        ret = avio_read(*in, chunk, size);
+        if (ret <= 0)
+            break;
+        offset += ret;
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        /* wait for the reader to drain the slot before buffering more */
+        while (slot->len - slot->read_offset >= PREFETCH_MAX_BUFFERED &&
+               !slot->cancelled && !pls->prefetch_abort)
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+        if (slot->cancelled || pls->prefetch_abort) {
+            pthread_mutex_unlock(&pls->prefetch_lock);
+            ret = AVERROR_EXIT;
+            break;
+        }
+        buf = av_fast_realloc(slot->buf, &slot->buf_size, slot->len + ret);
+        if (!buf) {
+            pthread_mutex_unlock(&pls->prefetch_lock);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        slot->buf = buf;
+        memcpy(slot->buf + slot->len, chunk, ret);
+        slot->len += ret;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_lock);
+    }
+
+    if (ret == AVERROR_EOF && c->http_persistent &&
+        seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL))
+        ret = 0;
+    else
+        ff_format_io_close(pls->parent, in);
+
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct playlist *pls = arg;
+    AVIOContext *in = NULL;
+    char key_url[MAX_URL_SIZE] = "";
+    uint8_t key[16] = { 0 };
+    uint8_t *chunk = av_malloc(PREFETCH_CHUNK_SIZE);
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (!pls->prefetch_abort) {
+        struct prefetch_slot *slot = NULL;
+        int i, ret;
+
+        /* download the earliest queued segment first */
+        for (i = 0; i < pls->n_prefetch; i++) {
+            struct prefetch_slot *cur = &pls->prefetch[i];
+            if (cur->state == PREFETCH_QUEUED &&
+                (!slot || cur->seq_no < slot->seq_no))
+                slot = cur;
+        }
+        if (!slot) {
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+            continue;
+        }
+        slot->state = PREFETCH_LOADING;
+        pthread_mutex_unlock(&pls->prefetch_lock);
+
+        ret = chunk ? prefetch_download(pls, slot, &in, key_url, key, chunk) :
+                      AVERROR(ENOMEM);
+
+        pthread_mutex_lock(&pls->prefetch_lock);
+        slot->ret   = ret;
+        slot->state = PREFETCH_DONE;
+        if (slot->cancelled)
+            prefetch_slot_reset(slot);
+        pthread_cond_broadcast(&pls->prefetch_cond);
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    ff_format_io_close(pls->parent, &in);
+    av_free(chunk);
+    return NULL;
+}
+
+static int prefetch_start(HLSContext *c, struct playlist *pls)
+{
+    int i, ret;
+
+    /* the segments of the window, plus the cancelled ones which may
+     * still be in flight after a seek */
+    pls->prefetch = av_mallocz_array(2 * c->prefetch_segments, sizeof(*pls->prefetch));
+    pls->prefetch_threads = av_mallocz_array(c->prefetch_segments, sizeof(*pls->prefetch_threads));
+    if (!pls->prefetch || !pls->prefetch_threads) {
+        av_freep(&pls->prefetch);
+        av_freep(&pls->prefetch_threads);
+        return AVERROR(ENOMEM);
+    }
+    pls->n_prefetch = 2 * c->prefetch_segments;
+
+    if ((ret = pthread_mutex_init(&pls->prefetch_lock, NULL))) {
+        av_freep(&pls->prefetch);
+        av_freep(&pls->prefetch_threads);
+        pls->n_prefetch = 0;
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pls->prefetch_cond, NULL))) {
+        pthread_mutex_destroy(&pls->prefetch_lock);
+        av_freep(&pls->prefetch);
+        av_freep(&pls->prefetch_threads);
+        pls->n_prefetch = 0;
+        return AVERROR(ret);
+    }
+    pls->prefetch_int_cb.callback = prefetch_interrupt_cb;
+    pls->prefetch_int_cb.opaque   = pls;
+
+    for (i = 0; i < c->prefetch_segments; i++) {
+        ret = pthread_create(&pls->prefetch_threads[i], NULL, prefetch_thread, pls);
+        if (ret) {
+            av_log(pls->parent, AV_LOG_WARNING,
+                   "Failed to create prefetch thread for playlist %d: %s\n",
+                   pls->index, av_err2str(AVERROR(ret)));
+            break;
+        }
+        pls->n_prefetch_threads++;
+    }
+    /* queued segments are still downloaded with fewer threads, as long
+     * as there is at least one */
+    return pls->n_prefetch_threads ? 0 : AVERROR(ret);
+}
+
+static void prefetch_stop(struct playlist *pls)
+{
+    int i;
+
+    if (!pls->prefetch)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    pls->prefetch_abort = 1;
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    for (i = 0; i < pls->n_prefetch_threads; i++)
+        pthread_join(pls->prefetch_threads[i], NULL);
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        prefetch_slot_reset(&pls->prefetch[i]);
+        av_freep(&pls->prefetch[i].buf);
+    }
+    pthread_cond_destroy(&pls->prefetch_cond);
+    pthread_mutex_destroy(&pls->prefetch_lock);
+    av_freep(&pls->prefetch);
+    av_freep(&pls->prefetch_threads);
+    pls->n_prefetch = 0;
+    pls->n_prefetch_threads = 0;
+    pls->cur_prefetch = NULL;
+}
+
+/*
+ * Drop all prefetched data, e.g. after seeking. Downloads in progress are
+ * cancelled and their slots recycled by their thread once it notices.
+ */
+static void prefetch_flush(struct playlist *pls)
+{
+    int i;
+
+    if (!pls->prefetch)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    for (i = 0; i < pls->n_prefetch; i++)
+        if (pls->prefetch[i].state != PREFETCH_FREE)
+            prefetch_slot_release(&pls->prefetch[i]);
+    pls->cur_prefetch = NULL;
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+}
+
+/*
+ * Queue the segments of the window starting at the current one which are
+ * not queued yet, and release the ones which left the window.
+ * Must be called with prefetch_lock held.
+ */
+static int prefetch_schedule(HLSContext *c, struct playlist *pls)
+{
+    int first = pls->cur_seq_no;
+    int last  = FFMIN(first + c->prefetch_segments,
+                      pls->start_seq_no + pls->n_segments);
+    int i, seq_no;
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *slot = &pls->prefetch[i];
+        if (slot->state != PREFETCH_FREE && !slot->cancelled &&
+            (slot->seq_no < first || slot->seq_no >= last))
+            prefetch_slot_release(slot);
+    }
+
+    for (seq_no = first; seq_no < last; seq_no++) {
+        struct prefetch_slot *slot = NULL;
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+
+        for (i = 0; i < pls->n_prefetch; i++) {
+            struct prefetch_slot *cur = &pls->prefetch[i];
+            if (cur->state != PREFETCH_FREE && !cur->cancelled &&
+                cur->seq_no == seq_no)
+                break;
+            if (!slot && cur->state == PREFETCH_FREE)
+                slot = cur;
+        }
+        if (i < pls->n_prefetch)
+            continue;
+        if (!slot)
+            break;
+
+        slot->seg              = *seg;
+        slot->seg.init_section = NULL;
+        slot->seg.url          = av_strdup(seg->url);
+        slot->seg.key          = seg->key ? av_strdup(seg->key) : NULL;
+        if (!slot->seg.url || (seg->key && !slot->seg.key) ||
+            av_dict_copy(&slot->avio_opts, c->avio_opts, 0) < 0) {
+            prefetch_slot_reset(slot);
+            return AVERROR(ENOMEM);
+        }
+        slot->seq_no = seq_no;
+        slot->state  = PREFETCH_QUEUED;
+    }
+    pthread_cond_broadcast(&pls->prefetch_cond);
+
+    return 0;
+}
+
+/* Start reading the current segment from its prefetch slot. */
+static int prefetch_open(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch_slot *slot = NULL;
+    int i, ret;
+
+    if (!pls->prefetch && (ret = prefetch_start(c, pls)) < 0)
+        return ret;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    ret = prefetch_schedule(c, pls);
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *cur = &pls->prefetch[i];
+        if (cur->state != PREFETCH_FREE && !cur->cancelled &&
+            cur->seq_no == pls->cur_seq_no) {
+            slot = cur;
+            break;
+        }
+    }
+    if (!slot) {
+        pthread_mutex_unlock(&pls->prefetch_lock);
+        return ret < 0 ? ret : AVERROR_BUG;
+    }
+
+    while (!slot->opened && slot->state != PREFETCH_DONE)
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+    if (!slot->opened) {
+        ret = slot->ret < 0 ? slot->ret : AVERROR(EIO);
+        prefetch_slot_release(slot);
+        pthread_mutex_unlock(&pls->prefetch_lock);
+        return ret;
+    }
+    pls->cur_prefetch = slot;
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    pls->cur_seg_offset = 0;
+    return 0;
+}
+
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    struct prefetch_slot *slot = pls->cur_prefetch;
+    int ret;
+
+    pthread_mutex_lock(&pls->prefetch_lock);
+    while (slot->read_offset == slot->len && slot->state == PREFETCH_LOADING)
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_lock);
+
+    if (slot->read_offset < slot->len) {
+        ret = FFMIN(buf_size, slot->len - slot->read_offset);
+        memcpy(buf, slot->buf + slot->read_offset, ret);
+        slot->read_offset += ret;
+        /* rewind the buffer once drained, so that it does not grow
+         * beyond PREFETCH_MAX_BUFFERED for large segments */
+        if (slot->read_offset == slot->len && slot->state == PREFETCH_LOADING) {
+            slot->read_offset = slot->len = 0;
+            pthread_cond_broadcast(&pls->prefetch_cond);
+        }
+        pls->cur_seg_offset += ret;
+    } else {
+        ret = slot->ret < 0 ? slot->ret : AVERROR_EOF;
+    }
+    pthread_mutex_unlock(&pls->prefetch_lock);
+
+    return ret;
+}
+
+/* Done with the current segment, recycle its slot. */
+static void prefetch_close(struct playlist *pls)
+{
+    pthread_mutex_lock(&pls->prefetch_lock);
+    prefetch_slot_release(pls->cur_prefetch);
+    pls->cur_prefetch = NULL;
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_lock);
+}
+#else
+static int prefetch_open(HLSContext *c, struct playlist *pls)
+{
+    return AVERROR(ENOSYS);
+}
+
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    return AVERROR(ENOSYS);
+}
+
+static void prefetch_close(struct playlist *pls)
+{
+}
+
+static void prefetch_flush(struct playlist *pls)
+{
+}
+
+static void prefetch_stop(struct playlist *pls)
+{
+}
+#endif /* HAVE_THREADS */
+
 static int64_t default_reload_interval(struct playlist *pls)
 {
     return pls->n_segments > 0 ?
@@ -1429,7 +1893,8 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if ((!v->input && !v->cur_prefetch) ||
+        (c->http_persistent && v->input_read_done)) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1500,7 +1965,9 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (c->prefetch_segments > 0) {
+            ret = prefetch_open(c, v);
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1520,7 +1987,7 @@ reload:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1530,7 +1997,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && !v->cur_prefetch &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1553,7 +2020,10 @@ reload:
     }
 
     seg = current_segment(v);
-    ret = read_from_url(v, seg, buf, buf_size);
+    if (v->cur_prefetch)
+        ret = prefetch_read(v, buf, buf_size);
+    else
+        ret = read_from_url(v, seg, buf, buf_size);
     if (ret > 0) {
         if (just_opened && v->is_id3_timestamped != 0) {
             /* Intercept ID3 tags here, elementary audio streams are required
@@ -1563,7 +2033,9 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->cur_prefetch) {
+        prefetch_close(v);
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -1855,6 +2327,18 @@ static int hls_read_header(AVFormatContext *s)
        the range header */
     av_dict_set_int(&c->avio_opts, "seekable", c->http_seekable, 0);
 
+    if (!HAVE_THREADS && c->prefetch_segments > 0) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching requires threads, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+    /* segments are opened from the prefetch threads, which custom IO
+     * callbacks are not required to support */
+    if (c->prefetch_segments > 0 &&
+        (s->flags & AVFMT_FLAG_CUSTOM_IO || !ff_format_io_open_is_default(s))) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching is not supported with custom IO, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = parse_playlist(c, s->url, NULL, s->pb)) < 0)
         goto fail;
 
@@ -2075,6 +2559,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            prefetch_flush(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2316,6 +2801,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_flush(pls);
         av_packet_unref(&pls->pkt);
         pls->pb.eof_reached = 0;
         /* Clear any buffered data */
@@ -2377,6 +2863,8 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of segments to download ahead on background threads, 0 = disable",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
     {NULL}
 };
 
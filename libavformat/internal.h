@@ -142,6 +142,14 @@ struct AVFormatInternal {
      * Prefer the codec framerate for avg_frame_rate computation.
      */
     int prefer_codec_framerate;
+
+    /**
+     * Set by demuxers that only build their index through
+     * av_add_index_entry() and never access AVStream.index_entries
+     * directly, before creating their streams. The indexes of these
+     * streams are then kept in compressed form, see compactindex.h.
+     */
+    int compact_index;
 };
 
 struct AVStreamInternal {
@@ -191,6 +199,18 @@ struct AVStreamInternal {
     int is_intra_only;
 
     FFFrac *priv_pts;
+
+    /**
+     * Compressed index, used instead of AVStream.index_entries if
+     * AVFormatInternal.compact_index was set when the stream was created.
+     */
+    struct FFCompactIndex *compact_index;
+
+    /**
+     * Parameters avformat_find_stream_info() could not find,
+     * a combination of AVSTREAM_PARAM_* flags.
+     */
+    int missing_params;
 };
 
 #ifdef __GNUC__
@@ -648,6 +668,12 @@ int ff_format_output_open(AVFormatContext *s, const char *url, AVDictionary **op
  */
 void ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Check whether s opens and closes nested IO with the default callbacks,
+ * which unlike user supplied ones may be called from several threads.
+ */
+int ff_format_io_open_is_default(AVFormatContext *s);
+
 /**
  * Utility function to check if the file uses http or https protocol
  *
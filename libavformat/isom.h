@@ -155,6 +155,9 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/** number of video frames fed to the frame rate estimation when indexing */
+#define MOV_RFPS_FRAMES 100
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -217,6 +220,10 @@ typedef struct MOVStreamContext {
     int nb_frames_for_fps;
     int64_t duration_for_fps;
 
+    /** dts fed to the frame rate estimation, kept for the index cache */
+    int nb_rfps_dts;
+    int64_t rfps_dts[MOV_RFPS_FRAMES];
+
     /** extradata array (and size) for multiple stsd */
     uint8_t **extradata;
     int *extradata_size;
@@ -291,6 +298,17 @@ typedef struct MOVContext {
     int decryption_key_len;
     int enable_drefs;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
+
+    char *index_cache;      ///< directory of the sample index cache
+    int index_cache_hit;    ///< the sample tables are restored from the cache
+    int64_t file_size;      ///< size, modification time in nanoseconds and
+    int64_t file_mtime;     ///< inode identifying the file in the index cache
+    uint64_t file_ino;
+    int64_t moov_pos;       ///< position, size and CRC of the first bytes of
+    int64_t moov_size;      ///< the moov atom, checked against the index cache
+    uint32_t moov_crc;      ///< entry once it is found
+    struct MOVIndexCacheTrack *cache_tracks;
+    int nb_cache_tracks;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
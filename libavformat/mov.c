@@ -59,6 +59,7 @@
 #include "libavcodec/get_bits.h"
 #include "id3v1.h"
 #include "mov_chan.h"
+#include "mov_index_cache.h"
 #include "replaygain.h"
 
 #if CONFIG_ZLIB
@@ -1148,6 +1149,8 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
+    if (c->index_cache && (ret = ff_mov_index_cache_check_moov(c, pb, atom.size)) < 0)
+        return ret;
     if ((ret = mov_read_default(c, pb, atom)) < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
@@ -1992,6 +1995,10 @@ static int mov_read_stco(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     MOVStreamContext *sc;
     unsigned int i, entries;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->trak_index < 0) {
         av_log(c->fc, AV_LOG_WARNING, "STCO outside TRAK\n");
         return 0;
@@ -2733,6 +2740,10 @@ static int mov_read_stps(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     MOVStreamContext *sc;
     unsigned i, entries;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->fc->nb_streams < 1)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
@@ -2769,6 +2780,10 @@ static int mov_read_stss(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     MOVStreamContext *sc;
     unsigned int i, entries;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->fc->nb_streams < 1)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
@@ -2821,6 +2836,10 @@ static int mov_read_stsz(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     unsigned char* buf;
     int ret;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->fc->nb_streams < 1)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
@@ -3032,6 +3051,10 @@ static int mov_read_ctts(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     MOVStreamContext *sc;
     unsigned int i, entries, ctts_count = 0;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->fc->nb_streams < 1)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
@@ -3100,6 +3123,10 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     uint8_t version;
     uint32_t grouping_type;
 
+    /* restored from the index cache */
+    if (c->index_cache_hit)
+        return 0;
+
     if (c->fc->nb_streams < 1)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
@@ -3946,8 +3973,10 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                     av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
                             "size %u, distance %u, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
+                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < MOV_RFPS_FRAMES) {
                         ff_rfps_add_frame(mov->fc, st, current_dts);
+                        sc->rfps_dts[sc->nb_rfps_dts++] = current_dts;
+                    }
                 }
 
                 current_offset += sample_size;
@@ -4235,6 +4264,9 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     c->trak_index = -1;
 
+    if (c->index_cache_hit && (ret = ff_mov_index_cache_restore_tables(c, st)) < 0)
+        return ret;
+
     // Here stsc refers to a chunk not described in stco. This is technically invalid,
     // but we can overlook it (clearing stsc) whenever stts_count == 0 (indicating no samples).
     if (!sc->chunk_count && !sc->stts_count && sc->stsc_count) {
@@ -4260,7 +4292,13 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     avpriv_set_pts_info(st, 64, 1, sc->time_scale);
 
-    mov_build_index(c, st);
+    if (c->index_cache_hit) {
+        ff_mov_index_cache_restore_index(c, st);
+    } else {
+        mov_build_index(c, st);
+        if (c->index_cache && (ret = ff_mov_index_cache_add_track(c, st)) < 0)
+            return ret;
+    }
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -7416,6 +7454,8 @@ static int mov_read_close(AVFormatContext *s)
     av_freep(&mov->aes_decrypt);
     av_freep(&mov->chapter_tracks);
 
+    ff_mov_index_cache_free(mov);
+
     return 0;
 }
 
@@ -7575,6 +7615,9 @@ static int mov_read_header(AVFormatContext *s)
     else
         atom.size = INT64_MAX;
 
+    if (mov->index_cache)
+        ff_mov_index_cache_load(mov);
+
     /* check MOV header */
     do {
         if (mov->moov_retry)
@@ -7758,6 +7801,9 @@ static int mov_read_header(AVFormatContext *s)
         if (mov->frag_index.item[i].moof_offset <= mov->fragment.moof_offset)
             mov->frag_index.item[i].headers_read = 1;
 
+    if (mov->index_cache && !mov->index_cache_hit)
+        ff_mov_index_cache_save(mov);
+
     return 0;
 fail:
     mov_read_close(s);
@@ -8167,6 +8213,8 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "index_cache", "Directory where the sample index of local files is cached across opens",
+        OFFSET(index_cache), AV_OPT_TYPE_STRING, {.str = NULL}, .flags = FLAGS },
 
     { NULL },
 };
@@ -0,0 +1,631 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * mov sample index cache
+ *
+ * A cache entry is a file named after the SHA-1 of the input URL in the
+ * index_cache directory. It is only used if the size, modification time and
+ * inode of the input, the libavformat version and the edit list options it
+ * was written with all match, and once the moov atom is found, if its
+ * position, size and the CRC of its first bytes match too. All values are
+ * stored little-endian:
+ *
+ * header:  tag 'FMIC', libavformat version, file size, file mtime in
+ *          nanoseconds, inode, moov position, size and CRC, flags,
+ *          URL length and URL, number of tracks
+ * track:   the scalars of MOVIndexCacheTrack, then the frame rate
+ *          estimation dts, the index entries, the expanded ctts entries
+ *          and the edit list index ranges, each preceded by their count
+ */
+
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/sha.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+#include "isom.h"
+#include "mov_index_cache.h"
+#include "os_support.h"
+#include "version.h"
+
+#define CACHE_TAG         MKTAG('F','M','I','C')
+#define ENTRY_SIZE        24    ///< pos, timestamp, size and flags, min_distance
+#define CTTS_SIZE         8
+#define RANGE_SIZE        16
+#define BLOCK_ENTRIES     512
+#define MAX_TRACKS        1024
+#define MOOV_CRC_SIZE     4096  ///< bytes of the moov atom covered by the CRC
+
+static int cache_flags(const MOVContext *c)
+{
+    return c->advanced_editlist | c->ignore_editlist << 1;
+}
+
+static char *cache_path(MOVContext *c)
+{
+    struct AVSHA *sha = av_sha_alloc();
+    uint8_t hash[20];
+    char hex[2 * sizeof(hash) + 1];
+
+    if (!sha)
+        return NULL;
+    av_sha_init(sha, 160);
+    av_sha_update(sha, c->fc->url, strlen(c->fc->url));
+    av_sha_final(sha, hash);
+    av_free(sha);
+
+    ff_data_to_hex(hex, hash, sizeof(hash), 1);
+    hex[2 * sizeof(hash)] = 0;
+
+    return av_asprintf("%s/%s.idx", c->index_cache, hex);
+}
+
+/**
+ * Get the size, modification time and inode of the input, only local files
+ * can be identified.
+ */
+static int identify_file(MOVContext *c)
+{
+    const char *proto = avio_find_protocol_name(c->fc->url);
+    const char *path = c->fc->url;
+    struct stat st;
+    int ret;
+
+    if (!proto || strcmp(proto, "file"))
+        return AVERROR(ENOSYS);
+    av_strstart(path, "file:", &path);
+
+#ifndef _WIN32
+    ret = stat(path, &st);
+#else
+    ret = win32_stat(path, &st);
+#endif
+    if (ret < 0)
+        return AVERROR(errno);
+
+    c->file_size  = st.st_size;
+    c->file_mtime = st.st_mtime * INT64_C(1000000000);
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    c->file_mtime += st.st_mtim.tv_nsec;
+#endif
+    c->file_ino   = st.st_ino;
+    return 0;
+}
+
+/**
+ * Check that the index entries can be searched by timestamp and point
+ * inside the file.
+ */
+static int check_index_entries(const AVIndexEntry *e, int nb, int64_t file_size)
+{
+    int i;
+
+    for (i = 0; i < nb; i++)
+        if (e[i].pos < 0 || e[i].pos >= file_size ||
+            (i && e[i].timestamp < e[i - 1].timestamp))
+            return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+static int read_index_entries(AVIOContext *pb, AVIndexEntry *e, int nb)
+{
+    uint8_t buf[BLOCK_ENTRIES * ENTRY_SIZE];
+
+    while (nb > 0) {
+        const int n = FFMIN(nb, BLOCK_ENTRIES);
+        const uint8_t *p = buf;
+        int i, ret;
+
+        if ((ret = ffio_read_size(pb, buf, n * ENTRY_SIZE)) < 0)
+            return ret;
+        for (i = 0; i < n; i++, e++, p += ENTRY_SIZE) {
+            const uint32_t size_flags = AV_RL32(p + 16);
+
+            e->pos          = AV_RL64(p);
+            e->timestamp    = AV_RL64(p + 8);
+            e->size         = size_flags & 0x3FFFFFFF;
+            e->flags        = size_flags >> 30;
+            e->min_distance = AV_RL32(p + 20);
+        }
+        nb -= n;
+    }
+    return 0;
+}
+
+static void write_index_entries(AVIOContext *pb, const AVIndexEntry *e, int nb)
+{
+    uint8_t buf[BLOCK_ENTRIES * ENTRY_SIZE];
+
+    while (nb > 0) {
+        const int n = FFMIN(nb, BLOCK_ENTRIES);
+        uint8_t *p = buf;
+        int i;
+
+        for (i = 0; i < n; i++, e++, p += ENTRY_SIZE) {
+            AV_WL64(p,      e->pos);
+            AV_WL64(p +  8, e->timestamp);
+            AV_WL32(p + 16, e->size | (unsigned)e->flags << 30);
+            AV_WL32(p + 20, e->min_distance);
+        }
+        avio_write(pb, buf, n * ENTRY_SIZE);
+        nb -= n;
+    }
+}
+
+/**
+ * Read count elements of size bytes after checking that they fit in the
+ * rest of the file.
+ */
+static void *read_array(AVIOContext *pb, unsigned count, int size)
+{
+    int64_t left = avio_size(pb) - avio_tell(pb);
+    uint8_t *buf;
+
+    if (!count || count > left / size)
+        return NULL;
+    buf = av_malloc_array(count, size);
+    if (buf && ffio_read_size(pb, buf, count * size) < 0)
+        av_freep(&buf);
+    return buf;
+}
+
+static int read_track(AVIOContext *pb, MOVIndexCacheTrack *t, int64_t file_size)
+{
+    int64_t left;
+    uint8_t *buf;
+    unsigned i;
+    int ret;
+
+    t->sample_count      = avio_rl32(pb);
+    t->sample_size       = avio_rl32(pb);
+    t->stsz_sample_size  = avio_rl32(pb);
+    t->chunk_count       = avio_rl32(pb);
+    t->keyframe_absent   = avio_rl32(pb);
+    t->dts_shift         = avio_rl32(pb);
+    t->need_parsing      = avio_rl32(pb);
+    t->data_size         = avio_rl64(pb);
+    t->start_pad         = avio_rl32(pb);
+    t->skip_samples      = avio_rl32(pb);
+    t->video_delay       = avio_rl32(pb);
+    t->time_offset       = avio_rl64(pb);
+    t->min_corrected_pts = avio_rl64(pb);
+    t->current_index     = avio_rl64(pb);
+    t->start_time        = avio_rl64(pb);
+    t->duration          = avio_rl64(pb);
+    t->bit_rate          = avio_rl64(pb);
+
+    t->nb_rfps_dts = avio_rl32(pb);
+    if ((unsigned)t->nb_rfps_dts > MOV_RFPS_FRAMES)
+        return AVERROR_INVALIDDATA;
+    for (i = 0; i < t->nb_rfps_dts; i++)
+        t->rfps_dts[i] = avio_rl64(pb);
+
+    t->nb_index_entries = avio_rl32(pb);
+    left = avio_size(pb) - avio_tell(pb);
+    if (t->nb_index_entries < 0 ||
+        t->nb_index_entries > FFMIN(left, INT_MAX) / ENTRY_SIZE)
+        return AVERROR_INVALIDDATA;
+    if (t->nb_index_entries) {
+        t->index_entries = av_malloc_array(t->nb_index_entries, sizeof(*t->index_entries));
+        if (!t->index_entries)
+            return AVERROR(ENOMEM);
+        if ((ret = read_index_entries(pb, t->index_entries, t->nb_index_entries)) < 0)
+            return ret;
+        if ((ret = check_index_entries(t->index_entries, t->nb_index_entries, file_size)) < 0)
+            return ret;
+    }
+
+    t->ctts_count = avio_rl32(pb);
+    if (t->ctts_count) {
+        if (!(buf = read_array(pb, t->ctts_count, CTTS_SIZE)))
+            return AVERROR_INVALIDDATA;
+        t->ctts_data = av_malloc_array(t->ctts_count, sizeof(*t->ctts_data));
+        if (!t->ctts_data) {
+            av_free(buf);
+            return AVERROR(ENOMEM);
+        }
+        for (i = 0; i < t->ctts_count; i++) {
+            t->ctts_data[i].count    = AV_RL32(buf + i * CTTS_SIZE);
+            t->ctts_data[i].duration = AV_RL32(buf + i * CTTS_SIZE + 4);
+        }
+        av_free(buf);
+    }
+
+    t->nb_index_ranges = avio_rl32(pb);
+    if (t->nb_index_ranges) {
+        if (!(buf = read_array(pb, t->nb_index_ranges, RANGE_SIZE)))
+            return AVERROR_INVALIDDATA;
+        t->index_ranges = av_malloc_array(t->nb_index_ranges, sizeof(*t->index_ranges));
+        if (!t->index_ranges) {
+            av_free(buf);
+            return AVERROR(ENOMEM);
+        }
+        for (i = 0; i < t->nb_index_ranges; i++) {
+            t->index_ranges[i].start = AV_RL64(buf + i * RANGE_SIZE);
+            t->index_ranges[i].end   = AV_RL64(buf + i * RANGE_SIZE + 8);
+        }
+        av_free(buf);
+    }
+    for (i = 0; i < t->nb_index_ranges; i++) {
+        const MOVIndexRange *r = &t->index_ranges[i];
+        if ((i == t->nb_index_ranges - 1) != !r->end ||
+            r->start < 0 || (r->end && r->start > r->end) ||
+            r->end > t->nb_index_entries)
+            return AVERROR_INVALIDDATA;
+    }
+    if (t->current_index < 0 || t->current_index > t->nb_index_entries)
+        return AVERROR_INVALIDDATA;
+
+    t->valid = 1;
+    return pb->eof_reached ? AVERROR_INVALIDDATA : 0;
+}
+
+static void write_track(AVIOContext *pb, const MOVIndexCacheTrack *t)
+{
+    unsigned i;
+
+    avio_wl32(pb, t->sample_count);
+    avio_wl32(pb, t->sample_size);
+    avio_wl32(pb, t->stsz_sample_size);
+    avio_wl32(pb, t->chunk_count);
+    avio_wl32(pb, t->keyframe_absent);
+    avio_wl32(pb, t->dts_shift);
+    avio_wl32(pb, t->need_parsing);
+    avio_wl64(pb, t->data_size);
+    avio_wl32(pb, t->start_pad);
+    avio_wl32(pb, t->skip_samples);
+    avio_wl32(pb, t->video_delay);
+    avio_wl64(pb, t->time_offset);
+    avio_wl64(pb, t->min_corrected_pts);
+    avio_wl64(pb, t->current_index);
+    avio_wl64(pb, t->start_time);
+    avio_wl64(pb, t->duration);
+    avio_wl64(pb, t->bit_rate);
+
+    avio_wl32(pb, t->nb_rfps_dts);
+    for (i = 0; i < t->nb_rfps_dts; i++)
+        avio_wl64(pb, t->rfps_dts[i]);
+
+    avio_wl32(pb, t->nb_index_entries);
+    write_index_entries(pb, t->index_entries, t->nb_index_entries);
+
+    avio_wl32(pb, t->ctts_count);
+    for (i = 0; i < t->ctts_count; i++) {
+        avio_wl32(pb, t->ctts_data[i].count);
+        avio_wl32(pb, t->ctts_data[i].duration);
+    }
+
+    avio_wl32(pb, t->nb_index_ranges);
+    for (i = 0; i < t->nb_index_ranges; i++) {
+        avio_wl64(pb, t->index_ranges[i].start);
+        avio_wl64(pb, t->index_ranges[i].end);
+    }
+}
+
+static int read_cache(MOVContext *c, AVIOContext *pb)
+{
+    const char *url = c->fc->url;
+    unsigned nb_tracks, i;
+    uint8_t *cached_url;
+    int url_len, ret;
+
+    if (avio_rl32(pb) != CACHE_TAG ||
+        avio_rl32(pb) != LIBAVFORMAT_VERSION_INT ||
+        (int64_t)avio_rl64(pb) != c->file_size ||
+        (int64_t)avio_rl64(pb) != c->file_mtime ||
+        avio_rl64(pb) != c->file_ino)
+        return AVERROR(EAGAIN);
+    /* checked by ff_mov_index_cache_check_moov() */
+    c->moov_pos  = avio_rl64(pb);
+    c->moov_size = avio_rl64(pb);
+    c->moov_crc  = avio_rl32(pb);
+    if (avio_rl32(pb) != cache_flags(c))
+        return AVERROR(EAGAIN);
+
+    url_len = avio_rl32(pb);
+    if (url_len != strlen(url))
+        return AVERROR(EAGAIN);
+    if (!(cached_url = read_array(pb, url_len, 1)))
+        return AVERROR_INVALIDDATA;
+    ret = memcmp(cached_url, url, url_len);
+    av_free(cached_url);
+    if (ret)
+        return AVERROR(EAGAIN);
+
+    nb_tracks = avio_rl32(pb);
+    if (!nb_tracks || nb_tracks > MAX_TRACKS)
+        return AVERROR_INVALIDDATA;
+    c->cache_tracks = av_mallocz_array(nb_tracks, sizeof(*c->cache_tracks));
+    if (!c->cache_tracks)
+        return AVERROR(ENOMEM);
+    c->nb_cache_tracks = nb_tracks;
+
+    for (i = 0; i < nb_tracks; i++)
+        if ((ret = read_track(pb, &c->cache_tracks[i], c->file_size)) < 0)
+            return ret;
+
+    return 0;
+}
+
+void ff_mov_index_cache_load(MOVContext *c)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *pb = NULL;
+    char *path;
+    int ret;
+
+    if ((ret = identify_file(c)) < 0) {
+        av_log(s, AV_LOG_VERBOSE, "Cannot identify '%s' for the index cache\n", s->url);
+        return;
+    }
+
+    if (!(path = cache_path(c)))
+        return;
+    if (ffio_open_whitelist(&pb, path, AVIO_FLAG_READ, &s->interrupt_callback, NULL,
+                            s->protocol_whitelist, s->protocol_blacklist) < 0) {
+        av_free(path);
+        return;
+    }
+
+    ret = read_cache(c, pb);
+    if (ret < 0) {
+        if (ret != AVERROR(EAGAIN))
+            av_log(s, AV_LOG_WARNING, "Ignoring invalid index cache entry '%s'\n", path);
+        ff_mov_index_cache_free(c);
+    } else {
+        av_log(s, AV_LOG_VERBOSE, "Using the index cache entry '%s'\n", path);
+        c->index_cache_hit = 1;
+    }
+
+    avio_closep(&pb);
+    av_free(path);
+}
+
+int ff_mov_index_cache_check_moov(MOVContext *c, AVIOContext *pb, int64_t size)
+{
+    uint8_t buf[MOOV_CRC_SIZE];
+    int64_t pos = avio_tell(pb), ret;
+    uint32_t crc;
+    int len;
+
+    if (c->file_size <= 0)
+        return 0;
+
+    len = avio_read(pb, buf, FFMIN(size, sizeof(buf)));
+    if ((ret = avio_seek(pb, pos, SEEK_SET)) < 0)
+        return ret;
+    crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), 0, buf, FFMAX(len, 0));
+
+    if (c->index_cache_hit &&
+        (pos != c->moov_pos || size != c->moov_size || crc != c->moov_crc)) {
+        av_log(c->fc, AV_LOG_VERBOSE, "Index cache entry of '%s' is outdated\n", c->fc->url);
+        ff_mov_index_cache_free(c);
+        c->index_cache_hit = 0;
+    }
+    c->moov_pos  = pos;
+    c->moov_size = size;
+    c->moov_crc  = crc;
+
+    return 0;
+}
+
+int ff_mov_index_cache_restore_tables(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVIndexCacheTrack *t;
+
+    if (st->index >= c->nb_cache_tracks) {
+        av_log(c->fc, AV_LOG_ERROR, "Track %d is not in the index cache\n", st->index);
+        return AVERROR_INVALIDDATA;
+    }
+    t = &c->cache_tracks[st->index];
+
+    sc->sample_count     = t->sample_count;
+    sc->sample_size      = t->sample_size;
+    sc->stsz_sample_size = t->stsz_sample_size;
+    sc->chunk_count      = t->chunk_count;
+    sc->keyframe_absent  = t->keyframe_absent;
+    sc->dts_shift        = t->dts_shift;
+    sc->data_size        = t->data_size;
+    st->need_parsing     = t->need_parsing;
+
+    return 0;
+}
+
+void ff_mov_index_cache_restore_index(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVIndexCacheTrack *t = &c->cache_tracks[st->index];
+    int i;
+
+    st->index_entries                = t->index_entries;
+    st->nb_index_entries             = t->nb_index_entries;
+    st->index_entries_allocated_size = t->nb_index_entries * sizeof(*t->index_entries);
+    t->index_entries = NULL;
+
+    av_freep(&sc->ctts_data);
+    sc->ctts_data           = t->ctts_data;
+    sc->ctts_count          = t->ctts_count;
+    sc->ctts_allocated_size = t->ctts_count * sizeof(*t->ctts_data);
+    t->ctts_data = NULL;
+
+    sc->index_ranges        = t->index_ranges;
+    sc->current_index_range = t->index_ranges;
+    t->index_ranges = NULL;
+
+    sc->current_index     = t->current_index;
+    sc->time_offset       = t->time_offset;
+    sc->min_corrected_pts = t->min_corrected_pts;
+    sc->start_pad         = t->start_pad;
+
+    st->skip_samples           = t->skip_samples;
+    st->start_time             = t->start_time;
+    st->duration               = t->duration;
+    st->codecpar->bit_rate     = t->bit_rate;
+    st->codecpar->video_delay  = t->video_delay;
+
+    for (i = 0; i < t->nb_rfps_dts; i++)
+        ff_rfps_add_frame(c->fc, st, t->rfps_dts[i]);
+}
+
+int ff_mov_index_cache_add_track(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVIndexCacheTrack *t;
+
+    if (st->index >= c->nb_cache_tracks) {
+        MOVIndexCacheTrack *tracks = av_realloc_array(c->cache_tracks, st->index + 1,
+                                                      sizeof(*tracks));
+        if (!tracks)
+            return AVERROR(ENOMEM);
+        memset(tracks + c->nb_cache_tracks, 0,
+               (st->index + 1 - c->nb_cache_tracks) * sizeof(*tracks));
+        c->cache_tracks    = tracks;
+        c->nb_cache_tracks = st->index + 1;
+    }
+    t = &c->cache_tracks[st->index];
+
+    t->sample_count      = sc->sample_count;
+    t->sample_size       = sc->sample_size;
+    t->stsz_sample_size  = sc->stsz_sample_size;
+    t->chunk_count       = sc->chunk_count;
+    t->keyframe_absent   = sc->keyframe_absent;
+    t->dts_shift         = sc->dts_shift;
+    t->need_parsing      = st->need_parsing;
+    t->data_size         = sc->data_size;
+    t->start_pad         = sc->start_pad;
+    t->skip_samples      = st->skip_samples;
+    t->video_delay       = st->codecpar->video_delay;
+    t->time_offset       = sc->time_offset;
+    t->min_corrected_pts = sc->min_corrected_pts;
+    t->current_index     = sc->current_index;
+    t->start_time        = st->start_time;
+    t->duration          = st->duration;
+    t->bit_rate          = st->codecpar->bit_rate;
+    t->nb_rfps_dts       = sc->nb_rfps_dts;
+    memcpy(t->rfps_dts, sc->rfps_dts, sc->nb_rfps_dts * sizeof(*sc->rfps_dts));
+
+    t->nb_index_entries = st->nb_index_entries;
+    t->ctts_count       = sc->ctts_count;
+    t->nb_index_ranges  = 0;
+    if (sc->index_ranges)
+        while (sc->index_ranges[t->nb_index_ranges++].end)
+            ;
+
+    t->index_entries = av_memdup(st->index_entries,
+                                 st->nb_index_entries * sizeof(*st->index_entries));
+    t->ctts_data     = av_memdup(sc->ctts_data,
+                                 sc->ctts_count * sizeof(*sc->ctts_data));
+    t->index_ranges  = av_memdup(sc->index_ranges,
+                                 t->nb_index_ranges * sizeof(*sc->index_ranges));
+    if ((t->nb_index_entries && !t->index_entries) ||
+        (t->ctts_count       && !t->ctts_data)     ||
+        (t->nb_index_ranges  && !t->index_ranges))
+        return AVERROR(ENOMEM);
+
+    t->valid = 1;
+    return 0;
+}
+
+void ff_mov_index_cache_save(MOVContext *c)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *pb = NULL;
+    char *path = NULL, *tmp = NULL;
+    int i, ret;
+
+    /* fragmented files are indexed while they are read */
+    if (c->file_size <= 0 || c->frag_index.nb_items || c->trex_data ||
+        c->enable_drefs || !s->nb_streams || s->nb_streams != c->nb_cache_tracks ||
+        s->nb_streams > MAX_TRACKS)
+        return;
+    for (i = 0; i < s->nb_streams; i++) {
+        const MOVIndexCacheTrack *t = &c->cache_tracks[i];
+        /* such an entry would be rejected when read */
+        if (!t->valid ||
+            check_index_entries(t->index_entries, t->nb_index_entries, c->file_size) < 0)
+            return;
+    }
+
+    /* write to a temporary file, so that readers never see partial entries */
+    if (!(path = cache_path(c)) ||
+        !(tmp = av_asprintf("%s.%08x.tmp", path, av_get_random_seed())))
+        goto end;
+    if ((ret = ffio_open_whitelist(&pb, tmp, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL,
+                                   s->protocol_whitelist, s->protocol_blacklist)) < 0) {
+        av_log(s, AV_LOG_WARNING, "Cannot create index cache entry '%s'\n", tmp);
+        goto end;
+    }
+
+    avio_wl32(pb, CACHE_TAG);
+    avio_wl32(pb, LIBAVFORMAT_VERSION_INT);
+    avio_wl64(pb, c->file_size);
+    avio_wl64(pb, c->file_mtime);
+    avio_wl64(pb, c->file_ino);
+    avio_wl64(pb, c->moov_pos);
+    avio_wl64(pb, c->moov_size);
+    avio_wl32(pb, c->moov_crc);
+    avio_wl32(pb, cache_flags(c));
+    avio_wl32(pb, strlen(s->url));
+    avio_write(pb, s->url, strlen(s->url));
+    avio_wl32(pb, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++)
+        write_track(pb, &c->cache_tracks[i]);
+    avio_flush(pb);
+    ret = pb->error;
+    avio_closep(&pb);
+
+    if (ret >= 0)
+        ret = avpriv_io_move(tmp, path);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Cannot write index cache entry '%s'\n", path);
+        avpriv_io_delete(tmp);
+    } else {
+        av_log(s, AV_LOG_VERBOSE, "Wrote index cache entry '%s'\n", path);
+    }
+
+end:
+    av_free(tmp);
+    av_free(path);
+}
+
+void ff_mov_index_cache_free(MOVContext *c)
+{
+    int i;
+
+    for (i = 0; i < c->nb_cache_tracks; i++) {
+        av_freep(&c->cache_tracks[i].index_entries);
+        av_freep(&c->cache_tracks[i].ctts_data);
+        av_freep(&c->cache_tracks[i].index_ranges);
+    }
+    av_freep(&c->cache_tracks);
+    c->nb_cache_tracks = 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * On-disk cache of the mov sample index, so that reopening an unchanged
+ * file does not need to parse and expand its sample tables again.
+ */
+
+#ifndef AVFORMAT_MOV_INDEX_CACHE_H
+#define AVFORMAT_MOV_INDEX_CACHE_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+#include "isom.h"
+
+/**
+ * State of a track after mov_build_index(): everything set from the
+ * sample tables which are skipped when the track is restored.
+ */
+typedef struct MOVIndexCacheTrack {
+    int valid;
+
+    /* set while reading the sample tables */
+    unsigned int sample_count;
+    unsigned int sample_size;
+    unsigned int stsz_sample_size;
+    unsigned int chunk_count;
+    int keyframe_absent;
+    int dts_shift;
+    int need_parsing;
+    int64_t data_size;
+
+    /* set by mov_build_index() */
+    int start_pad;
+    int skip_samples;
+    int video_delay;
+    int64_t time_offset;
+    int64_t min_corrected_pts;
+    int64_t current_index;
+    int64_t start_time;
+    int64_t duration;
+    int64_t bit_rate;
+    int nb_rfps_dts;
+    int64_t rfps_dts[MOV_RFPS_FRAMES];
+
+    int nb_index_entries;
+    AVIndexEntry *index_entries;
+    unsigned int ctts_count;
+    MOVStts *ctts_data;
+    unsigned int nb_index_ranges;   ///< including the terminating empty range
+    MOVIndexRange *index_ranges;
+} MOVIndexCacheTrack;
+
+/**
+ * Look up the cache entry of the file opened by c, if the index_cache
+ * option is set. On success c->index_cache_hit is set and the sample
+ * tables of all tracks must be skipped.
+ */
+void ff_mov_index_cache_load(MOVContext *c);
+
+/**
+ * Identify the moov atom of size bytes starting at the position of pb,
+ * before it is read. If it does not match the cache entry loaded, the
+ * entry is dropped and the sample tables are read normally.
+ */
+int ff_mov_index_cache_check_moov(MOVContext *c, AVIOContext *pb, int64_t size);
+
+/**
+ * Restore what the skipped sample tables of the track st would have set.
+ * To be called when the track has been read, before using its tables.
+ */
+int ff_mov_index_cache_restore_tables(MOVContext *c, AVStream *st);
+
+/**
+ * Restore the index of the track st instead of calling mov_build_index().
+ */
+void ff_mov_index_cache_restore_index(MOVContext *c, AVStream *st);
+
+/**
+ * Keep the index of the track st, just built, for ff_mov_index_cache_save().
+ */
+int ff_mov_index_cache_add_track(MOVContext *c, AVStream *st);
+
+/**
+ * Write the cache entry of the file once its header has been read.
+ */
+void ff_mov_index_cache_save(MOVContext *c);
+
+void ff_mov_index_cache_free(MOVContext *c);
+
+#endif /* AVFORMAT_MOV_INDEX_CACHE_H */
@@ -0,0 +1,220 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/compactindex.h"
+#include "libavformat/internal.h"
+
+/* reference implementation, the flat index of AVStream */
+typedef struct FlatIndex {
+    AVIndexEntry *entries;
+    int nb_entries;
+    unsigned allocated;
+} FlatIndex;
+
+static int flat_add(FlatIndex *f, int64_t pos, int64_t ts, int size,
+                    int distance, int flags)
+{
+    return ff_add_index_entry(&f->entries, &f->nb_entries, &f->allocated,
+                              pos, ts, size, distance, flags);
+}
+
+static int same_entry(const AVIndexEntry *a, const AVIndexEntry *b)
+{
+    return a->pos          == b->pos          &&
+           a->timestamp    == b->timestamp    &&
+           a->flags        == b->flags        &&
+           a->size         == b->size         &&
+           a->min_distance == b->min_distance;
+}
+
+static int compare(FFCompactIndex *ci, const FlatIndex *f, AVLFG *lfg)
+{
+    static const int search_flags[] = {
+        0, AVSEEK_FLAG_BACKWARD, AVSEEK_FLAG_ANY,
+        AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD,
+    };
+    int64_t lo, hi;
+    int i, j;
+
+    if (ci->nb_entries != f->nb_entries) {
+        printf("%d entries instead of %d\n", ci->nb_entries, f->nb_entries);
+        return 1;
+    }
+    for (i = 0; i < f->nb_entries; i++) {
+        const AVIndexEntry *e = ff_compact_index_get(ci, i);
+        if (!e || !same_entry(e, &f->entries[i])) {
+            printf("entry %d differs\n", i);
+            return 1;
+        }
+    }
+    if (ff_compact_index_get(ci, -1) || ff_compact_index_get(ci, f->nb_entries)) {
+        printf("out of range entry returned\n");
+        return 1;
+    }
+
+    lo = f->nb_entries ? f->entries[0].timestamp - 10 : 0;
+    hi = f->nb_entries ? f->entries[f->nb_entries - 1].timestamp + 10 : 10;
+    for (i = 0; i < 200; i++) {
+        int64_t ts = lo + av_lfg_get(lfg) % (hi - lo + 1);
+
+        if (i < f->nb_entries)
+            ts = f->entries[av_lfg_get(lfg) % f->nb_entries].timestamp;
+        for (j = 0; j < FF_ARRAY_ELEMS(search_flags); j++) {
+            int a = ff_compact_index_search(ci, ts, search_flags[j]);
+            int b = ff_index_search_timestamp(f->entries, f->nb_entries,
+                                              ts, search_flags[j]);
+            if (a != b) {
+                printf("search %"PRId64" flags %d: %d instead of %d\n",
+                       ts, search_flags[j], a, b);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* check the reduced index against the entries it was made of and make
+ * it the new reference */
+static int check_reduced(FFCompactIndex *ci, FlatIndex *f, int nb_before)
+{
+    FlatIndex out = { 0 };
+    int i, idx;
+
+    if (ci->nb_entries > nb_before / 2 + 2 ||
+        !same_entry(ff_compact_index_get(ci, 0), &f->entries[0]) ||
+        !same_entry(ff_compact_index_get(ci, ci->nb_entries - 1),
+                    &f->entries[f->nb_entries - 1])) {
+        printf("bad reduction of %d entries to %d\n", nb_before, ci->nb_entries);
+        return 1;
+    }
+    for (i = 0; i < ci->nb_entries; i++) {
+        const AVIndexEntry *e = ff_compact_index_get(ci, i);
+
+        idx = ff_index_search_timestamp(f->entries, f->nb_entries,
+                                        e->timestamp, AVSEEK_FLAG_ANY);
+        if (idx < 0 || !same_entry(e, &f->entries[idx])) {
+            printf("reduced entry %d was not in the index\n", i);
+            return 1;
+        }
+        flat_add(&out, e->pos, e->timestamp, e->size, e->min_distance, e->flags);
+    }
+    av_free(f->entries);
+    *f = out;
+    return 0;
+}
+
+int main(void)
+{
+    FFCompactIndex *ci = ff_compact_index_alloc();
+    FlatIndex f = { 0 };
+    AVLFG lfg;
+    int64_t ts = 1000, pos = 0;
+    int i, ret = 0, reductions = 0;
+
+    if (!ci)
+        return 1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    /* in order, with constant frame durations and sizes, as from a CBR
+     * stream, mixed with random ones */
+    for (i = 0; i < 5000 && !ret; i++) {
+        int regular  = (i / 300) & 1;
+        int size     = regular ? 188 * 7 : av_lfg_get(&lfg) % 100000;
+        int flags    = regular ? (i % 12 == 0) : av_lfg_get(&lfg) % 3 == 0;
+        int distance = regular ? 0 : av_lfg_get(&lfg) % 16;
+
+        ts  += regular ? 3600 : 1 + av_lfg_get(&lfg) % 5000;
+        pos += regular ? 188 * 7 : size;
+        if (ff_compact_index_add(ci, pos, ts, size, distance, flags) !=
+            flat_add(&f, pos, ts, size, distance, flags)) {
+            printf("in order add %d returned a different index\n", i);
+            ret = 1;
+        }
+        if (i % 500 == 0)
+            ret |= compare(ci, &f, &lfg);
+    }
+    ret |= compare(ci, &f, &lfg);
+    if (ci->size >= f.nb_entries * sizeof(*f.entries) / 2) {
+        printf("%d bytes for %d bytes flat\n", (int)ci->size,
+               (int)(f.nb_entries * sizeof(*f.entries)));
+        ret = 1;
+    }
+    printf("in order: %d entries, %d blocks\n", ci->nb_entries, ci->nb_blocks);
+
+    /* out of order, including updates of existing entries */
+    for (i = 0; i < 2000 && !ret; i++) {
+        int64_t t = av_lfg_get(&lfg) % (ts + 2000);
+        int64_t p = av_lfg_get(&lfg) % (pos + 1);
+        int size  = av_lfg_get(&lfg) % 1000;
+        int flags = av_lfg_get(&lfg) & 1;
+        int dist  = av_lfg_get(&lfg) % 8;
+
+        if (i & 1 && f.nb_entries) {
+            const AVIndexEntry *e = &f.entries[av_lfg_get(&lfg) % f.nb_entries];
+            t = e->timestamp;
+            p = i & 2 ? e->pos : p;
+        }
+        if (ff_compact_index_add(ci, p, t, size, dist, flags) !=
+            flat_add(&f, p, t, size, dist, flags)) {
+            printf("out of order add %d returned a different index\n", i);
+            ret = 1;
+        }
+        if (i % 200 == 0)
+            ret |= compare(ci, &f, &lfg);
+    }
+    ret |= compare(ci, &f, &lfg);
+    printf("out of order: %d entries, %d blocks\n", ci->nb_entries, ci->nb_blocks);
+
+    /* repeated reductions, while entries keep being added */
+    for (i = 0; i < 20000 && !ret; i++) {
+        int nb_before = ci->nb_entries;
+        size_t size   = ci->size;
+
+        ts  += 1 + av_lfg_get(&lfg) % 4000;
+        pos += 1 + av_lfg_get(&lfg) % 4000;
+        ff_compact_index_add(ci, pos, ts, 1000, 0, AVINDEX_KEYFRAME);
+        flat_add(&f, pos, ts, 1000, 0, AVINDEX_KEYFRAME);
+
+        if (ff_compact_index_reduce(ci, 2048) < 0) {
+            ret = 1;
+            break;
+        }
+        if (ci->nb_entries < nb_before + 1) {
+            reductions++;
+            if (ci->size >= size) {
+                printf("reduction did not save memory\n");
+                ret = 1;
+            }
+            ret |= check_reduced(ci, &f, nb_before + 1);
+        }
+        if (i % 100 == 0)
+            ret |= compare(ci, &f, &lfg);
+    }
+    ret |= compare(ci, &f, &lfg);
+    printf("reduced: %d entries, %d blocks after %d reductions\n",
+           ci->nb_entries, ci->nb_blocks, reductions);
+
+    ff_compact_index_free(&ci);
+    av_free(f.entries);
+    return ret;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+static const struct {
+    int flag;
+    const char *name;
+} params[] = {
+    { AVSTREAM_PARAM_CODEC,       "codec"       },
+    { AVSTREAM_PARAM_FRAME_SIZE,  "frame_size"  },
+    { AVSTREAM_PARAM_SAMPLE_FMT,  "sample_fmt"  },
+    { AVSTREAM_PARAM_SAMPLE_RATE, "sample_rate" },
+    { AVSTREAM_PARAM_CHANNELS,    "channels"    },
+    { AVSTREAM_PARAM_SIZE,        "size"        },
+    { AVSTREAM_PARAM_PIX_FMT,     "pix_fmt"     },
+    { AVSTREAM_PARAM_FRAME,       "frame"       },
+};
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *ic = NULL;
+    AVCodecContext *avctx;
+    AVDictionary *format_opts = NULL;
+    int i, j, ret;
+
+    if (argc < 2 || argc & 1) {
+        printf("usage: %s input_file [-option value ...]\n"
+               "Print the stream parameters found by avformat_find_stream_info().\n",
+               argv[0]);
+        return 1;
+    }
+
+    for (i = 2; i + 1 < argc; i += 2)
+        av_dict_set(&format_opts, argv[i] + (argv[i][0] == '-'), argv[i + 1], 0);
+
+    ret = avformat_open_input(&ic, argv[1], NULL, &format_opts);
+    av_dict_free(&format_opts);
+    if (ret < 0) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    avctx = avcodec_alloc_context3(NULL);
+    if (!avctx)
+        return 1;
+
+    ret = avformat_find_stream_info(ic, NULL);
+    printf("ret:%s nb_streams:%d\n", ret < 0 ? "error" : "ok", ic->nb_streams);
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+        int missing  = av_stream_get_missing_params(st);
+        char buf[256];
+
+        if (avcodec_parameters_to_context(avctx, st->codecpar) < 0)
+            return 1;
+        avcodec_string(buf, sizeof(buf), avctx, 0);
+        printf("stream %d: %s\n", i, buf);
+        printf("  time_base:%d/%d r_frame_rate:%d/%d avg_frame_rate:%d/%d start_time:%"PRId64"\n",
+               st->time_base.num, st->time_base.den,
+               st->r_frame_rate.num, st->r_frame_rate.den,
+               st->avg_frame_rate.num, st->avg_frame_rate.den,
+               st->start_time);
+        printf("  missing:");
+        if (!missing)
+            printf(" none");
+        for (j = 0; j < FF_ARRAY_ELEMS(params); j++)
+            if (missing & params[j].flag)
+                printf(" %s", params[j].name);
+        printf("\n");
+    }
+
+    avcodec_free_context(&avctx);
+    avformat_close_input(&ic);
+    return 0;
+}
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -79,6 +80,20 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_RX_BATCH 16
+
+#if HAVE_PTHREAD_CANCEL && HAVE_RECVMMSG
+/* A datagram received with recvmmsg() by the circular buffer thread */
+typedef struct UDPRxSlot {
+    struct sockaddr_storage addr;
+    struct iovec iov;
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(uint32_t))];
+    } control;
+    uint8_t data[UDP_MAX_PKT_SIZE + 4];
+} UDPRxSlot;
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -108,7 +123,16 @@ typedef struct UDPContext {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+#if HAVE_RECVMMSG
+    struct mmsghdr rx_msgs[UDP_RX_BATCH];
+    UDPRxSlot *rx_slots;
 #endif
+    /* counted by the receiving thread, copied by udp_read() */
+    int64_t rx_fifo_overruns;
+    int64_t rx_kernel_drops;
+#endif
+    int64_t fifo_overruns;
+    int64_t kernel_drops;
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *localaddr;
@@ -141,6 +165,8 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "fifo_overruns",  "number of datagrams dropped because the receiving circular buffer was full", OFFSET(fifo_overruns), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "kernel_drops",   "number of datagrams dropped by the system because the socket buffer was full", OFFSET(kernel_drops), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
     { NULL }
 };
 
@@ -460,6 +486,40 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+#if HAVE_RECVMMSG
+static int init_rx_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int i, one = 1;
+
+    s->rx_slots = av_malloc_array(UDP_RX_BATCH, sizeof(*s->rx_slots));
+    if (!s->rx_slots)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < UDP_RX_BATCH; i++) {
+        UDPRxSlot *slot     = &s->rx_slots[i];
+        struct msghdr *msg  = &s->rx_msgs[i].msg_hdr;
+
+        /* leave room for the datagram size written to the fifo */
+        slot->iov.iov_base  = slot->data + 4;
+        slot->iov.iov_len   = UDP_MAX_PKT_SIZE;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_name       = &slot->addr;
+        msg->msg_iov        = &slot->iov;
+        msg->msg_iovlen     = 1;
+        msg->msg_control    = slot->control.buf;
+    }
+
+#ifdef SO_RXQ_OVFL
+    /* report the number of datagrams dropped because the socket buffer was full */
+    if (setsockopt(s->udp_fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) < 0)
+        ff_log_net_error(h, AV_LOG_VERBOSE, "setsockopt(SO_RXQ_OVFL)");
+#endif
+
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -474,44 +534,79 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int i, nb_datagrams;
+#if HAVE_RECVMMSG
+        for (i = 0; i < UDP_RX_BATCH; i++) {
+            s->rx_msgs[i].msg_hdr.msg_namelen    = sizeof(s->rx_slots[i].addr);
+            s->rx_msgs[i].msg_hdr.msg_controllen = sizeof(s->rx_slots[i].control);
+        }
+#else
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
+        int len;
+#endif
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        /* wait for one datagram, then take all those already queued */
+        nb_datagrams = recvmmsg(s->udp_fd, s->rx_msgs, UDP_RX_BATCH, MSG_WAITFORONE, NULL);
+#else
         len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+        nb_datagrams = len < 0 ? len : 1;
+#endif
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (nb_datagrams < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
                 s->circular_buffer_error = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (i = 0; i < nb_datagrams; i++) {
+#if HAVE_RECVMMSG
+            uint8_t *buf = s->rx_slots[i].data;
+            int len = s->rx_msgs[i].msg_len;
+#ifdef SO_RXQ_OVFL
+            struct msghdr *msg = &s->rx_msgs[i].msg_hdr;
+            struct cmsghdr *cmsg;
+
+            for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                    s->rx_kernel_drops = AV_RN32(CMSG_DATA(cmsg));
+#endif
+            if (ff_ip_check_source_lists(&s->rx_slots[i].addr, &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+#else
+            uint8_t *buf = s->tmp;
+
+            if (ff_ip_check_source_lists(&addr, &s->filters))
+                continue;
+#endif
+            AV_WL32(buf, len);
+
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                s->rx_fifo_overruns++;
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_generic_write(s->fifo, buf, len+4, NULL);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
     }
 
@@ -893,6 +988,11 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
         int ret;
 
+#if HAVE_RECVMMSG
+        if (!is_output && init_rx_batch(h) < 0)
+            goto fail;
+#endif
+
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
         ret = pthread_mutex_init(&s->mutex, NULL);
@@ -925,6 +1025,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL && HAVE_RECVMMSG
+    av_freep(&s->rx_slots);
+#endif
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -951,6 +1054,9 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     if (s->fifo) {
         pthread_mutex_lock(&s->mutex);
         do {
+            /* the options are read from the caller's thread without lock */
+            s->fifo_overruns = s->rx_fifo_overruns;
+            s->kernel_drops  = s->rx_kernel_drops;
             avail = av_fifo_size(s->fifo);
             if (avail) { // >=size) {
                 uint8_t tmp[4];
@@ -1094,6 +1200,9 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL && HAVE_RECVMMSG
+    av_freep(&s->rx_slots);
+#endif
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
@@ -86,6 +86,17 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    /**
+     * Give direct access to the data at pos, without copying it.
+     * On success, *data points to the data at pos and the number of bytes
+     * that can be read from it is returned; the protocol must keep that
+     * memory valid until the next call or until the context is closed.
+     * If data is NULL, only check whether the context supports mapping
+     * and return 0 if it does.
+     * Return AVERROR_EOF at the end of the resource and AVERROR(ENOSYS)
+     * if the data cannot be accessed this way.
+     */
+    int (*url_map)(URLContext *h, int64_t pos, const uint8_t **data);
     int (*url_shutdown)(URLContext *h, int flags);
     int priv_data_size;
     const AVClass *priv_data_class;
@@ -257,6 +268,15 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Access the data at pos directly, without copying it.
+ *
+ * @see URLProtocol.url_map
+ * @return number of bytes available at *data, 0 if data is NULL and
+ * the URLContext supports mapping, or <0 on error.
+ */
+int ffurl_map(URLContext *h, int64_t pos, const uint8_t **data);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
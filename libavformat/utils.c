@@ -41,6 +41,7 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "compactindex.h"
 #include "id3v2.h"
 #include "internal.h"
 #if CONFIG_NETWORK
@@ -141,6 +142,11 @@ int64_t av_stream_get_end_pts(const AVStream *st)
         return AV_NOPTS_VALUE;
 }
 
+int av_stream_get_missing_params(const AVStream *st)
+{
+    return st->internal->missing_params;
+}
+
 struct AVCodecParserContext *av_stream_get_parser(const AVStream *st)
 {
     return st->parser;
@@ -1975,14 +1981,46 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     AVStream *st             = s->streams[stream_index];
     unsigned int max_entries = s->max_index_size / sizeof(AVIndexEntry);
 
-    if ((unsigned) st->nb_index_entries >= max_entries) {
-        int i;
-        for (i = 0; 2 * i < st->nb_index_entries; i++)
-            st->index_entries[i] = st->index_entries[2 * i];
-        st->nb_index_entries = i;
+    if (st->internal->compact_index) {
+        ff_compact_index_reduce(st->internal->compact_index, s->max_index_size);
+        return;
+    }
+
+    if ((unsigned) st->nb_index_entries >= max_entries && st->nb_index_entries > 2) {
+        AVIndexEntry *entries = st->index_entries;
+        int nb_entries = st->nb_index_entries;
+        uint64_t span  = (uint64_t)entries[nb_entries - 1].timestamp - entries[0].timestamp;
+        uint64_t keep  = FFMAX(max_entries / 2, 1);
+        uint64_t step  = FFMAX((span + keep - 1) / keep, 1);
+        int i, j;
+
+        /* Timestamps in the index are strictly increasing, so keeping entries
+         * at least step apart leaves at most max_entries / 2 + 1 of them.
+         * Unlike dropping every other entry, this keeps them evenly spread
+         * over time however often a growing index gets reduced.
+         * The first and last entries are always kept. */
+        for (i = j = 1; i < nb_entries - 1; i++)
+            if ((uint64_t)entries[i].timestamp - entries[j - 1].timestamp >= step)
+                entries[j++] = entries[i];
+        entries[j++] = entries[nb_entries - 1];
+        st->nb_index_entries = j;
     }
 }
 
+static int check_index_entry(int64_t *timestamp, int size)
+{
+    if (*timestamp == AV_NOPTS_VALUE)
+        return AVERROR(EINVAL);
+
+    if (size < 0 || size > 0x3FFFFFFF)
+        return AVERROR(EINVAL);
+
+    if (is_relative(*timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
+        *timestamp -= RELATIVE_TS_BASE;
+
+    return 0;
+}
+
 int ff_add_index_entry(AVIndexEntry **index_entries,
                        int *nb_index_entries,
                        unsigned int *index_entries_allocated_size,
@@ -1990,19 +2028,13 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
                        int size, int distance, int flags)
 {
     AVIndexEntry *entries, *ie;
-    int index;
+    int index, ret;
 
     if ((unsigned) *nb_index_entries + 1 >= UINT_MAX / sizeof(AVIndexEntry))
         return -1;
 
-    if (timestamp == AV_NOPTS_VALUE)
-        return AVERROR(EINVAL);
-
-    if (size < 0 || size > 0x3FFFFFFF)
-        return AVERROR(EINVAL);
-
-    if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
-        timestamp -= RELATIVE_TS_BASE;
+    if ((ret = check_index_entry(&timestamp, size)) < 0)
+        return ret;
 
     entries = av_fast_realloc(*index_entries,
                               index_entries_allocated_size,
@@ -2046,6 +2078,15 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags)
 {
     timestamp = wrap_timestamp(st, timestamp);
+
+    if (st->internal->compact_index) {
+        int ret = check_index_entry(&timestamp, size);
+        if (ret < 0)
+            return ret;
+        return ff_compact_index_add(st->internal->compact_index, pos,
+                                    timestamp, size, distance, flags);
+    }
+
     return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
                               &st->index_entries_allocated_size, pos,
                               timestamp, size, distance, flags);
@@ -2123,13 +2164,13 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
             if (ist1 == ist2)
                 continue;
 
-            for (i1 = i2 = 0; i1 < st1->nb_index_entries; i1++) {
-                AVIndexEntry *e1 = &st1->index_entries[i1];
+            for (i1 = i2 = 0; i1 < avformat_index_get_entries_count(st1); i1++) {
+                const AVIndexEntry *e1 = avformat_index_get_entry(st1, i1);
                 int64_t e1_pts = av_rescale_q(e1->timestamp, st1->time_base, AV_TIME_BASE_Q);
 
                 skip = FFMAX(skip, e1->size);
-                for (; i2 < st2->nb_index_entries; i2++) {
-                    AVIndexEntry *e2 = &st2->index_entries[i2];
+                for (; i2 < avformat_index_get_entries_count(st2); i2++) {
+                    const AVIndexEntry *e2 = avformat_index_get_entry(st2, i2);
                     int64_t e2_pts = av_rescale_q(e2->timestamp, st2->time_base, AV_TIME_BASE_Q);
                     if (e2_pts < e1_pts || e2_pts - (uint64_t)e1_pts < time_tolerance)
                         continue;
@@ -2161,10 +2202,37 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
 
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
+    if (st->internal->compact_index)
+        return ff_compact_index_search(st->internal->compact_index,
+                                       wanted_timestamp, flags);
     return ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
                                      wanted_timestamp, flags);
 }
 
+int avformat_index_get_entries_count(const AVStream *st)
+{
+    if (st->internal->compact_index)
+        return st->internal->compact_index->nb_entries;
+    return st->nb_index_entries;
+}
+
+const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx)
+{
+    if (st->internal->compact_index)
+        return ff_compact_index_get(st->internal->compact_index, idx);
+    if (idx < 0 || idx >= st->nb_index_entries)
+        return NULL;
+    return &st->index_entries[idx];
+}
+
+const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
+                                                            int64_t wanted_timestamp,
+                                                            int flags)
+{
+    return avformat_index_get_entry(st,
+                                    av_index_search_timestamp(st, wanted_timestamp, flags));
+}
+
 static int64_t ff_read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
                                  int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ))
 {
@@ -2194,15 +2262,15 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
     pos_limit = -1; // GCC falsely says it may be uninitialized.
 
     st = s->streams[stream_index];
-    if (st->index_entries) {
-        AVIndexEntry *e;
+    if (avformat_index_get_entries_count(st)) {
+        const AVIndexEntry *e;
 
         /* FIXME: Whole function must be checked for non-keyframe entries in
          * index case, especially read_timestamp(). */
         index = av_index_search_timestamp(st, target_ts,
                                           flags | AVSEEK_FLAG_BACKWARD);
         index = FFMAX(index, 0);
-        e     = &st->index_entries[index];
+        e     = avformat_index_get_entry(st, index);
 
         if (e->timestamp <= target_ts || e->pos == e->min_distance) {
             pos_min = e->pos;
@@ -2215,9 +2283,9 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
 
         index = av_index_search_timestamp(st, target_ts,
                                           flags & ~AVSEEK_FLAG_BACKWARD);
-        av_assert0(index < st->nb_index_entries);
+        av_assert0(index < avformat_index_get_entries_count(st));
         if (index >= 0) {
-            e = &st->index_entries[index];
+            e = avformat_index_get_entry(st, index);
             av_assert1(e->timestamp >= target_ts);
             pos_max   = e->pos;
             ts_max    = e->timestamp;
@@ -2409,26 +2477,26 @@ static int seek_frame_byte(AVFormatContext *s, int stream_index,
 static int seek_frame_generic(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
-    int index;
+    int index, nb_entries;
     int64_t ret;
     AVStream *st;
-    AVIndexEntry *ie;
+    const AVIndexEntry *ie;
 
     st = s->streams[stream_index];
 
-    index = av_index_search_timestamp(st, timestamp, flags);
+    index      = av_index_search_timestamp(st, timestamp, flags);
+    nb_entries = avformat_index_get_entries_count(st);
 
-    if (index < 0 && st->nb_index_entries &&
-        timestamp < st->index_entries[0].timestamp)
+    if (index < 0 && nb_entries &&
+        timestamp < avformat_index_get_entry(st, 0)->timestamp)
         return -1;
 
-    if (index < 0 || index == st->nb_index_entries - 1) {
+    if (index < 0 || index == nb_entries - 1) {
         AVPacket pkt;
         int nonkey = 0;
 
-        if (st->nb_index_entries) {
-            av_assert0(st->index_entries);
-            ie = &st->index_entries[st->nb_index_entries - 1];
+        if (nb_entries) {
+            ie = avformat_index_get_entry(st, nb_entries - 1);
             if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
                 return ret;
             ff_update_cur_dts(s, st, ie->timestamp);
@@ -2465,7 +2533,7 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
     if (s->iformat->read_seek)
         if (s->iformat->read_seek(s, stream_index, timestamp, flags) >= 0)
             return 0;
-    ie = &st->index_entries[index];
+    ie = avformat_index_get_entry(st, index);
     if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
         return ret;
     ff_update_cur_dts(s, st, ie->timestamp);
@@ -2997,51 +3065,60 @@ static void estimate_timings(AVFormatContext *ic, int64_t old_offset)
     }
 }
 
-static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
+/**
+ * @return the parameters still missing for the stream, a combination of
+ *         AVSTREAM_PARAM_* flags. errmsg_ptr is set for the first one.
+ */
+static int missing_codec_parameters(AVStream *st, const char **errmsg_ptr)
 {
     AVCodecContext *avctx = st->internal->avctx;
+    int missing = 0;
 
-#define FAIL(errmsg) do {                                         \
-        if (errmsg_ptr)                                           \
+#define FAIL(param, errmsg) do {                                  \
+        if (errmsg_ptr && !missing)                               \
             *errmsg_ptr = errmsg;                                 \
-        return 0;                                                 \
+        missing |= AVSTREAM_PARAM_ ## param;                      \
     } while (0)
 
     if (   avctx->codec_id == AV_CODEC_ID_NONE
         && avctx->codec_type != AVMEDIA_TYPE_DATA)
-        FAIL("unknown codec");
+        FAIL(CODEC, "unknown codec");
     switch (avctx->codec_type) {
     case AVMEDIA_TYPE_AUDIO:
         if (!avctx->frame_size && determinable_frame_size(avctx))
-            FAIL("unspecified frame size");
+            FAIL(FRAME_SIZE, "unspecified frame size");
         if (st->info->found_decoder >= 0 &&
             avctx->sample_fmt == AV_SAMPLE_FMT_NONE)
-            FAIL("unspecified sample format");
+            FAIL(SAMPLE_FMT, "unspecified sample format");
         if (!avctx->sample_rate)
-            FAIL("unspecified sample rate");
+            FAIL(SAMPLE_RATE, "unspecified sample rate");
         if (!avctx->channels)
-            FAIL("unspecified number of channels");
+            FAIL(CHANNELS, "unspecified number of channels");
         if (st->info->found_decoder >= 0 && !st->nb_decoded_frames && avctx->codec_id == AV_CODEC_ID_DTS)
-            FAIL("no decodable DTS frames");
+            FAIL(FRAME, "no decodable DTS frames");
         break;
     case AVMEDIA_TYPE_VIDEO:
         if (!avctx->width)
-            FAIL("unspecified size");
+            FAIL(SIZE, "unspecified size");
         if (st->info->found_decoder >= 0 && avctx->pix_fmt == AV_PIX_FMT_NONE)
-            FAIL("unspecified pixel format");
+            FAIL(PIX_FMT, "unspecified pixel format");
         if (st->codecpar->codec_id == AV_CODEC_ID_RV30 || st->codecpar->codec_id == AV_CODEC_ID_RV40)
             if (!st->sample_aspect_ratio.num && !st->codecpar->sample_aspect_ratio.num && !st->codec_info_nb_frames)
-                FAIL("no frame in rv30/40 and no sar");
+                FAIL(FRAME, "no frame in rv30/40 and no sar");
         break;
     case AVMEDIA_TYPE_SUBTITLE:
         if (avctx->codec_id == AV_CODEC_ID_HDMV_PGS_SUBTITLE && !avctx->width)
-            FAIL("unspecified size");
+            FAIL(SIZE, "unspecified size");
         break;
-    case AVMEDIA_TYPE_DATA:
-        if (avctx->codec_id == AV_CODEC_ID_NONE) return 1;
     }
+#undef FAIL
 
-    return 1;
+    return missing;
+}
+
+static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
+{
+    return !missing_codec_parameters(st, errmsg_ptr);
 }
 
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
@@ -3145,6 +3222,508 @@ fail:
     return ret;
 }
 
+#if HAVE_THREADS
+/*
+ * Decoding of the audio and video streams on worker threads during
+ * avformat_find_stream_info(), enabled by AVFormatContext.analyze_threads.
+ * Each stream has its own decoder, fed with references to the packets read
+ * by the calling thread. The workers never touch the AVStream; the calling
+ * thread merges the parameters found by the decoders into the stream codec
+ * context before checking them.
+ */
+typedef struct AnalyzeStream {
+    const AVCodec *codec;
+    AVCodecContext *dec;
+    AVPacketList *queue, *queue_end;
+    int busy;               ///< a worker is using dec
+    int flush;              ///< drain dec once the queue is empty
+
+    /* parameters found by dec */
+    AVCodecParameters *par;
+    AVRational time_base;
+    AVRational framerate;
+    int ticks_per_frame;
+    int coded_width, coded_height;
+    unsigned properties;
+    int nb_decoded_frames;
+    int updated;
+} AnalyzeStream;
+
+typedef struct AnalyzeContext {
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    AnalyzeStream **streams;
+    int nb_streams;
+    int next;
+    int exit;
+} AnalyzeContext;
+
+static int analyze_stream_type(const AVStream *st)
+{
+    return st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+           st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+}
+
+static int analyze_has_stream(AnalyzeContext *ac, int stream_index)
+{
+    return ac && stream_index < ac->nb_streams && ac->streams[stream_index];
+}
+
+static int analyze_need_decoding(AVStream *st, const AVCodec *codec)
+{
+    return !has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
+           (!st->codec_info_nb_frames && (codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF));
+}
+
+/* Must be called with the lock held, by the thread using dec. */
+static void analyze_publish(AnalyzeStream *as)
+{
+    AVCodecContext *dec = as->dec;
+
+    if (avcodec_parameters_from_context(as->par, dec) < 0)
+        return;
+    as->time_base       = dec->time_base;
+    as->framerate       = dec->framerate;
+    as->ticks_per_frame = dec->ticks_per_frame;
+    as->coded_width     = dec->coded_width;
+    as->coded_height    = dec->coded_height;
+    as->properties      = dec->properties;
+    as->updated         = 1;
+}
+
+/* Copy the parameters set by the decoder, keeping those it did not set. */
+static void analyze_merge(AVStream *st, AnalyzeStream *as)
+{
+    AVCodecContext *avctx        = st->internal->avctx;
+    const AVCodecParameters *par = as->par;
+
+    as->updated = 0;
+
+    if (par->format >= 0) {
+        if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+            avctx->pix_fmt    = par->format;
+        else
+            avctx->sample_fmt = par->format;
+    }
+    if (par->width && par->height) {
+        avctx->width  = par->width;
+        avctx->height = par->height;
+    }
+    if (par->sample_aspect_ratio.num)
+        avctx->sample_aspect_ratio = par->sample_aspect_ratio;
+    if (par->field_order != AV_FIELD_UNKNOWN)
+        avctx->field_order = par->field_order;
+    if (par->color_range != AVCOL_RANGE_UNSPECIFIED)
+        avctx->color_range = par->color_range;
+    if (par->color_primaries != AVCOL_PRI_UNSPECIFIED)
+        avctx->color_primaries = par->color_primaries;
+    if (par->color_trc != AVCOL_TRC_UNSPECIFIED)
+        avctx->color_trc = par->color_trc;
+    if (par->color_space != AVCOL_SPC_UNSPECIFIED)
+        avctx->colorspace = par->color_space;
+    if (par->chroma_location != AVCHROMA_LOC_UNSPECIFIED)
+        avctx->chroma_sample_location = par->chroma_location;
+    if (par->video_delay)
+        avctx->has_b_frames = par->video_delay;
+    if (par->profile != FF_PROFILE_UNKNOWN)
+        avctx->profile = par->profile;
+    if (par->level != FF_LEVEL_UNKNOWN)
+        avctx->level = par->level;
+    if (par->bit_rate)
+        avctx->bit_rate = par->bit_rate;
+    if (par->bits_per_coded_sample)
+        avctx->bits_per_coded_sample = par->bits_per_coded_sample;
+    if (par->bits_per_raw_sample)
+        avctx->bits_per_raw_sample = par->bits_per_raw_sample;
+    if (par->channels) {
+        avctx->channels       = par->channels;
+        avctx->channel_layout = par->channel_layout;
+    }
+    if (par->sample_rate)
+        avctx->sample_rate = par->sample_rate;
+    if (par->block_align)
+        avctx->block_align = par->block_align;
+    if (par->frame_size)
+        avctx->frame_size = par->frame_size;
+    if (par->initial_padding)
+        avctx->initial_padding = par->initial_padding;
+    if (par->seek_preroll)
+        avctx->seek_preroll = par->seek_preroll;
+    if (!avctx->extradata && par->extradata_size > 0) {
+        avctx->extradata = av_mallocz(par->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (avctx->extradata) {
+            memcpy(avctx->extradata, par->extradata, par->extradata_size);
+            avctx->extradata_size = par->extradata_size;
+        }
+    }
+
+    if (as->time_base.num)
+        avctx->time_base = as->time_base;
+    if (as->framerate.num)
+        avctx->framerate = as->framerate;
+    avctx->ticks_per_frame = as->ticks_per_frame;
+    if (as->coded_width) {
+        avctx->coded_width  = as->coded_width;
+        avctx->coded_height = as->coded_height;
+    }
+    avctx->properties    |= as->properties;
+    st->nb_decoded_frames = as->nb_decoded_frames;
+}
+
+static void analyze_update(AVFormatContext *ic, AnalyzeContext *ac)
+{
+    int i;
+
+    pthread_mutex_lock(&ac->lock);
+    for (i = 0; i < ac->nb_streams; i++)
+        if (ac->streams[i] && ac->streams[i]->updated)
+            analyze_merge(ic->streams[i], ac->streams[i]);
+    pthread_mutex_unlock(&ac->lock);
+}
+
+/**
+ * @return the number of frames decoded or a negative error code
+ */
+static int analyze_decode(AVCodecContext *dec, const AVPacket *pkt)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret, nb_frames = 0;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    ret = avcodec_send_packet(dec, pkt);
+    if (ret >= 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        while ((ret = avcodec_receive_frame(dec, frame)) >= 0) {
+            av_frame_unref(frame);
+            nb_frames++;
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            ret = 0;
+    }
+
+    av_frame_free(&frame);
+    return ret < 0 ? ret : nb_frames;
+}
+
+static void *analyze_worker(void *arg)
+{
+    AnalyzeContext *ac = arg;
+
+    pthread_mutex_lock(&ac->lock);
+    while (!ac->exit) {
+        AnalyzeStream *as = NULL;
+        AVPacket pkt = { 0 };
+        int i, flush, ret;
+
+        for (i = 0; i < ac->nb_streams && !as; i++) {
+            AnalyzeStream *s = ac->streams[(ac->next + i) % ac->nb_streams];
+            if (s && !s->busy && (s->queue || s->flush))
+                as = s;
+        }
+        if (!as) {
+            pthread_cond_wait(&ac->work_cond, &ac->lock);
+            continue;
+        }
+        /* start with the next stream the next time, so that one stream
+         * with many packets does not starve the others */
+        ac->next = (ac->next + i) % ac->nb_streams;
+
+        flush = !as->queue;
+        if (flush)
+            av_init_packet(&pkt);
+        else
+            ff_packet_list_get(&as->queue, &as->queue_end, &pkt);
+        as->busy = 1;
+        pthread_mutex_unlock(&ac->lock);
+
+        ret = analyze_decode(as->dec, &pkt);
+        av_packet_unref(&pkt);
+
+        pthread_mutex_lock(&ac->lock);
+        if (ret > 0)
+            as->nb_decoded_frames += ret;
+        if (flush)
+            as->flush = 0;
+        analyze_publish(as);
+        as->busy = 0;
+        pthread_cond_broadcast(&ac->done_cond);
+    }
+    pthread_mutex_unlock(&ac->lock);
+
+    return NULL;
+}
+
+/**
+ * Wait until the packets queued for a stream are decoded.
+ *
+ * @return 1 if there were packets to wait for, 0 otherwise
+ */
+static int analyze_wait_stream(AVFormatContext *ic, AnalyzeContext *ac,
+                               int stream_index)
+{
+    AnalyzeStream *as;
+    int waited = 0;
+
+    if (!analyze_has_stream(ac, stream_index))
+        return 0;
+    as = ac->streams[stream_index];
+
+    pthread_mutex_lock(&ac->lock);
+    while (as->busy || as->queue) {
+        pthread_cond_wait(&ac->done_cond, &ac->lock);
+        waited = 1;
+    }
+    if (as->updated)
+        analyze_merge(ic->streams[stream_index], as);
+    pthread_mutex_unlock(&ac->lock);
+
+    return waited;
+}
+
+/**
+ * Wait until the workers are done with all the queued packets and flushes.
+ *
+ * @param drop discard the queued packets and flushes instead
+ */
+static void analyze_wait(AnalyzeContext *ac, int drop)
+{
+    int i, idle;
+
+    pthread_mutex_lock(&ac->lock);
+    do {
+        idle = 1;
+        for (i = 0; i < ac->nb_streams; i++) {
+            AnalyzeStream *as = ac->streams[i];
+            if (!as)
+                continue;
+            if (drop) {
+                ff_packet_list_free(&as->queue, &as->queue_end);
+                as->flush = 0;
+            }
+            if (as->busy || as->queue || as->flush)
+                idle = 0;
+        }
+        if (!idle)
+            pthread_cond_wait(&ac->done_cond, &ac->lock);
+    } while (!idle);
+    pthread_mutex_unlock(&ac->lock);
+}
+
+static void analyze_flush(AVFormatContext *ic, AnalyzeContext *ac)
+{
+    int i;
+
+    pthread_mutex_lock(&ac->lock);
+    for (i = 0; i < ac->nb_streams; i++) {
+        AnalyzeStream *as = ac->streams[i];
+        if (as && analyze_need_decoding(ic->streams[i], as->codec))
+            as->flush = 1;
+    }
+    pthread_cond_broadcast(&ac->work_cond);
+    pthread_mutex_unlock(&ac->lock);
+
+    analyze_wait(ac, 0);
+    analyze_update(ic, ac);
+}
+
+static void analyze_stream_free(AnalyzeStream **pas)
+{
+    AnalyzeStream *as = *pas;
+
+    if (!as)
+        return;
+    avcodec_free_context(&as->dec);
+    avcodec_parameters_free(&as->par);
+    ff_packet_list_free(&as->queue, &as->queue_end);
+    av_freep(pas);
+}
+
+/**
+ * Open the decoder of a stream, like try_decode_frame() does.
+ *
+ * @return the stream state, or NULL if the stream cannot be decoded
+ */
+static AnalyzeStream *analyze_open(AVFormatContext *ic, AnalyzeContext *ac,
+                                   AVStream *st, AVDictionary **options)
+{
+    AVCodecContext *avctx   = st->internal->avctx;
+    AVDictionary *thread_opt = NULL;
+    AnalyzeStream *as;
+    int ret;
+
+    if (st->index < ac->nb_streams && ac->streams[st->index])
+        return ac->streams[st->index];
+    if (st->info->found_decoder < 0 && st->codecpar->codec_id &&
+        st->codecpar->codec_id == -st->info->found_decoder)
+        return NULL;
+
+    as = av_mallocz(sizeof(*as));
+    if (!as)
+        return NULL;
+
+    as->codec = find_probe_decoder(ic, st, st->codecpar->codec_id);
+    if (!as->codec) {
+        st->info->found_decoder = -st->codecpar->codec_id;
+        goto fail;
+    }
+
+    as->par = avcodec_parameters_alloc();
+    as->dec = avcodec_alloc_context3(NULL);
+    if (!as->par || !as->dec ||
+        avcodec_parameters_from_context(as->par, avctx) < 0 ||
+        avcodec_parameters_to_context(as->dec, as->par) < 0)
+        goto fail;
+    as->dec->time_base       = avctx->time_base;
+    as->dec->framerate       = avctx->framerate;
+    as->dec->ticks_per_frame = avctx->ticks_per_frame;
+    as->dec->pkt_timebase    = avctx->pkt_timebase;
+
+    /* Force thread count to 1 since the H.264 decoder will not extract
+     * SPS and PPS to extradata during multi-threaded decoding. */
+    av_dict_set(options ? options : &thread_opt, "threads", "1", 0);
+    if (ic->codec_whitelist)
+        av_dict_set(options ? options : &thread_opt, "codec_whitelist", ic->codec_whitelist, 0);
+    ret = avcodec_open2(as->dec, as->codec, options ? options : &thread_opt);
+    av_dict_free(&thread_opt);
+    if (ret < 0) {
+        st->info->found_decoder = -as->dec->codec_id;
+        goto fail;
+    }
+    if (avpriv_codec_get_cap_skip_frame_fill_param(as->codec))
+        as->dec->skip_frame = AVDISCARD_ALL;
+
+    pthread_mutex_lock(&ac->lock);
+    if (st->index >= ac->nb_streams) {
+        AnalyzeStream **streams = av_realloc_array(ac->streams, ic->nb_streams,
+                                                   sizeof(*streams));
+        if (!streams) {
+            pthread_mutex_unlock(&ac->lock);
+            goto fail;
+        }
+        memset(streams + ac->nb_streams, 0,
+               (ic->nb_streams - ac->nb_streams) * sizeof(*streams));
+        ac->streams    = streams;
+        ac->nb_streams = ic->nb_streams;
+    }
+    ac->streams[st->index] = as;
+    /* parameters set by opening the decoder */
+    analyze_publish(as);
+    pthread_mutex_unlock(&ac->lock);
+
+    st->info->found_decoder = 1;
+    return as;
+
+fail:
+    analyze_stream_free(&as);
+    return NULL;
+}
+
+/**
+ * Queue a packet for the decoder of a stream if it still needs decoding.
+ */
+static int analyze_send_packet(AVFormatContext *ic, AnalyzeContext *ac,
+                               AVStream *st, const AVPacket *pkt,
+                               AVDictionary **options)
+{
+    AnalyzeStream *as = analyze_open(ic, ac, st, options);
+    AVPacket ref;
+    int ret;
+
+    if (!as || !analyze_need_decoding(st, as->codec))
+        return 0;
+
+    ret = av_packet_ref(&ref, pkt);
+    if (ret < 0)
+        return ret;
+
+    pthread_mutex_lock(&ac->lock);
+    ret = ff_packet_list_put(&as->queue, &as->queue_end, &ref, 0);
+    pthread_cond_signal(&ac->work_cond);
+    pthread_mutex_unlock(&ac->lock);
+
+    if (ret < 0)
+        av_packet_unref(&ref);
+    return ret;
+}
+
+static void analyze_uninit(AnalyzeContext **pac)
+{
+    AnalyzeContext *ac = *pac;
+    int i;
+
+    if (!ac)
+        return;
+
+    pthread_mutex_lock(&ac->lock);
+    ac->exit = 1;
+    pthread_cond_broadcast(&ac->work_cond);
+    pthread_mutex_unlock(&ac->lock);
+    for (i = 0; i < ac->nb_threads; i++)
+        pthread_join(ac->threads[i], NULL);
+
+    for (i = 0; i < ac->nb_streams; i++)
+        analyze_stream_free(&ac->streams[i]);
+    av_freep(&ac->streams);
+    av_freep(&ac->threads);
+    pthread_cond_destroy(&ac->done_cond);
+    pthread_cond_destroy(&ac->work_cond);
+    pthread_mutex_destroy(&ac->lock);
+    av_freep(pac);
+}
+
+static int analyze_init(AVFormatContext *ic, AnalyzeContext **pac)
+{
+    AnalyzeContext *ac = av_mallocz(sizeof(*ac));
+    int ret;
+
+    if (!ac)
+        return AVERROR(ENOMEM);
+    ac->threads = av_malloc_array(ic->analyze_threads, sizeof(*ac->threads));
+    if (!ac->threads) {
+        av_free(ac);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = pthread_mutex_init(&ac->lock, NULL))) {
+        av_free(ac->threads);
+        av_free(ac);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&ac->work_cond, NULL))) {
+        pthread_mutex_destroy(&ac->lock);
+        av_free(ac->threads);
+        av_free(ac);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&ac->done_cond, NULL))) {
+        pthread_cond_destroy(&ac->work_cond);
+        pthread_mutex_destroy(&ac->lock);
+        av_free(ac->threads);
+        av_free(ac);
+        return AVERROR(ret);
+    }
+
+    for (; ac->nb_threads < ic->analyze_threads; ac->nb_threads++) {
+        ret = pthread_create(&ac->threads[ac->nb_threads], NULL, analyze_worker, ac);
+        if (ret) {
+            ret = AVERROR(ret);
+            break;
+        }
+    }
+    *pac = ac;
+    if (!ac->nb_threads) {
+        analyze_uninit(pac);
+        return ret;
+    }
+
+    return 0;
+}
+#endif
+
 unsigned int ff_codec_get_tag(const AVCodecTag *tags, enum AVCodecID id)
 {
     while (tags->id != AV_CODEC_ID_NONE) {
@@ -3627,8 +4206,21 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t max_stream_analyze_duration;
     int64_t max_subtitle_analyze_duration;
     int64_t probesize = ic->probesize;
+    int64_t analyze_start = av_gettime_relative();
+    int analyze_time_reached = 0;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+#if HAVE_THREADS
+    AnalyzeContext *ac = NULL;
+
+    if (ic->analyze_threads > 0) {
+        ret = analyze_init(ic, &ac);
+        if (ret < 0)
+            av_log(ic, AV_LOG_WARNING, "Could not start the analysis threads: %s\n",
+                   av_err2str(ret));
+        ret = 0;
+    }
+#endif
 
     flush_codecs = probesize > 0;
 
@@ -3718,6 +4310,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         // Try to just open decoders, in case this is enough to get parameters.
         if (!has_codec_parameters(st, NULL) && st->request_probe <= 0) {
+#if HAVE_THREADS
+            if (ac && analyze_stream_type(st))
+                analyze_open(ic, ac, st, options ? &options[i] : NULL);
+            else
+#endif
             if (codec && !avctx->codec)
                 if (avcodec_open2(avctx, codec, options ? &options[i] : &thread_opt) < 0)
                     av_log(ic, AV_LOG_WARNING,
@@ -3745,14 +4342,26 @@ FF_ENABLE_DEPRECATION_WARNINGS
             break;
         }
 
+#if HAVE_THREADS
+        if (ac)
+            analyze_update(ic, ac);
+#endif
+
         /* check if one codec still needs to be handled */
         for (i = 0; i < ic->nb_streams; i++) {
             int fps_analyze_framecount = 20;
             int count;
 
             st = ic->streams[i];
-            if (!has_codec_parameters(st, NULL))
+            if (!has_codec_parameters(st, NULL)) {
+#if HAVE_THREADS
+                /* Decode what was already read for the stream before
+                 * reading more, so that the analysis stops at the same
+                 * packet as without threads. */
+                if (!analyze_wait_stream(ic, ac, i) || !has_codec_parameters(st, NULL))
+#endif
                 break;
+            }
             /* If the timebase is coarse (like the usual millisecond precision
              * of mkv), we need to analyze more frames to reliably arrive at
              * the correct fps. */
@@ -3819,6 +4428,17 @@ FF_ENABLE_DEPRECATION_WARNINGS
             break;
         }
 
+        /* We did not get all the codec info, but we spent too much time. */
+        if (ic->max_analyze_time &&
+            av_gettime_relative() - analyze_start >= ic->max_analyze_time) {
+            ret = count;
+            analyze_time_reached = 1;
+            av_log(ic, AV_LOG_DEBUG,
+                   "Analysis time limit of %"PRId64" microseconds reached\n",
+                   ic->max_analyze_time);
+            break;
+        }
+
         /* NOTE: A new stream can be added there if no header in file
          * (AVFMTCTX_NOHEADER). */
         ret = read_frame_internal(ic, &pkt1);
@@ -3951,6 +4571,14 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
+#if HAVE_THREADS
+        if (ac && analyze_stream_type(st)) {
+            ret = analyze_send_packet(ic, ac, st, pkt,
+                                      (options && i < orig_nb_streams) ? &options[i] : NULL);
+            if (ret < 0)
+                goto unref_then_goto_end;
+        } else
+#endif
         try_decode_frame(ic, st, pkt,
                          (options && i < orig_nb_streams) ? &options[i] : NULL);
 
@@ -3961,6 +4589,17 @@ FF_ENABLE_DEPRECATION_WARNINGS
         count++;
     }
 
+#if HAVE_THREADS
+    if (ac) {
+        /* Past the time limit, do not wait for the queued packets. */
+        analyze_wait(ac, analyze_time_reached || ret == AVERROR_EXIT);
+        if (flush_codecs)
+            analyze_flush(ic, ac);
+        else
+            analyze_update(ic, ac);
+    }
+#endif
+
     if (eof_reached) {
         int stream_index;
         for (stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
@@ -3996,6 +4635,12 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
             st = ic->streams[i];
 
+#if HAVE_THREADS
+            /* flushed above */
+            if (analyze_has_stream(ac, i))
+                continue;
+#endif
+
             /* flush the decoders */
             if (st->info->found_decoder == 1) {
                 do {
@@ -4127,13 +4772,16 @@ FF_ENABLE_DEPRECATION_WARNINGS
             if (ret < 0)
                 goto find_stream_info_err;
         }
-        if (!has_codec_parameters(st, &errmsg)) {
+        st->internal->missing_params = missing_codec_parameters(st, &errmsg);
+        if (st->internal->missing_params) {
             char buf[256];
             avcodec_string(buf, sizeof(buf), st->internal->avctx, 0);
             av_log(ic, AV_LOG_WARNING,
                    "Could not find codec parameters for stream %d (%s): %s\n"
-                   "Consider increasing the value for the 'analyzeduration' and 'probesize' options\n",
-                   i, buf, errmsg);
+                   "Consider increasing the value for the %s\n",
+                   i, buf, errmsg,
+                   analyze_time_reached ? "'max_analyze_time' option" :
+                                          "'analyzeduration' and 'probesize' options");
         } else {
             ret = 0;
         }
@@ -4205,6 +4853,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
 find_stream_info_err:
+#if HAVE_THREADS
+    analyze_uninit(&ac);
+#endif
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (st->info)
@@ -4412,6 +5063,7 @@ static void free_stream(AVStream **pst)
         av_freep(&st->internal->priv_pts);
         av_bsf_free(&st->internal->extract_extradata.bsf);
         av_packet_free(&st->internal->extract_extradata.pkt);
+        ff_compact_index_free(&st->internal->compact_index);
     }
     av_freep(&st->internal);
 
@@ -4564,6 +5216,12 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (!st->internal->avctx)
         goto fail;
 
+    if (s->internal->compact_index) {
+        st->internal->compact_index = ff_compact_index_alloc();
+        if (!st->internal->compact_index)
+            goto fail;
+    }
+
     if (s->iformat) {
 #if FF_API_LAVF_AVCTX
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -215,6 +215,15 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
     return 0;
 }
 
+static void pool_init_cache(AVBufferPool *pool)
+{
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i], 0);
+    pool->nb_cache = BUFFER_POOL_CACHE_SIZE;
+}
+
 AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
                                    AVBufferRef* (*alloc)(void *opaque, int size),
                                    void (*pool_free)(void *opaque))
@@ -224,6 +233,7 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    pool_init_cache(pool);
 
     pool->size      = size;
     pool->opaque    = opaque;
@@ -243,6 +253,7 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    pool_init_cache(pool);
 
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
@@ -258,6 +269,16 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        BufferPoolEntry *buf = (BufferPoolEntry *)atomic_load(&pool->cache[i]);
+        if (buf) {
+            buf->free(buf->opaque, buf->data);
+            av_free(buf);
+        }
+    }
+
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -286,6 +307,43 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
+/* return an unused entry to the pool, preferably into a free cache slot */
+static void pool_put_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    int i;
+
+    for (i = 0; i < pool->nb_cache; i++) {
+        uintptr_t expected = 0;
+        if (atomic_compare_exchange_strong_explicit(&pool->cache[i], &expected,
+                                                    (uintptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed))
+            return;
+    }
+
+    ff_mutex_lock(&pool->mutex);
+    buf->next = pool->pool;
+    pool->pool = buf;
+    ff_mutex_unlock(&pool->mutex);
+}
+
+/* take an unused entry from the cache slots, NULL if they are all empty */
+static BufferPoolEntry *pool_get_cached_entry(AVBufferPool *pool)
+{
+    int i;
+
+    for (i = 0; i < pool->nb_cache; i++) {
+        uintptr_t buf;
+
+        if (!atomic_load_explicit(&pool->cache[i], memory_order_relaxed))
+            continue;
+        buf = atomic_exchange_explicit(&pool->cache[i], 0, memory_order_acquire);
+        if (buf)
+            return (BufferPoolEntry *)buf;
+    }
+    return NULL;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -294,10 +352,7 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    pool_put_entry(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -339,6 +394,18 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
+    buf = pool_get_cached_entry(pool);
+    if (buf) {
+        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
+                               buf, 0);
+        if (!ret) {
+            pool_put_entry(pool, buf);
+            return NULL;
+        }
+        atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+        return ret;
+    }
+
     ff_mutex_lock(&pool->mutex);
     buf = pool->pool;
     if (buf) {
@@ -60,6 +60,12 @@ struct AVBuffer {
     int flags_internal;
 };
 
+/**
+ * Number of lock-free cache slots in front of the mutex-protected free list
+ * of an AVBufferPool.
+ */
+#define BUFFER_POOL_CACHE_SIZE 16
+
 typedef struct BufferPoolEntry {
     uint8_t *data;
 
@@ -78,6 +84,16 @@ struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Free entries are first put into and taken from these slots, each
+     * holding either 0 or a BufferPoolEntry pointer. A slot is only ever
+     * claimed as a whole with an atomic exchange/compare-exchange, so the
+     * fast path is lock-free and not subject to ABA. The mutex protected
+     * list above is only used when all slots are empty resp. full.
+     */
+    atomic_uintptr_t cache[BUFFER_POOL_CACHE_SIZE];
+    int nb_cache;   ///< number of slots in use, 0 disables the cache
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
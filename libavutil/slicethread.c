@@ -24,6 +24,45 @@
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
 
+/*
+ * Participation of the process-wide pool in one execution of a shared slice
+ * threading context. Each participation taken by a pool thread is one call of
+ * run_jobs(), those left when the caller is done with its own share are run by
+ * the caller itself.
+ */
+typedef struct SharedTask {
+    AVSliceThread     *ctx;
+    int               pending;
+    int               queue;
+    struct SharedTask *next;
+} SharedTask;
+
+typedef struct SharedQueue {
+    SharedTask      *head;
+    SharedTask      *tail;
+} SharedQueue;
+
+/*
+ * Pool of threads shared by all the shared slice threading contexts of the
+ * process. Every thread has its own queue of tasks, executions are spread over
+ * the queues round-robin and an idle thread takes work from the queues of the
+ * others once its own one is empty.
+ */
+typedef struct SharedPool {
+    pthread_mutex_t init_mutex;     ///< serializes pool creation and destruction
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    pthread_t       *threads;
+    SharedQueue     *queues;
+    int             nb_threads;
+    int             next_queue;
+    int             nb_users;
+    int             finished;
+} SharedPool;
+
+static SharedPool shared_pool;
+static AVOnce shared_pool_once = AV_ONCE_INIT;
+
 typedef struct WorkerContext {
     AVSliceThread   *ctx;
     pthread_mutex_t mutex;
@@ -48,6 +87,9 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    int             shared;
+    SharedTask      task;
 };
 
 static int run_jobs(AVSliceThread *ctx)
@@ -64,6 +106,208 @@ static int run_jobs(AVSliceThread *ctx)
     return current_job == nb_jobs + nb_active_threads - 1;
 }
 
+static void signal_done(AVSliceThread *ctx)
+{
+    pthread_mutex_lock(&ctx->done_mutex);
+    ctx->done = 1;
+    pthread_cond_signal(&ctx->done_cond);
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+static void wait_done(AVSliceThread *ctx)
+{
+    pthread_mutex_lock(&ctx->done_mutex);
+    while (!ctx->done)
+        pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
+    ctx->done = 0;
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+static void shared_pool_init(void)
+{
+    pthread_mutex_init(&shared_pool.init_mutex, NULL);
+    pthread_mutex_init(&shared_pool.mutex, NULL);
+    pthread_cond_init(&shared_pool.cond, NULL);
+}
+
+/* Must be called with the pool mutex held. */
+static void shared_queue_remove(SharedPool *pool, SharedTask *task)
+{
+    SharedQueue *q = &pool->queues[task->queue];
+    SharedTask **p = &q->head, *prev = NULL;
+
+    while (*p != task) {
+        prev = *p;
+        p    = &(*p)->next;
+    }
+    *p = task->next;
+    if (q->tail == task)
+        q->tail = prev;
+    task->next = NULL;
+}
+
+/* Must be called with the pool mutex held. */
+static SharedTask *shared_pool_take(SharedPool *pool, int idx)
+{
+    int i;
+
+    for (i = 0; i < pool->nb_threads; i++) {
+        SharedQueue *q = &pool->queues[(idx + i) % pool->nb_threads];
+        SharedTask *task = q->head;
+
+        if (task) {
+            if (!--task->pending)
+                shared_queue_remove(pool, task);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void *attribute_align_arg shared_worker(void *v)
+{
+    SharedPool *pool = &shared_pool;
+    int idx = (intptr_t)v;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->finished) {
+        SharedTask *task = shared_pool_take(pool, idx);
+        AVSliceThread *ctx;
+
+        if (!task) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            continue;
+        }
+        ctx = task->ctx;
+        pthread_mutex_unlock(&pool->mutex);
+
+        /* the context may be freed as soon as it is signalled */
+        if (run_jobs(ctx))
+            signal_done(ctx);
+
+        pthread_mutex_lock(&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static void shared_pool_stop(SharedPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    av_freep(&pool->threads);
+    av_freep(&pool->queues);
+    pool->nb_threads = 0;
+    pool->next_queue = 0;
+    pool->finished   = 0;
+}
+
+static int shared_pool_ref(void)
+{
+    SharedPool *pool = &shared_pool;
+    int ret = 0;
+
+    ff_thread_once(&shared_pool_once, shared_pool_init);
+
+    pthread_mutex_lock(&pool->init_mutex);
+    if (!pool->nb_users) {
+        int i, nb_threads = av_cpu_count();
+
+        pool->threads = av_calloc(nb_threads, sizeof(*pool->threads));
+        pool->queues  = av_calloc(nb_threads, sizeof(*pool->queues));
+        if (!pool->threads || !pool->queues) {
+            av_freep(&pool->threads);
+            av_freep(&pool->queues);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        for (i = 0; i < nb_threads; i++) {
+            if ((ret = pthread_create(&pool->threads[i], NULL, shared_worker,
+                                      (void *)(intptr_t)i))) {
+                ret = AVERROR(ret);
+                break;
+            }
+            pool->nb_threads++;
+        }
+        if (!pool->nb_threads) {
+            av_freep(&pool->threads);
+            av_freep(&pool->queues);
+            goto end;
+        }
+        ret = 0;
+    }
+    pool->nb_users++;
+
+end:
+    pthread_mutex_unlock(&pool->init_mutex);
+    return ret;
+}
+
+static void shared_pool_unref(void)
+{
+    SharedPool *pool = &shared_pool;
+
+    pthread_mutex_lock(&pool->init_mutex);
+    if (!--pool->nb_users)
+        shared_pool_stop(pool);
+    pthread_mutex_unlock(&pool->init_mutex);
+}
+
+static void shared_execute(AVSliceThread *ctx, int nb_workers)
+{
+    SharedPool *pool = &shared_pool;
+    SharedTask *task = &ctx->task;
+    int is_last, nb_left = 0;
+
+    if (nb_workers) {
+        SharedQueue *q;
+
+        pthread_mutex_lock(&pool->mutex);
+        task->pending = nb_workers;
+        task->queue   = pool->next_queue;
+        pool->next_queue = (pool->next_queue + 1) % pool->nb_threads;
+        q = &pool->queues[task->queue];
+        if (q->tail)
+            q->tail->next = task;
+        else
+            q->head = task;
+        q->tail = task;
+        if (nb_workers > 1)
+            pthread_cond_broadcast(&pool->cond);
+        else
+            pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    is_last = run_jobs(ctx);
+
+    /* take back the participations no pool thread got to, rather than wait
+     * for busy threads; this also keeps nested executions from deadlocking */
+    if (nb_workers) {
+        pthread_mutex_lock(&pool->mutex);
+        nb_left = task->pending;
+        if (nb_left) {
+            shared_queue_remove(pool, task);
+            task->pending = 0;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    while (nb_left--)
+        is_last |= run_jobs(ctx);
+
+    if (!is_last)
+        wait_done(ctx);
+}
+
 static void *attribute_align_arg thread_worker(void *v)
 {
     WorkerContext *w = v;
@@ -82,22 +326,18 @@ static void *attribute_align_arg thread_worker(void *v)
             return NULL;
         }
 
-        if (run_jobs(ctx)) {
-            pthread_mutex_lock(&ctx->done_mutex);
-            ctx->done = 1;
-            pthread_cond_signal(&ctx->done_cond);
-            pthread_mutex_unlock(&ctx->done_mutex);
-        }
+        if (run_jobs(ctx))
+            signal_done(ctx);
     }
 }
 
-int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+static int slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
-                              int nb_threads)
+                              int nb_threads, int shared)
 {
     AVSliceThread *ctx;
-    int nb_workers, i;
+    int nb_workers, i, ret;
 
     av_assert0(nb_threads >= 0);
     if (!nb_threads) {
@@ -112,9 +352,20 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     if (!main_func)
         nb_workers--;
 
+    if (shared && (ret = shared_pool_ref()) < 0)
+        return ret;
+
     *pctx = ctx = av_mallocz(sizeof(*ctx));
-    if (!ctx)
+    if (!ctx) {
+        if (shared)
+            shared_pool_unref();
         return AVERROR(ENOMEM);
+    }
+
+    ctx->shared   = shared;
+    ctx->task.ctx = ctx;
+    if (shared)
+        nb_workers = 0;
 
     if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers)))) {
         av_freep(pctx);
@@ -137,7 +388,6 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
 
     for (i = 0; i < nb_workers; i++) {
         WorkerContext *w = &ctx->workers[i];
-        int ret;
         w->ctx = ctx;
         pthread_mutex_init(&w->mutex, NULL);
         pthread_cond_init(&w->cond, NULL);
@@ -161,6 +411,21 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return nb_threads;
 }
 
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                              void (*main_func)(void *priv),
+                              int nb_threads)
+{
+    return slicethread_create(pctx, priv, worker_func, main_func, nb_threads, 0);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    return slicethread_create(pctx, priv, worker_func, NULL, nb_threads, 1);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     int nb_workers, i, is_last = 0;
@@ -174,6 +439,11 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     if (!ctx->main_func || !execute_main)
         nb_workers--;
 
+    if (ctx->shared) {
+        shared_execute(ctx, nb_workers);
+        return;
+    }
+
     for (i = 0; i < nb_workers; i++) {
         WorkerContext *w = &ctx->workers[i];
         pthread_mutex_lock(&w->mutex);
@@ -187,13 +457,8 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     else
         is_last = run_jobs(ctx);
 
-    if (!is_last) {
-        pthread_mutex_lock(&ctx->done_mutex);
-        while (!ctx->done)
-            pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
-        ctx->done = 0;
-        pthread_mutex_unlock(&ctx->done_mutex);
-    }
+    if (!is_last)
+        wait_done(ctx);
 }
 
 void avpriv_slicethread_free(AVSliceThread **pctx)
@@ -208,6 +473,10 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
+    if (ctx->shared) {
+        nb_workers = 0;
+        shared_pool_unref();
+    }
 
     ctx->finished = 1;
     for (i = 0; i < nb_workers; i++) {
@@ -242,6 +511,14 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(EINVAL);
 }
 
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(EINVAL);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
@@ -0,0 +1,131 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program hammers an AVBufferPool from several threads and checks
+ * that no buffer is ever handed out twice at the same time.
+ *
+ * Run with "bench" as argument, it instead reports the time taken with and
+ * without the lock-free cache of the pool.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/buffer_internal.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define NB_THREADS  4
+#define NB_BUFFERS  4
+#define BUFFER_SIZE 64
+
+typedef struct ThreadContext {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadContext;
+
+static void *thread_main(void *arg)
+{
+    ThreadContext *t = arg;
+    AVBufferRef *bufs[NB_BUFFERS];
+    int i, j;
+
+    for (i = 0; i < t->iterations; i++) {
+        for (j = 0; j < NB_BUFFERS; j++) {
+            bufs[j] = av_buffer_pool_get(t->pool);
+            if (!bufs[j]) {
+                t->errors++;
+                continue;
+            }
+            memset(bufs[j]->data, t->id * NB_BUFFERS + j, BUFFER_SIZE);
+        }
+        for (j = 0; j < NB_BUFFERS; j++) {
+            int k;
+
+            if (!bufs[j])
+                continue;
+            for (k = 0; k < BUFFER_SIZE; k++) {
+                if (bufs[j]->data[k] != t->id * NB_BUFFERS + j) {
+                    t->errors++;
+                    break;
+                }
+            }
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+    return NULL;
+}
+
+static int run(int nb_cache, int iterations, int64_t *elapsed)
+{
+    ThreadContext t[NB_THREADS];
+    pthread_t threads[NB_THREADS];
+    AVBufferPool *pool;
+    int64_t start;
+    int i, ret, errors = 0;
+
+    pool = av_buffer_pool_init(BUFFER_SIZE, NULL);
+    if (!pool)
+        return -1;
+    pool->nb_cache = nb_cache;
+
+    start = av_gettime_relative();
+    for (i = 0; i < NB_THREADS; i++) {
+        t[i].pool       = pool;
+        t[i].id         = i;
+        t[i].iterations = iterations;
+        t[i].errors     = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &t[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return -1;
+        }
+    }
+    for (i = 0; i < NB_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += t[i].errors;
+    }
+    *elapsed = av_gettime_relative() - start;
+
+    av_buffer_pool_uninit(&pool);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = argc > 1 && !strcmp(argv[1], "bench");
+    int iterations = bench ? 1000000 : 10000;
+    int64_t elapsed;
+
+    if (run(BUFFER_POOL_CACHE_SIZE, iterations, &elapsed))
+        return 1;
+    if (bench)
+        printf("lock-free cache: %8.1f ns per get/release\n",
+               elapsed * 1000.0 / (iterations * NB_BUFFERS * NB_THREADS));
+
+    if (run(0, iterations, &elapsed))
+        return 1;
+    if (bench)
+        printf("mutex only:      %8.1f ns per get/release\n",
+               elapsed * 1000.0 / (iterations * NB_BUFFERS * NB_THREADS));
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program runs several slice threading contexts sharing the
+ * process-wide pool from several threads at once, some of them nesting
+ * executions inside their jobs, and checks that every job runs exactly once.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+
+#define NB_CONTEXTS   4
+#define NB_THREADS    3
+#define NB_JOBS       37
+#define NB_NESTED     5
+#define NB_ITERATIONS 200
+
+typedef struct TestContext {
+    AVSliceThread *thread;
+    int nb_threads;
+    int nested;
+    int count[NB_JOBS];
+    int nested_count[NB_JOBS][NB_NESTED];
+    int errors[NB_JOBS];
+} TestContext;
+
+typedef struct NestedContext {
+    TestContext *t;
+    int jobnr;
+} NestedContext;
+
+static void nested_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    NestedContext *n = priv;
+    n->t->nested_count[n->jobnr][jobnr]++;
+}
+
+static void worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    TestContext *t = priv;
+
+    if (threadnr < 0 || threadnr >= t->nb_threads || nb_jobs != NB_JOBS)
+        t->errors[jobnr]++;
+    t->count[jobnr]++;
+
+    if (t->nested) {
+        NestedContext n = { t, jobnr };
+        AVSliceThread *nested;
+
+        if (avpriv_slicethread_create_shared(&nested, &n, nested_worker, NB_THREADS) < 0) {
+            t->errors[jobnr]++;
+            return;
+        }
+        avpriv_slicethread_execute(nested, NB_NESTED, 0);
+        avpriv_slicethread_free(&nested);
+    }
+}
+
+static void *thread_main(void *arg)
+{
+    TestContext *t = arg;
+    int i, j, k;
+
+    for (i = 0; i < NB_ITERATIONS; i++) {
+        /* every tenth execution starts executions from within its jobs */
+        t->nested = !(i % 10);
+        memset(t->count, 0, sizeof(t->count));
+        memset(t->nested_count, 0, sizeof(t->nested_count));
+        avpriv_slicethread_execute(t->thread, NB_JOBS, 0);
+        for (j = 0; j < NB_JOBS; j++) {
+            if (t->count[j] != 1)
+                t->errors[j]++;
+            for (k = 0; k < NB_NESTED; k++)
+                if (t->nested_count[j][k] != t->nested)
+                    t->errors[j]++;
+        }
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    TestContext t[NB_CONTEXTS] = { { 0 } };
+    pthread_t threads[NB_CONTEXTS];
+    int i, j, ret, errors = 0;
+
+    for (i = 0; i < NB_CONTEXTS; i++) {
+        ret = avpriv_slicethread_create_shared(&t[i].thread, &t[i], worker, NB_THREADS);
+        if (ret < 0) {
+            fprintf(stderr, "Failed to create shared slice threading context\n");
+            return 1;
+        }
+        t[i].nb_threads = ret;
+    }
+
+    for (i = 0; i < NB_CONTEXTS; i++) {
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &t[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (i = 0; i < NB_CONTEXTS; i++) {
+        pthread_join(threads[i], NULL);
+        for (j = 0; j < NB_JOBS; j++)
+            errors += t[i].errors[j];
+        avpriv_slicethread_free(&t[i].thread);
+    }
+
+    if (errors)
+        fprintf(stderr, "%d errors\n", errors);
+    return !!errors;
+}
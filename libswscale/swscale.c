@@ -234,9 +234,14 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+/**
+ * Scale the given source slice and output as many destination lines of
+ * [dstSliceY, dstSliceY + dstSliceH) as possible.
+ */
+static int swscale_dst_slice(SwsContext *c, const uint8_t *src[],
+                             int srcStride[], int srcSliceY, int srcSliceH,
+                             uint8_t *dst[], int dstStride[],
+                             int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
@@ -334,7 +339,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
      * will not get executed. This is not really intended but works
      * currently, so people might do it. */
     if (srcSliceY == 0) {
-        dstY         = 0;
+        dstY         = dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -366,7 +371,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceY + dstSliceH; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -523,6 +528,66 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_dst_slice(c, src, srcStride, srcSliceY, srcSliceH,
+                             dst, dstStride, 0, c->dstH);
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext      *c = parent->slice_ctx[jobnr];
+    const int align    = 1 << parent->chrDstVSubSample;
+    const int slice_h  = FFALIGN((parent->dstH + nb_jobs - 1) / nb_jobs, align);
+    const int slice_y  = jobnr * slice_h;
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    if (slice_y >= parent->dstH)
+        return;
+
+    /* swscale() modifies the pointer and stride arrays it is given */
+    memcpy(src,       parent->slice_src,        sizeof(src));
+    memcpy(srcStride, parent->slice_src_stride, sizeof(srcStride));
+    memcpy(dst,       parent->slice_dst,        sizeof(dst));
+    memcpy(dstStride, parent->slice_dst_stride, sizeof(dstStride));
+
+    swscale_dst_slice(c, src, srcStride, 0, parent->srcH, dst, dstStride,
+                      slice_y, FFMIN(slice_h, parent->dstH - slice_y));
+}
+
+/**
+ * Scale a complete frame, splitting the destination into one band per
+ * slice context.
+ */
+static int scale_threaded(SwsContext *c, const uint8_t *src[], int srcStride[],
+                          uint8_t *dst[], int dstStride[])
+{
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (usePal(c->srcFormat)) {
+            memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+            memcpy(c->slice_ctx[i]->pal_rgb, c->pal_rgb, sizeof(c->pal_rgb));
+        }
+    }
+
+    memcpy(c->slice_src,        src,       sizeof(c->slice_src));
+    memcpy(c->slice_src_stride, srcStride, sizeof(c->slice_src_stride));
+    memcpy(c->slice_dst,        dst,       sizeof(c->slice_dst));
+    memcpy(c->slice_dst_stride, dstStride, sizeof(c->slice_dst_stride));
+
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+
+    c->dstY = c->dstH;
+    return c->dstH;
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -966,7 +1031,10 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (c->nb_slice_ctx && srcSliceY_internal == 0 && srcSliceH == c->srcH)
+        ret = scale_threaded(c, src2, srcStride2, dst2, dstStride2);
+    else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
         int dstY = c->dstY ? c->dstY : srcSliceY + srcSliceH;
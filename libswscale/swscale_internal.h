@@ -31,6 +31,7 @@
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/ppc/util_altivec.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
@@ -321,6 +322,19 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* When nb_threads != 1, complete frames are scaled by splitting the
+     * destination into horizontal bands, each one scaled by its own
+     * slice context on a worker of slicethread.
+     */
+    int nb_threads;
+    int nb_slice_ctx;
+    struct SwsContext **slice_ctx;
+    AVSliceThread *slicethread;
+    const uint8_t *slice_src[4];
+    int slice_src_stride[4];
+    uint8_t *slice_dst[4];
+    int slice_dst_stride[4];
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -862,6 +876,9 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
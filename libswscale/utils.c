@@ -867,6 +867,7 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -906,6 +907,10 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     c->dstFormatBpp = av_get_bits_per_pixel(desc_dst);
     c->srcFormatBpp = av_get_bits_per_pixel(desc_src);
 
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     if (c->cascaded_context[c->cascaded_mainindex])
         return sws_setColorspaceDetails(c->cascaded_context[c->cascaded_mainindex],inv_table, srcRange,table, dstRange, brightness,  contrast, saturation);
 
@@ -1167,8 +1172,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int sws_init_single_context(SwsContext *c, SwsFilter *srcFilter,
+                                          SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1871,6 +1876,80 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+static av_cold int context_init_threaded(SwsContext *c, SwsContext *opts,
+                                         SwsFilter *srcFilter, SwsFilter *dstFilter)
+{
+    int i, ret;
+
+    /* Only the generic scaler can produce arbitrary bands of the output,
+     * and error diffusion needs the lines to be processed in order. */
+    if (!c->desc || c->cascaded_context[0] || c->dither == SWS_DITHER_ED)
+        return 0;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, ff_sws_slice_worker,
+                                    NULL, c->nb_threads);
+    if (ret == AVERROR(ENOSYS))
+        return 0;
+    if (ret < 0)
+        return ret;
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz_array(ret, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < ret; i++) {
+        SwsContext *slice = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[c->nb_slice_ctx++] = slice;
+
+        if (av_opt_copy(slice, opts) < 0)
+            return AVERROR(ENOMEM);
+        slice->nb_threads = 1;
+
+        if (sws_init_single_context(slice, srcFilter, dstFilter) < 0)
+            return AVERROR(EINVAL);
+
+        sws_setColorspaceDetails(slice, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
+    }
+
+    if (c->flags & SWS_PRINT_INFO)
+        av_log(c, AV_LOG_INFO, "using %d slice threads\n", c->nb_slice_ctx);
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    SwsContext *opts = NULL;
+    int ret;
+
+    if (c->nb_threads != 1) {
+        /* keep the options as set by the caller, init modifies some of them */
+        opts = sws_alloc_context();
+        if (!opts)
+            return AVERROR(ENOMEM);
+        ret = av_opt_copy(opts, c);
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = sws_init_single_context(c, srcFilter, dstFilter);
+    if (ret >= 0 && opts)
+        ret = context_init_threaded(c, opts, srcFilter, dstFilter);
+
+end:
+    sws_freeContext(opts);
+    return ret;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2371,6 +2450,11 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->gamma);
     av_freep(&c->inv_gamma);
 
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+
     ff_free_filters(c);
 
     av_free(c);
@@ -188,6 +188,9 @@ static const struct {
 #if CONFIG_AVUTIL
         { "fixed_dsp", checkasm_check_fixed_dsp },
         { "float_dsp", checkasm_check_float_dsp },
+#if CONFIG_PIXELUTILS
+        { "pixelutils", checkasm_check_pixelutils },
+#endif
 #endif
     { NULL }
 };
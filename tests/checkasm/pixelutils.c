@@ -0,0 +1,72 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/pixelutils.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 32 + 8)
+
+static void check_sad(const uint8_t *src1, const uint8_t *src2, const char *report_name)
+{
+    static const char *const align_names[] = { "", "_aligned1", "_aligned2" };
+    int bits, aligned;
+
+    for (aligned = 0; aligned < FF_ARRAY_ELEMS(align_names); aligned++) {
+        /* misalign the sources that are not required to be aligned */
+        const int off1 = aligned >= 1 ? 0 : 1;
+        const int off2 = aligned == 2 ? 0 : 3;
+
+        for (bits = 1; bits <= 5; bits++) {
+            declare_func_emms(AV_CPU_FLAG_MMX, int, const uint8_t *src1, ptrdiff_t stride1,
+                              const uint8_t *src2, ptrdiff_t stride2);
+
+            if (check_func(av_pixelutils_get_sad_fn(bits, bits, aligned, NULL),
+                           "sad_%dx%d%s", 1 << bits, 1 << bits, align_names[aligned])) {
+                int ref = call_ref(src1 + off1, STRIDE, src2 + off2, STRIDE);
+                int new = call_new(src1 + off1, STRIDE, src2 + off2, STRIDE);
+                if (ref != new)
+                    fail();
+                bench_new(src1 + off1, STRIDE, src2 + off2, STRIDE);
+            }
+        }
+    }
+
+    report("%s", report_name);
+}
+
+void checkasm_check_pixelutils(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src2, [BUF_SIZE]);
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i++) {
+        src1[i] = rnd();
+        src2[i] = rnd();
+    }
+    check_sad(src1, src2, "sad");
+
+    /* largest possible differences, to catch overflowing accumulators */
+    memset(src1, 0x00, BUF_SIZE);
+    memset(src2, 0xff, BUF_SIZE);
+    check_sad(src1, src2, "sad_max");
+}
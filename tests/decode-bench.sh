@@ -0,0 +1,36 @@
+#! /bin/sh
+#
+# Print the decoding speed of a file with slice, frame and combined
+# frame+slice threading for several thread counts.
+#
+# usage: decode-bench.sh <ffmpeg> <input> <thread counts> [<slice threads>]
+
+ffmpeg=$1
+input=$2
+thread_counts=$3
+slice_threads=${4:-2}
+
+die(){
+    echo "$@" >&2
+    exit 1
+}
+
+test -n "$thread_counts" || die "usage: decode-bench.sh <ffmpeg> <input> <thread counts> [<slice threads>]"
+test -r "$input"         || die "$input: not found"
+
+bench(){
+    out=$($ffmpeg -nostdin -nostats -benchmark -progress pipe:1 \
+                  -threads $1 -thread_type $2 -slice_threads $3 \
+                  -i "$input" -an -f null - 2>&1) || die "$out"
+    frames=$(echo "$out" | sed -n 's/^frame=//p' | tail -n 1)
+    rtime=$(echo "$out" | sed -n 's/.*rtime=\([0-9.]*\)s.*/\1/p' | tail -n 1)
+    fps=$(echo "$frames $rtime" | awk '{ printf "%.1f", ($2 > 0 ? $1 / $2 : 0) }')
+    printf "%7s  %-11s  %13s  %6s  %8s  %8s\n" $1 $2 $3 $frames ${rtime}s $fps
+}
+
+printf "%7s  %-11s  %13s  %6s  %8s  %8s\n" threads type slice_threads frames time fps
+for n in $thread_counts; do
+    bench $n slice       1
+    bench $n frame       1
+    bench $n frame+slice $slice_threads
+done
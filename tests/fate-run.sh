@@ -487,6 +487,127 @@ concat(){
     fi
 }
 
+deshake_twopass(){
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$cleanfiles $logfile"
+
+    ffmpeg "$@" -vf deshake=filename=$(target_path $logfile) -f null -
+    framecrc "$@" -vf deshake=input=$(target_path $logfile)
+}
+
+mov_index_cache(){
+    file="${outdir}/${test}.mov"
+    cachedir="${outdir}/${test}.cache"
+    logfile="${outdir}/${test}.log"
+    framefile1="${outdir}/${test}.out-1"
+    framefile2="${outdir}/${test}.out-2"
+    cleanfiles="$cleanfiles $file $logfile $framefile1 $framefile2"
+
+    rm -rf $cachedir
+    mkdir -p $cachedir
+    ffmpeg "$@" -flags +bitexact -fflags +bitexact -y $(target_path $file) 2>/dev/null
+
+    open_cached(){
+        ffmpeg -v verbose -index_cache $(target_path $cachedir) -i $(target_path $file) -c copy -bitexact -f framecrc -y $(target_path $1) 2>$logfile
+        grep -o -e "Wrote index cache entry" -e "Using the index cache entry" -e "Ignoring invalid index cache entry" $logfile
+    }
+
+    # first open, writing the cache entry
+    open_cached $framefile1
+    cat $framefile1
+    # second open, using it
+    open_cached $framefile2
+    cmp -s $framefile1 $framefile2 && echo "same packets"
+    # truncated cache entry
+    for entry in $(ls $cachedir); do
+        head -c 100 $cachedir/$entry > $logfile && cp $logfile $cachedir/$entry
+    done
+    open_cached $framefile2
+    cmp -s $framefile1 $framefile2 && echo "same packets"
+    # modified input file
+    printf '\0\0\0\10free' >> $file
+    open_cached $framefile2
+    cmp -s $framefile1 $framefile2 && echo "same packets"
+
+    rm -rf $cachedir
+}
+
+loudnorm_analyze(){
+    src=$1
+    ref_filter=$2
+    filter=$3
+    logfile="${outdir}/${test}.log"
+    framefile1="${outdir}/${test}.out-1"
+    framefile2="${outdir}/${test}.out-2"
+    cleanfiles="$cleanfiles $logfile $framefile1 $framefile2"
+
+    ffmpeg -i $src -af $ref_filter -bitexact -f framecrc -y $(target_path $framefile1) 2>/dev/null
+    ffmpeg -i $src -af $filter -bitexact -f framecrc -y $(target_path $framefile2) 2>$logfile
+    cmp -s $framefile1 $framefile2 && echo "same audio"
+    sed -n '/^{/,/^}/p' $logfile
+}
+
+mux_thread(){
+    drop=$1
+    shift
+    reffile="${outdir}/${test}.ref.nut"
+    file="${outdir}/${test}.nut"
+    cleanfiles="$cleanfiles $reffile $file"
+
+    packets(){
+        run ffprobe${PROGSUF}${EXECSUF} -v error -show_data_hash crc32 \
+            -show_entries packet=stream_index,pts,flags,data_hash -of csv=p=0 $(target_path $1)
+    }
+
+    ffmpeg "$@" -f nut -y $(target_path $reffile) 2>/dev/null
+    # the reader stalls, so that the queue of the writer thread fills up
+    ffmpeg "$@" -mux_thread_queue_size 2 -mux_thread_drop $drop -f nut pipe:1 2>/dev/null |
+        { sleep 1; cat; } > $file
+    packets $reffile > $reffile.txt
+    packets $file > $file.txt
+    cleanfiles="$cleanfiles $reffile.txt $file.txt"
+
+    if [ $drop = none ]; then
+        cmp -s $reffile.txt $file.txt && echo "same packets"
+        return
+    fi
+    # every packet written is in the output without writer thread, and each
+    # stream resumes at a keyframe after a gap
+    awk -F, 'NR == FNR { idx[$0] = n[$1]++; next }
+             !($0 in idx) { unknown++; next }
+             idx[$0] != next_idx[$1] + 0 && $3 !~ /K/ { unkeyed++ }
+             { next_idx[$1] = idx[$0] + 1 }
+             END { printf "packets not in the reference: %d\n", unknown
+                   printf "resumed without keyframe: %d\n", unkeyed }' $reffile.txt $file.txt
+}
+
+filter_profile(){
+    # the times vary from run to run, only keep the counters
+    ffmpeg "$@" -filter_profile -f null - 2>&1 |
+        awk '/^Filtergraph #[0-9]+ profile:$/ { print; section = 1; next }
+             section && ($1 == "filter" || $1 == "link") { section = $1 == "link" ? 2 : 1; next }
+             section == 2 && $1 == "total" { section = 0; next }
+             section == 1 { name = $1; for (i = 2; i <= NF - 6; i++) name = name " " $i
+                            printf "%s (%s): activations:%s in:%s out:%s\n",
+                                   name, $(NF - 5), $(NF - 2), $(NF - 1), $NF }
+             section == 2 { name = $1; for (i = 2; i <= NF - 3; i++) name = name " " $i
+                            printf "%s: frames:%s\n", name, $(NF - 2) }'
+}
+
+find_stream_info_stall(){
+    src=$1
+    size=$2
+    shift 2
+    file="${outdir}/${test}.ts"
+    cleanfiles="$cleanfiles $file"
+
+    # all the video first, then the audio, and a stall in the middle of
+    # the video that is longer than the analysis time limit
+    ffmpeg -i $src -itsoffset 2 -i $src -map 0:v -map 1:a -c copy -f mpegts -y $(target_path $file) 2>/dev/null
+    { head -c $size $file; sleep 2; tail -c +$((size + 1)) $file; } |
+        run libavformat/tests/find_stream_info${EXECSUF} pipe:0 -max_analyze_time 1000000 "$@"
+}
+
 venc_data(){
     file=$1
     stream=$2
@@ -41,6 +41,35 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -idct simple -fflags +bitexact -flag
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+# encoding on the main thread and on encoder threads gives the same packets
+FATE_FFMPEG-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER MP2_ENCODER) += fate-ffmpeg-enc fate-ffmpeg-enc-thread
+fate-ffmpeg-enc: CMD = framecrc \
+  -f lavfi -i testsrc=s=176x144:d=2 -f lavfi -i sine=d=2 \
+  -c:v mpeg4 -bf 2 -c:a mp2 -flags +bitexact+psnr -fflags +bitexact
+fate-ffmpeg-enc-thread: CMD = framecrc \
+  -f lavfi -i testsrc=s=176x144:d=2 -f lavfi -i sine=d=2 \
+  -c:v mpeg4 -bf 2 -c:a mp2 -flags +bitexact+psnr -fflags +bitexact -enc_thread_queue_size 4
+fate-ffmpeg-enc-thread: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-enc
+
+FATE_FFMPEG-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER SCALE_FILTER \
+                           SPLIT_FILTER HSTACK_FILTER VOLUME_FILTER) += fate-ffmpeg-filter-profile
+fate-ffmpeg-filter-profile: CMD = filter_profile \
+  -f lavfi -i testsrc=s=320x240:d=1 -f lavfi -i sine=d=1 \
+  -filter_complex "[0:v]scale=160:120,split[a][b];[a][b]hstack[v];[1:a]volume=0.5[aout]" \
+  -map "[v]" -map "[aout]"
+
+# writer thread of an output whose reader stalls, blocking or dropping packets
+FATE_MUX_THREAD-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER \
+                               PCM_S16LE_ENCODER NUT_MUXER NUT_DEMUXER PIPE_PROTOCOL) += none new old
+FATE_MUX_THREAD = $(FATE_MUX_THREAD-yes:%=fate-ffmpeg-mux-thread-%)
+$(FATE_MUX_THREAD): CMD = mux_thread $(@:fate-ffmpeg-mux-thread-%=%) \
+  -f lavfi -i testsrc=s=320x240:d=4 -f lavfi -i sine=d=4 \
+  -c:v mpeg4 -g 10 -c:a pcm_s16le -flags +bitexact -fflags +bitexact
+ifeq ($(HAVE_THREADS),yes)
+FATE_FFMPEG_FFPROBE += $(FATE_MUX_THREAD)
+endif
+fate-ffmpeg-mux-thread: $(FATE_MUX_THREAD)
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
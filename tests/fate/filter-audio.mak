@@ -210,6 +210,11 @@ FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FIL
 fate-filter-hls: tests/data/hls-list.m3u8
 fate-filter-hls: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls-list.m3u8
 
+FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-filter-hls-prefetch
+fate-filter-hls-prefetch: tests/data/hls-list.m3u8
+fate-filter-hls-prefetch: CMD = framecrc -flags +bitexact -prefetch_segments 2 -i $(TARGET_PATH)/tests/data/hls-list.m3u8
+fate-filter-hls-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-hls
+
 tests/data/hls-list-append.m3u8: TAG = GEN
 tests/data/hls-list-append.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
@@ -300,6 +305,18 @@ fate-filter-join: CMD = md5 -i $(SRC1) -i $(SRC2) -filter_complex join=channel_l
 fate-filter-join: CMP = oneline
 fate-filter-join: REF = 88b0d24a64717ba8635b29e8dac6ecd8
 
+# analysis only: the audio must pass through untouched, at 192 kHz when
+# true_peak is enabled, and the measured stats are printed at the end
+FATE_LOUDNORM += fate-filter-loudnorm-analyze
+fate-filter-loudnorm-analyze: CMD = loudnorm_analyze $(SRC) anull loudnorm=analyze=1:print_format=json
+
+FATE_LOUDNORM += fate-filter-loudnorm-analyze-true-peak
+fate-filter-loudnorm-analyze-true-peak: CMD = loudnorm_analyze $(SRC) aresample=192000 loudnorm=analyze=1:true_peak=1:print_format=json
+
+$(FATE_LOUDNORM): tests/data/asynth-44100-2.wav
+$(FATE_LOUDNORM): SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, LOUDNORM ANULL ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, FRAMECRC) += $(FATE_LOUDNORM)
+
 FATE_AFILTER-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER PCM_S16LE_ENCODER PCM_S16LE_MUXER APERMS_FILTER VOLUME_FILTER) += fate-filter-volume
 fate-filter-volume: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
 fate-filter-volume: tests/data/asynth-44100-2.wav
@@ -122,10 +122,83 @@ FATE_FILTER-$(call ALLYES, FRAMERATE_FILTER TESTSRC2_FILTER FORMAT_FILTER) += fa
 fate-filter-framerate-12bit-up: CMD = framecrc -lavfi testsrc2=r=50:d=1,format=pix_fmts=yuv422p12le,framerate=fps=60 -t 1 -pix_fmt yuv422p12le
 fate-filter-framerate-12bit-down: CMD = framecrc -lavfi testsrc2=r=60:d=1,format=pix_fmts=yuv422p12le,framerate=fps=50 -t 1 -pix_fmt yuv422p12le
 
+# HDR to SDR on 10-bit YUV input, done in a single pass by tonemap
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SETPARAMS_FILTER TONEMAP_FILTER) += fate-filter-tonemap-yuv420p10-hable fate-filter-tonemap-yuv420p10-reinhard fate-filter-tonemap-p010-mobius
+fate-filter-tonemap-yuv420p10-hable: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=yuv420p10,setparams=color_trc=smpte2084:color_primaries=bt2020:colorspace=bt2020nc,tonemap=hable
+fate-filter-tonemap-yuv420p10-reinhard: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=yuv420p10,setparams=color_trc=smpte2084:color_primaries=bt2020:colorspace=bt2020nc,tonemap=reinhard:desat=0
+fate-filter-tonemap-p010-mobius: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=p010,setparams=color_trc=arib-std-b67:color_primaries=bt2020:colorspace=bt2020nc,tonemap=mobius:peak=4
+
+FATE_LUT3D += fate-filter-lut3d-rgb24-trilinear fate-filter-lut3d-rgb24-tetrahedral
+fate-filter-lut3d-rgb24-trilinear: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=rgb24,lut3d=file=$(TARGET_PATH)/tests/data/filtergraphs/lut3d.cube:interp=trilinear
+fate-filter-lut3d-rgb24-tetrahedral: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=rgb24,lut3d=file=$(TARGET_PATH)/tests/data/filtergraphs/lut3d.cube:interp=tetrahedral
+
+FATE_LUT3D += fate-filter-lut3d-gbrp10-trilinear fate-filter-lut3d-gbrp12-tetrahedral
+fate-filter-lut3d-gbrp10-trilinear: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=gbrp10,lut3d=file=$(TARGET_PATH)/tests/data/filtergraphs/lut3d.cube:interp=trilinear
+fate-filter-lut3d-gbrp12-tetrahedral: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=gbrp12,lut3d=file=$(TARGET_PATH)/tests/data/filtergraphs/lut3d.cube:interp=tetrahedral
+
+$(FATE_LUT3D): tests/data/filtergraphs/lut3d.cube
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER LUT3D_FILTER) += $(FATE_LUT3D)
+
+FATE_XFADE += fate-filter-xfade-fade fate-filter-xfade-fadeblack fate-filter-xfade-dissolve fate-filter-xfade-wipeleft
+fate-filter-xfade-fade: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p[a];testsrc=d=2:r=10,format=yuv420p[b];[a][b]xfade=fade:duration=1:offset=0.5"
+fate-filter-xfade-fadeblack: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p[a];testsrc=d=2:r=10,format=yuv420p[b];[a][b]xfade=fadeblack:duration=1:offset=0.5"
+fate-filter-xfade-dissolve: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p[a];testsrc=d=2:r=10,format=yuv420p[b];[a][b]xfade=dissolve:duration=1:offset=0.5"
+fate-filter-xfade-wipeleft: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p[a];testsrc=d=2:r=10,format=yuv420p[b];[a][b]xfade=wipeleft:duration=1:offset=0.5"
+
+FATE_XFADE += fate-filter-xfade-fade-yuv420p10 fate-filter-xfade-fadewhite-yuv420p10 fate-filter-xfade-dissolve-yuv420p10
+fate-filter-xfade-fade-yuv420p10: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p10[a];testsrc=d=2:r=10,format=yuv420p10[b];[a][b]xfade=fade:duration=1:offset=0.5" -pix_fmt yuv420p10le
+fate-filter-xfade-fadewhite-yuv420p10: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p10[a];testsrc=d=2:r=10,format=yuv420p10[b];[a][b]xfade=fadewhite:duration=1:offset=0.5" -pix_fmt yuv420p10le
+fate-filter-xfade-dissolve-yuv420p10: CMD = framecrc -lavfi "testsrc2=d=2:r=10,format=yuv420p10[a];testsrc=d=2:r=10,format=yuv420p10[b];[a][b]xfade=dissolve:duration=1:offset=0.5" -pix_fmt yuv420p10le
+
+FATE_FILTER-$(call ALLYES, TESTSRC_FILTER TESTSRC2_FILTER FORMAT_FILTER XFADE_FILTER) += $(FATE_XFADE)
+
+# conversions merged into a neighbouring scale filter, before and after it
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER CROP_FILTER SCALE_FILTER) += fate-filter-fuse-scalers-first fate-filter-fuse-scalers-last
+fate-filter-fuse-scalers-first: CMD = framecrc -filter_fuse_scalers -lavfi testsrc2=s=320x240:d=0.4,format=yuv422p10,format=yuv422p,crop=256:192:16:8,scale=160:120
+fate-filter-fuse-scalers-last: CMD = framecrc -filter_fuse_scalers -lavfi testsrc2=s=320x240:d=0.4,format=yuv420p,scale=160:120,format=yuv420p,format=yuv422p
+
+# conversions which must not be merged: same output as without merging
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SCALE_FILTER) += fate-filter-fuse-scalers-rgb fate-filter-fuse-scalers-rgb-merge
+fate-filter-fuse-scalers-rgb: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=yuv420p,format=rgb24,scale=160:120
+fate-filter-fuse-scalers-rgb-merge: CMD = framecrc -filter_fuse_scalers -lavfi testsrc2=s=320x240:d=0.4,format=yuv420p,format=rgb24,scale=160:120
+fate-filter-fuse-scalers-rgb-merge: REF = $(SRC_PATH)/tests/ref/fate/filter-fuse-scalers-rgb
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER CROP_FILTER SCALE_FILTER) += fate-filter-fuse-scalers-crop fate-filter-fuse-scalers-crop-merge
+fate-filter-fuse-scalers-crop: CMD = framecrc -lavfi testsrc2=s=320x240:d=0.4,format=yuv422p10,format=yuv420p,crop=256:192:16:8,scale=160:120
+fate-filter-fuse-scalers-crop-merge: CMD = framecrc -filter_fuse_scalers -lavfi testsrc2=s=320x240:d=0.4,format=yuv422p10,format=yuv420p,crop=256:192:16:8,scale=160:120
+fate-filter-fuse-scalers-crop-merge: REF = $(SRC_PATH)/tests/ref/fate/filter-fuse-scalers-crop
+
 FATE_FILTER-$(call ALLYES, MINTERPOLATE_FILTER TESTSRC2_FILTER) += fate-filter-minterpolate-up fate-filter-minterpolate-down
 fate-filter-minterpolate-up: CMD = framecrc -lavfi testsrc2=r=2:d=10,framerate=fps=10 -t 1
 fate-filter-minterpolate-down: CMD = framecrc -lavfi testsrc2=r=2:d=10,framerate=fps=1 -t 1
 
+FATE_FILTER_VSYNTH-$(CONFIG_MINTERPOLATE_FILTER) += fate-filter-minterpolate-bilat fate-filter-minterpolate-bilat-threads
+fate-filter-minterpolate-bilat: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf minterpolate=fps=50 -frames:v 20
+fate-filter-minterpolate-bilat-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf minterpolate=fps=50 -frames:v 20 -filter_threads 4
+fate-filter-minterpolate-bilat-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-bilat
+
+FATE_FILTER_VSYNTH-$(CONFIG_MINTERPOLATE_FILTER) += fate-filter-minterpolate-bidir fate-filter-minterpolate-bidir-threads
+fate-filter-minterpolate-bidir: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf minterpolate=fps=50:me_mode=bidir:mc_mode=aobmc:vsbmc=1 -frames:v 20
+fate-filter-minterpolate-bidir-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf minterpolate=fps=50:me_mode=bidir:mc_mode=aobmc:vsbmc=1 -frames:v 20 -filter_threads 4
+fate-filter-minterpolate-bidir-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-bidir
+
+FATE_FILTER_VSYNTH-$(CONFIG_MINTERPOLATE_FILTER) += fate-filter-minterpolate-bidir-shared-threads
+fate-filter-minterpolate-bidir-shared-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf minterpolate=fps=50:me_mode=bidir:mc_mode=aobmc:vsbmc=1 -frames:v 20 -filter_threads 4 -filter_shared_threads
+fate-filter-minterpolate-bidir-shared-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-bidir
+
+FATE_FILTER_VSYNTH-$(call ALLYES, SENDCMD_FILTER FORMAT_FILTER COLORBALANCE_FILTER HFLIP_FILTER) += fate-filter-frame-threads fate-filter-frame-threads-4
+fate-filter-frame-threads fate-filter-frame-threads-4: tests/data/filtergraphs/frame_threads
+fate-filter-frame-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_script $(TARGET_PATH)/tests/data/filtergraphs/frame_threads -frames:v 30
+fate-filter-frame-threads-4: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_script $(TARGET_PATH)/tests/data/filtergraphs/frame_threads -frames:v 30 -filter_threads 4
+fate-filter-frame-threads-4: REF = $(SRC_PATH)/tests/ref/fate/filter-frame-threads
+
+FATE_FILTER_VSYNTH-$(CONFIG_DESHAKE_FILTER) += fate-filter-deshake fate-filter-deshake-threads fate-filter-deshake-twopass
+fate-filter-deshake: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf deshake -frames:v 20
+fate-filter-deshake-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf deshake -frames:v 20 -filter_threads 4
+fate-filter-deshake-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-deshake
+fate-filter-deshake-twopass: CMD = deshake_twopass -c:v pgmyuv -i $(SRC) -frames:v 20
+fate-filter-deshake-twopass: REF = $(SRC_PATH)/tests/ref/fate/filter-deshake
+
 FATE_FILTER_VSYNTH-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -489,6 +562,9 @@ FATE_FILTER_VSYNTH-$(CONFIG_SCALE2REF_FILTER) += fate-filter-scale2ref_keep_aspe
 fate-filter-scale2ref_keep_aspect: tests/data/filtergraphs/scale2ref_keep_aspect
 fate-filter-scale2ref_keep_aspect: CMD = framemd5 -frames:v 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale2ref_keep_aspect -map "[main]"
 
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER MULTISCALE_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: CMD = framecrc -lavfi "testsrc2=r=5:d=1:s=320x240,multiscale=sizes=160x120|-2x60|48x36:flags=bicubic+accurate_rnd+bitexact"
+
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scalechroma
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_v_chr_pos=33:out_h_chr_pos=151
@@ -847,6 +923,10 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER-yes += fate-filter-blendmask
+fate-filter-blendmask: libavfilter/tests/blendmask$(EXESUF)
+fate-filter-blendmask: CMD = run libavfilter/tests/blendmask$(EXESUF)
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
@@ -239,6 +239,23 @@ $(foreach N,$(HEVC_SAMPLES_444_8BIT),$(eval $(call FATE_HEVC_TEST_444_8BIT,$(N))
 $(foreach N,$(HEVC_SAMPLES_444_12BIT),$(eval $(call FATE_HEVC_TEST_444_12BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_444_12BIT_LARGE),$(eval $(call FATE_HEVC_TEST_444_12BIT_LARGE,$(N))))
 
+# wavefront parallel processing inside frame threads, same output as the
+# single threaded conformance tests above
+define FATE_HEVC_WPP_FRAME_SLICE_TEST
+FATE_HEVC += fate-hevc-wpp-frame-slice-$(1)
+fate-hevc-wpp-frame-slice-$(1): CMD = threads=2 framecrc -thread_type frame+slice -slice_threads 3 -flags unaligned -vsync drop -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p
+fate-hevc-wpp-frame-slice-$(1): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
+define FATE_HEVC_WPP_FRAME_SLICE_TEST_10BIT
+FATE_HEVC += fate-hevc-wpp-frame-slice-$(1)
+fate-hevc-wpp-frame-slice-$(1): CMD = threads=2 framecrc -thread_type frame+slice -slice_threads 3 -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p10le
+fate-hevc-wpp-frame-slice-$(1): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
+$(foreach N,$(filter WPP_%,$(HEVC_SAMPLES)),$(eval $(call FATE_HEVC_WPP_FRAME_SLICE_TEST,$(N))))
+$(foreach N,$(filter WPP_%,$(HEVC_SAMPLES_10BIT)),$(eval $(call FATE_HEVC_WPP_FRAME_SLICE_TEST_10BIT,$(N))))
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -vsync 0 -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC_LARGE += fate-hevc-paramchange-yuv420p-yuv420p10
 
@@ -280,3 +297,17 @@ FATE_SAMPLES_AVCONV += $(FATE_HEVC-yes)
 FATE_SAMPLES_FFPROBE += $(FATE_HEVC_FFPROBE-yes)
 
 fate-hevc: $(FATE_HEVC-yes) $(FATE_HEVC_FFPROBE-yes)
+
+# Decoding speed for several thread counts, with slice, frame and combined
+# frame+slice threading. This is a benchmark rather than a test, as the
+# results depend on the machine, so it is not in the fate- namespace; set
+# HEVC_BENCH_SAMPLE to measure another stream, e.g. a UHD one using wavefront
+# parallel processing.
+HEVC_BENCH_SAMPLE        ?= $(TARGET_SAMPLES)/hevc-conformance/WPP_F_ericsson_MAIN10_2.bit
+HEVC_BENCH_THREADS       ?= 1 2 4 8
+HEVC_BENCH_SLICE_THREADS ?= 2
+
+bench-hevc: ffmpeg$(PROGSSUF)$(EXESUF)
+	$(Q)$(SRC_PATH)/tests/decode-bench.sh "$(TARGET_EXEC) $(TARGET_PATH)/$<" "$(HEVC_BENCH_SAMPLE)" "$(HEVC_BENCH_THREADS)" "$(HEVC_BENCH_SLICE_THREADS)"
+
+.PHONY: bench-hevc
@@ -56,6 +56,23 @@ fate-lavf-wtv: CMD = lavf_container "" "-c:a mp2 -threads 1"
 FATE_AVCONV += $(FATE_LAVF_CONTAINER)
 fate-lavf-container fate-lavf: $(FATE_LAVF_CONTAINER)
 
+# demuxing of some of the files above, through read() and through a memory
+# mapping of the file, which must give the same packets
+FATE_LAVF_DEMUX-$(call ENCDEC2, MPEG4,      PCM_ALAW, MOV)    += mov
+FATE_LAVF_DEMUX-$(call ENCDEC2, MPEG2VIDEO, MP2,      MPEGTS) += ts
+
+FATE_LAVF_DEMUX      = $(FATE_LAVF_DEMUX-yes:%=fate-lavf-%-demux)
+FATE_LAVF_DEMUX_MMAP = $(FATE_LAVF_DEMUX-yes:%=fate-lavf-%-demux-mmap)
+
+$(FATE_LAVF_DEMUX): fate-lavf-%-demux: fate-lavf-%
+$(FATE_LAVF_DEMUX): CMD = framecrc -i $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-lavf-%-demux=%) -c copy
+$(FATE_LAVF_DEMUX_MMAP): fate-lavf-%-demux-mmap: fate-lavf-%
+$(FATE_LAVF_DEMUX_MMAP): CMD = framecrc -mmap 1 -i $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-lavf-%-demux-mmap=%) -c copy
+$(FATE_LAVF_DEMUX_MMAP): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-mmap=%)
+
+FATE_AVCONV += $(FATE_LAVF_DEMUX) $(FATE_LAVF_DEMUX_MMAP)
+fate-lavf-container fate-lavf: $(FATE_LAVF_DEMUX) $(FATE_LAVF_DEMUX_MMAP)
+
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, IVF_DEMUXER AV1_PARSER MOV_MUXER)      += av1.mp4
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, IVF_DEMUXER AV1_PARSER MATROSKA_MUXER) += av1.mkv
 FATE_LAVF_CONTAINER_FATE-$(call ALLYES, H264_DEMUXER H264_PARSER MOV_MUXER)    += h264.mp4
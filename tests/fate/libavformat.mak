@@ -2,6 +2,37 @@
 #fate-async: libavformat/tests/async$(EXESUF)
 #fate-async: CMD = run libavformat/tests/async
 
+FATE_LIBAVFORMAT-yes += fate-compactindex
+fate-compactindex: libavformat/tests/compactindex$(EXESUF)
+fate-compactindex: CMD = run libavformat/tests/compactindex$(EXESUF)
+
+FATE_FIND_STREAM_INFO-$(call ENCDEC2, MPEG1VIDEO, MP2, MPEG1SYSTEM MPEGPS) += mpg
+FATE_FIND_STREAM_INFO-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS)             += ts
+FATE_FIND_STREAM_INFO-$(call ENCDEC2, MPEG4,      MP2, MATROSKA)           += mkv
+FATE_FIND_STREAM_INFO-$(call ENCDEC2, MPEG4,      MP2, NUT)                += nut
+
+FATE_FIND_STREAM_INFO = $(FATE_FIND_STREAM_INFO-yes:%=fate-find-stream-info-%)
+$(FATE_FIND_STREAM_INFO): fate-find-stream-info-%: fate-lavf-% libavformat/tests/find_stream_info$(EXESUF)
+$(FATE_FIND_STREAM_INFO): CMD = run libavformat/tests/find_stream_info$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-find-stream-info-%=%)
+
+# the same analysis with the decoders on worker threads
+FATE_FIND_STREAM_INFO_THREADS = $(FATE_FIND_STREAM_INFO:%=%-threads)
+$(FATE_FIND_STREAM_INFO_THREADS): fate-find-stream-info-%-threads: fate-lavf-% libavformat/tests/find_stream_info$(EXESUF)
+$(FATE_FIND_STREAM_INFO_THREADS): CMD = run libavformat/tests/find_stream_info$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-find-stream-info-%-threads=%) -analyze_threads 4
+$(FATE_FIND_STREAM_INFO_THREADS): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-threads=%)
+
+# input stalling for longer than max_analyze_time
+FATE_FIND_STREAM_INFO_STALL-$(call ALLYES, MPEG2VIDEO_ENCODER MPEG2VIDEO_DECODER MP2_ENCODER MP2_DECODER \
+                                           MPEGTS_MUXER MPEGTS_DEMUXER PIPE_PROTOCOL) += stall stall-threads
+FATE_FIND_STREAM_INFO_STALL = $(FATE_FIND_STREAM_INFO_STALL-yes:%=fate-find-stream-info-%)
+$(FATE_FIND_STREAM_INFO_STALL): fate-lavf-ts libavformat/tests/find_stream_info$(EXESUF)
+fate-find-stream-info-stall: CMD = find_stream_info_stall $(TARGET_PATH)/tests/data/lavf/lavf.ts 65536
+fate-find-stream-info-stall-threads: CMD = find_stream_info_stall $(TARGET_PATH)/tests/data/lavf/lavf.ts 65536 -analyze_threads 4
+fate-find-stream-info-stall-threads: REF = $(SRC_PATH)/tests/ref/fate/find-stream-info-stall
+
+FATE_AVCONV += $(FATE_FIND_STREAM_INFO) $(FATE_FIND_STREAM_INFO_THREADS) $(FATE_FIND_STREAM_INFO_STALL)
+fate-find-stream-info: $(FATE_FIND_STREAM_INFO) $(FATE_FIND_STREAM_INFO_THREADS) $(FATE_FIND_STREAM_INFO_STALL)
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy$(EXESUF)
@@ -36,7 +36,15 @@ FATE_SAMPLES_AVCONV += $(FATE_MOV)
 FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE)
 FATE_SAMPLES_FASTSTART += $(FATE_MOV_FASTSTART)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART)
+# Open a file with B-frames three times with the index cache: writing the
+# entry, using it, and with the entry truncated, then once more after the
+# file was modified. The packets must be the same every time.
+FATE_MOV_INDEX_CACHE-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER PCM_S16LE_ENCODER MOV_MUXER MOV_DEMUXER FRAMECRC_MUXER) += fate-mov-index-cache
+fate-mov-index-cache: CMD = mov_index_cache -f lavfi -i testsrc=s=160x120:d=2 -f lavfi -i sine=d=2 -c:v mpeg4 -bf 2 -c:a pcm_s16le -f mov
+
+FATE_FFMPEG += $(FATE_MOV_INDEX_CACHE-yes)
+
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_INDEX_CACHE-yes)
 
 # Make sure we handle edit lists correctly in normal cases.
 fate-mov-1elist-noctts: CMD = framemd5 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
@@ -246,6 +246,30 @@ fate-seek-lavf-y4m:      SRC = lavf/lavf.y4m
 
 FATE_SEEK += $(FATE_SEEK_LAVF-yes:%=fate-seek-lavf-%)
 
+# the same with an index small enough to be reduced repeatedly
+FATE_SEEK_INDEXMEM-$(call ENCDEC2, MPEG1VIDEO, MP2, MPEG1SYSTEM MPEGPS) += mpg
+FATE_SEEK_INDEXMEM-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS)             += ts
+
+FATE_SEEK_INDEXMEM = $(FATE_SEEK_INDEXMEM-yes:%=fate-seek-lavf-%-indexmem)
+$(FATE_SEEK_INDEXMEM): fate-seek-lavf-%-indexmem: fate-lavf-% libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK_INDEXMEM): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-seek-lavf-%-indexmem=%) -indexmem 256
+$(FATE_SEEK_INDEXMEM): REF = $(SRC_PATH)/tests/ref/seek/lavf-$(@:fate-seek-lavf-%-indexmem=%)
+
+FATE_AVCONV += $(FATE_SEEK_INDEXMEM)
+fate-seek: $(FATE_SEEK_INDEXMEM)
+
+# the same through a memory mapping of the file
+FATE_SEEK_MMAP-$(call ENCDEC2, MPEG4,      PCM_ALAW, MOV)    += mov
+FATE_SEEK_MMAP-$(call ENCDEC2, MPEG2VIDEO, MP2,      MPEGTS) += ts
+
+FATE_SEEK_MMAP = $(FATE_SEEK_MMAP-yes:%=fate-seek-lavf-%-mmap)
+$(FATE_SEEK_MMAP): fate-seek-lavf-%-mmap: fate-lavf-% libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK_MMAP): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.$(@:fate-seek-lavf-%-mmap=%) -mmap 1
+$(FATE_SEEK_MMAP): REF = $(SRC_PATH)/tests/ref/seek/lavf-$(@:fate-seek-lavf-%-mmap=%)
+
+FATE_AVCONV += $(FATE_SEEK_MMAP)
+fate-seek: $(FATE_SEEK_MMAP)
+
 # extra files
 
 FATE_SEEK_EXTRA-$(CONFIG_MP3_DEMUXER)   += fate-seek-extra-mp3
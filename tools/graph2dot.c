@@ -42,6 +42,9 @@ static void usage(void)
            "Options:\n"
            "-i INFILE         set INFILE as input file, stdin if omitted\n"
            "-o OUTFILE        set OUTFILE as output file, stdout if omitted\n"
+           "-p                run the graph until EOF and annotate it with the time\n"
+           "                  spent in each filter and the traffic on each link;\n"
+           "                  the graph must end in nullsink or anullsink filters\n"
            "-h                print this help\n");
 }
 
@@ -50,7 +53,20 @@ struct line {
     struct line *next;
 };
 
-static void print_digraph(FILE *outfile, AVFilterGraph *graph)
+static void filter_label(char *buf, size_t size,
+                         const AVFilterContext *filter_ctx, int profile)
+{
+    if (profile)
+        snprintf(buf, size, "%s\\n(%s)\\n%.3f ms, %"PRId64" activations",
+                 filter_ctx->name, filter_ctx->filter->name,
+                 filter_ctx->activate_time / 1000.0,
+                 filter_ctx->nb_activations);
+    else
+        snprintf(buf, size, "%s\\n(%s)",
+                 filter_ctx->name, filter_ctx->filter->name);
+}
+
+static void print_digraph(FILE *outfile, AVFilterGraph *graph, int profile)
 {
     int i, j;
 
@@ -59,23 +75,20 @@ static void print_digraph(FILE *outfile, AVFilterGraph *graph)
     fprintf(outfile, "rankdir=LR\n");
 
     for (i = 0; i < graph->nb_filters; i++) {
-        char filter_ctx_label[128];
+        char filter_ctx_label[192];
         const AVFilterContext *filter_ctx = graph->filters[i];
 
-        snprintf(filter_ctx_label, sizeof(filter_ctx_label), "%s\\n(%s)",
-                 filter_ctx->name,
-                 filter_ctx->filter->name);
+        filter_label(filter_ctx_label, sizeof(filter_ctx_label),
+                     filter_ctx, profile);
 
         for (j = 0; j < filter_ctx->nb_outputs; j++) {
             AVFilterLink *link = filter_ctx->outputs[j];
             if (link) {
-                char dst_filter_ctx_label[128];
+                char dst_filter_ctx_label[192];
                 const AVFilterContext *dst_filter_ctx = link->dst;
 
-                snprintf(dst_filter_ctx_label, sizeof(dst_filter_ctx_label),
-                         "%s\\n(%s)",
-                         dst_filter_ctx->name,
-                         dst_filter_ctx->filter->name);
+                filter_label(dst_filter_ctx_label, sizeof(dst_filter_ctx_label),
+                             dst_filter_ctx, profile);
 
                 fprintf(outfile, "\"%s\" -> \"%s\" [ label= \"inpad:%s -> outpad:%s\\n",
                         filter_ctx_label, dst_filter_ctx_label,
@@ -99,6 +112,11 @@ static void print_digraph(FILE *outfile, AVFilterGraph *graph)
                             link->sample_rate, buf,
                             link->time_base.num, link->time_base.den);
                 }
+                if (profile)
+                    fprintf(outfile,
+                            "\\nframes:%"PRId64" max queued:%"PRId64" pool:%"PRId64" KiB",
+                            link->frame_count_in, link->max_queued_frames,
+                            link->pool_bytes >> 10);
                 fprintf(outfile, "\" ];\n");
             }
         }
@@ -113,12 +131,14 @@ int main(int argc, char **argv)
     FILE *outfile           = NULL;
     FILE *infile            = NULL;
     char *graph_string      = NULL;
-    AVFilterGraph *graph = av_mallocz(sizeof(AVFilterGraph));
+    AVFilterGraph *graph    = NULL;
+    int profile             = 0;
+    int ret;
     char c;
 
     av_log_set_level(AV_LOG_DEBUG);
 
-    while ((c = getopt(argc, argv, "hi:o:")) != -1) {
+    while ((c = getopt(argc, argv, "hi:o:p")) != -1) {
         switch (c) {
         case 'h':
             usage();
@@ -129,6 +149,9 @@ int main(int argc, char **argv)
         case 'o':
             outfilename = optarg;
             break;
+        case 'p':
+            profile = 1;
+            break;
         case '?':
             return 1;
         }
@@ -189,6 +212,13 @@ int main(int argc, char **argv)
         *p = '\0';
     }
 
+    graph = avfilter_graph_alloc();
+    if (!graph) {
+        fprintf(stderr, "Memory allocation failure\n");
+        return 1;
+    }
+    graph->profile = profile;
+
     if (avfilter_graph_parse(graph, graph_string, NULL, NULL, NULL) < 0) {
         fprintf(stderr, "Failed to parse the graph description\n");
         return 1;
@@ -197,8 +227,19 @@ int main(int argc, char **argv)
     if (avfilter_graph_config(graph, NULL) < 0)
         return 1;
 
-    print_digraph(outfile, graph);
+    if (profile) {
+        /* the graph has no inputs, so it is done once it stops producing */
+        while ((ret = avfilter_graph_request_oldest(graph)) >= 0)
+            ;
+        if (ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+            fprintf(stderr, "Failed to run the graph: %s\n", av_err2str(ret));
+            return 1;
+        }
+    }
+
+    print_digraph(outfile, graph, profile);
     fflush(outfile);
+    avfilter_graph_free(&graph);
 
     return 0;
 }